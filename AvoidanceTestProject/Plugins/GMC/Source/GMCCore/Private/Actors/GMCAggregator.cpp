@@ -17,6 +17,8 @@ DECLARE_CYCLE_STAT(TEXT("PawnTicks"), STAT_PawnTicks, STATGROUP_AGMC_Aggregator)
 DECLARE_CYCLE_STAT(TEXT("MovementComponentTicks"), STAT_MovementComponentTicks, STATGROUP_AGMC_Aggregator)
 DECLARE_CYCLE_STAT(TEXT("RollbackActorTicks"), STAT_RollbackActorTicks, STATGROUP_AGMC_Aggregator)
 DECLARE_CYCLE_STAT(TEXT("MeshComponentTicks"), STAT_MeshComponentTicks, STATGROUP_AGMC_Aggregator)
+DECLARE_CYCLE_STAT(TEXT("UpdatePawnGrid"), STAT_UpdatePawnGrid, STATGROUP_AGMC_Aggregator)
+DECLARE_CYCLE_STAT(TEXT("GetPawnsInRadius"), STAT_GetPawnsInRadius, STATGROUP_AGMC_Aggregator)
 
 AGMC_Aggregator::AGMC_Aggregator(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
@@ -93,6 +95,7 @@ void AGMC_Aggregator::Tick(float DeltaTime)
       if (!IsValid(Pawn))
       {
         Pawns.RemoveAt(Index);
+        bPawnGridDirty = true;
         --Index;
         continue;
       }
@@ -301,6 +304,7 @@ void AGMC_Aggregator::RegisterPawn(APawn* Pawn)
   }
 
   Pawns.AddUnique(Pawn);
+  bPawnGridDirty = true;
 
   SortPawns();
 }
@@ -351,6 +355,7 @@ void AGMC_Aggregator::UnregisterPawn(APawn* Pawn)
 {
   const int32 NumRemoved = Pawns.Remove(Pawn);
   gmc_ck(NumRemoved <= 1)
+  bPawnGridDirty |= NumRemoved > 0;
 }
 
 void AGMC_Aggregator::UnregisterMovementComponent(UMovementComponent* MovementComponent)
@@ -385,6 +390,7 @@ void AGMC_Aggregator::SortPawns()
     Pawns,
     [&](const APawn* A, const APawn* B) { return GetPawnOrderNumber(A) < GetPawnOrderNumber(B);
   });
+  bPawnGridDirty = true;
 }
 
 void AGMC_Aggregator::SortMovementComponents()
@@ -416,6 +422,99 @@ const TArray<AController*>& AGMC_Aggregator::GetControllers() const
   return Controllers;
 }
 
+void AGMC_Aggregator::GetPawnsInRadius(const FVector& Location, double Radius, TArray<APawn*>& OutPawns)
+{
+  SCOPE_CYCLE_COUNTER(STAT_GetPawnsInRadius)
+
+  ConditionalUpdatePawnGrid();
+
+  // Pawns may have moved out of the cell they were bucketed into since the rebuild, the exact test below uses their current location.
+  const double CellRadius = Radius + PawnGridMaxStaleDistance;
+  const FIntPoint MinCell = GetPawnGridCell(Location - FVector(CellRadius, CellRadius, 0.));
+  const FIntPoint MaxCell = GetPawnGridCell(Location + FVector(CellRadius, CellRadius, 0.));
+  TArray<int32, TInlineAllocator<32>> Indices{};
+  for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+  {
+    for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+    {
+      if (const auto* Cell = PawnGrid.Find(FIntPoint(CellX, CellY)))
+      {
+        Indices.Append(*Cell);
+      }
+    }
+  }
+
+  // Keep the order of the pawn array so callers behave the same as when iterating all pawns.
+  Indices.Sort();
+  const double RadiusSquared = FMath::Square(Radius);
+  for (const int32 Index : Indices)
+  {
+    const auto& Pawn = Pawns[Index];
+    if (IsValid(Pawn) && FVector::DistSquared(Pawn->GetActorLocation(), Location) <= RadiusSquared)
+    {
+      OutPawns.Emplace(Pawn);
+    }
+  }
+}
+
+double AGMC_Aggregator::GetMaxPawnSpeed()
+{
+  ConditionalUpdatePawnGrid();
+  return MaxPawnSpeed;
+}
+
+void AGMC_Aggregator::ConditionalUpdatePawnGrid()
+{
+  if (bPawnGridDirty || PawnGridFrame != GFrameCounter)
+  {
+    UpdatePawnGrid();
+  }
+}
+
+void AGMC_Aggregator::UpdatePawnGrid()
+{
+  SCOPE_CYCLE_COUNTER(STAT_UpdatePawnGrid)
+
+  MaxPawnSpeed = 0.;
+
+  // Cells are reused across rebuilds so pawns staying in the same area do not cause any allocations.
+  for (auto& Cell : PawnGrid)
+  {
+    Cell.Value.Reset();
+  }
+
+  for (int32 Index = 0; Index < Pawns.Num(); ++Index)
+  {
+    const auto& Pawn = Pawns[Index];
+    if (IsValid(Pawn))
+    {
+      PawnGrid.FindOrAdd(GetPawnGridCell(Pawn->GetActorLocation())).Emplace(Index);
+
+      if (const auto& MovementComponent = Pawn->GetMovementComponent())
+      {
+        MaxPawnSpeed = FMath::Max(MaxPawnSpeed, static_cast<double>(MovementComponent->GetMaxSpeed()));
+      }
+    }
+  }
+
+  for (auto It = PawnGrid.CreateIterator(); It; ++It)
+  {
+    if (It.Value().IsEmpty())
+    {
+      It.RemoveCurrent();
+    }
+  }
+
+  PawnGridFrame = GFrameCounter;
+  bPawnGridDirty = false;
+}
+
+FIntPoint AGMC_Aggregator::GetPawnGridCell(const FVector& Location) const
+{
+  const double InvCellSize = 1. / FMath::Max(PawnGridCellSize, 1.);
+  return FIntPoint(FMath::FloorToInt32(Location.X * InvCellSize), FMath::FloorToInt32(Location.Y * InvCellSize));
+}
+
 const TArray<APawn*>& AGMC_Aggregator::GetPawns() const
 {
   return Pawns;
@@ -51,6 +51,9 @@ void AGMC_Pawn::PostInitializeComponents()
   if (!ReplicationComponent->HasAnyFlags(NoBindingFlags))
   {
     CALL_NATIVE_EVENT_CONDITIONAL(ReplicationComponent->bNoBlueprintEvents, ReplicationComponent, BindReplicationData);
+
+    // All members are bound now, every pawn state of the component uses the same data block layout from here on.
+    ReplicationComponent->AliasData.FinalizeLayout();
   }
   else
   {
@@ -9,6 +9,7 @@
 #include "GMCAggregator.h"
 #include "GMCLog.h"
 #include "GMCReplicationComponent_DBG.h"
+#include "UObject/CoreNet.h"
 
 DECLARE_CYCLE_STAT(TEXT("TickComponent"), STAT_TickComponent, STATGROUP_UGMC_ReplicationCmp)
 DECLARE_CYCLE_STAT(TEXT("OnWorldTickStart"), STAT_OnWorldTickStart, STATGROUP_UGMC_ReplicationCmp)
@@ -53,6 +54,42 @@ DECLARE_CYCLE_STAT(TEXT("TickGenericRollbackActors"), STAT_TickGenericRollbackAc
 DECLARE_CYCLE_STAT(TEXT("GatherGenericRollbackActors"), STAT_GatherGenericRollbackActors, STATGROUP_UGMC_ReplicationCmp)
 DECLARE_CYCLE_STAT(TEXT("RollbackGenericActors"), STAT_RollbackGenericActors, STATGROUP_UGMC_ReplicationCmp)
 DECLARE_CYCLE_STAT(TEXT("RestoreRolledBackGenericActors"), STAT_RestoreRolledBackGenericActors, STATGROUP_UGMC_ReplicationCmp)
+DECLARE_CYCLE_STAT(TEXT("SV_NetSerializeSharedSyncData"), STAT_SV_NetSerializeSharedSyncData, STATGROUP_UGMC_ReplicationCmp)
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared SP Serialization Hits"), STAT_SharedSPSerializationHits, STATGROUP_UGMC_ReplicationCmp)
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared SP Serialization Misses"), STAT_SharedSPSerializationMisses, STATGROUP_UGMC_ReplicationCmp)
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Shared SP Serialization Hit Rate (%)"), STAT_SharedSPSerializationHitRate, STATGROUP_UGMC_ReplicationCmp)
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared SP Serialization Bytes Produced"), STAT_SharedSPSerializationBytesProduced, STATGROUP_UGMC_ReplicationCmp)
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared SP Serialization Bytes Reused"), STAT_SharedSPSerializationBytesReused, STATGROUP_UGMC_ReplicationCmp)
+
+#if STATS
+/// The hit rate cannot be accumulated like the other counters, so the lookups of all pawns within the current frame are tallied here.
+static void RecordSharedSPSerialization(bool bHit, int64 NumBits)
+{
+  static uint64 Frame{0};
+  static uint32 NumHits{0};
+  static uint32 NumLookups{0};
+  if (Frame != GFrameCounter)
+  {
+    Frame = GFrameCounter;
+    NumHits = NumLookups = 0;
+  }
+
+  ++NumLookups;
+  const uint32 NumBytes = (uint32)((NumBits + 7) >> 3);
+  if (bHit)
+  {
+    ++NumHits;
+    INC_DWORD_STAT(STAT_SharedSPSerializationHits)
+    INC_DWORD_STAT_BY(STAT_SharedSPSerializationBytesReused, NumBytes)
+  }
+  else
+  {
+    INC_DWORD_STAT(STAT_SharedSPSerializationMisses)
+    INC_DWORD_STAT_BY(STAT_SharedSPSerializationBytesProduced, NumBytes)
+  }
+  SET_FLOAT_STAT(STAT_SharedSPSerializationHitRate, 100.f * NumHits / NumLookups)
+}
+#endif
 
 namespace GMCCVars
 {
@@ -1056,7 +1093,7 @@ void UGMC_ReplicationCmp::CL_OnRepAPMove()
   gmc_ck(!APMove().MetaData.bIsUsingServerAuthPhysics)
   gmc_ck(APMove().MetaData.bPredictedClientMove)
 
-  FGMC_Move SourceMove = CL_ClearAcknowledgedMoves(APMove().MetaData.Timestamp);
+  FGMC_Move& SourceMove = CL_ClearAcknowledgedMoves(APMove().MetaData.Timestamp);
 
   const double CurrentTime = GetTime();
 
@@ -1580,6 +1617,8 @@ void UGMC_ReplicationCmp::ClearTransientData(bool bResetMoves)
   }
 
   MoveHistory.Reset(MoveHistoryMaxSize);
+  SV_MoveReceivers.Reset();
+  SV_SimulatedProxySerializationAux.Reset();
 
   SV_RemoteServerPawnSmoothingSwapBuffer.Reset();
   SV_RemoteMoveExecutionAux.Reset();
@@ -3947,27 +3986,29 @@ const FGMC_PawnState& UGMC_ReplicationCmp::CL_NoPredictionBuffer() const
   return CL_NoPredictionSwapBuffer.Buffer;
 }
 
-FGMC_Move UGMC_ReplicationCmp::CL_ClearAcknowledgedMoves(double ReceivedTimestamp)
+FGMC_Move& UGMC_ReplicationCmp::CL_ClearAcknowledgedMoves(double ReceivedTimestamp)
 {
   SCOPE_CYCLE_COUNTER(STAT_CL_ClearAcknowledgedMoves)
 
-  TGMC_CircularArray<FGMC_Move> TempMoves{};
-  TempMoves.Reset(MoveHistoryMaxSize);
-  FGMC_Move SourceMove{};
-  for (int32 Index = 0; Index < MoveHistory.Num(); ++Index)
+  // Timestamps in the history are monotonic, so all acknowledged moves are at the front.
+  int32 NumAcknowledged = 0;
+  while (NumAcknowledged < MoveHistory.Num() && MoveHistory[NumAcknowledged].MetaData.Timestamp <= ReceivedTimestamp)
   {
-    const auto& Move = MoveHistory[Index];
-    if (Move.MetaData.Timestamp > ReceivedTimestamp)
-    {
-      TempMoves.Add(Move);
-    }
-    else if (Move.MetaData.Timestamp == ReceivedTimestamp)
-    {
-      SourceMove = Move;
-    }
+    ++NumAcknowledged;
+  }
+
+  FGMC_Move& SourceMove = CL_AcknowledgedMove;
+  if (NumAcknowledged > 0 && MoveHistory[NumAcknowledged - 1].MetaData.Timestamp == ReceivedTimestamp)
+  {
+    // The popped slot keeps the previous source move, whose memory is reused when the slot is assigned to again.
+    Swap(SourceMove, MoveHistory[NumAcknowledged - 1]);
+  }
+  else
+  {
+    SourceMove.MetaData.Timestamp = -1.;
   }
 
-  MoveHistory = MoveTemp(TempMoves);
+  MoveHistory.PopFront(NumAcknowledged);
 
   // An empty move history after clearing can happen due to inconsistent timestamps.
   GMC_CLOG(MoveHistory.Num() == 0, LogGMCReplication, PawnOwner,Verbose, TEXT("Client move history is empty after clearing acknowledged moves."))
@@ -4024,6 +4065,7 @@ bool UGMC_ReplicationCmp::CL_AddToPredictionHistory(const FGMC_Move& NewMove, bo
   // We don't need to check for things like a valid timestamp here anymore because those things have been checked already when it was determined that the move
   // should be added.
   MoveHistory.Add(NewMove);
+  OnMoveAddedToHistory();
 
   if (MoveHistory.Num() == MoveHistoryMaxSize)
   {
@@ -5473,15 +5515,17 @@ void UGMC_ReplicationCmp::ComputeSmoothingParams(
         return;
       }
 
-      for (int32 Index = MoveHistoryNum - 2; Index >= 0; --Index)
+      // The newest move is not older than the simulation time, so the start move is at most the second newest one.
+      const int32 FirstNewerIndex = MoveHistory.PartitionPoint([InSimTime, bInServerAuthPhysics](const FGMC_Move& Move) {
+        gmc_ck(bInServerAuthPhysics ? Move.MetaData.ServerAuthPhysicsTimestamp > 0. : true)
+        return (bInServerAuthPhysics ? Move.MetaData.ServerAuthPhysicsTimestamp : Move.MetaData.Timestamp) <= InSimTime;
+      });
+      const int32 Index = FMath::Min(FirstNewerIndex - 1, MoveHistoryNum - 2);
+      if (Index >= 0)
       {
-        gmc_ck(bInServerAuthPhysics ? MoveHistory[Index].MetaData.ServerAuthPhysicsTimestamp > 0. : true)
-        if ((bInServerAuthPhysics ? MoveHistory[Index].MetaData.ServerAuthPhysicsTimestamp : MoveHistory[Index].MetaData.Timestamp) <= InSimTime)
-        {
-          OutStartIdx = Index;
-          OutTargetIdx = Index + 1;
-          return;
-        }
+        OutStartIdx = Index;
+        OutTargetIdx = Index + 1;
+        return;
       }
 
       GMC_LOG(
@@ -5785,6 +5829,7 @@ void UGMC_ReplicationCmp::AddToSimulationHistory(const FGMC_Move& Move)
   // If the history has already reached the max size the oldest move will be overwritten.
   MoveHistory.Add(Move);
   gmc_ck(MoveHistory.Num() <= MoveHistoryMaxSize)
+  OnMoveAddedToHistory();
 
   CALL_NATIVE_EVENT_CONDITIONAL(bNoBlueprintEvents, this, OnSimulationMoveEnqueued, MoveHistory.Last());
 }
@@ -5900,22 +5945,29 @@ TArray<AGMC_Pawn*> UGMC_ReplicationCmp::GatherRollbackPawns() const
   gmc_ck(bRollBackServerPawns || bRollBackClientPawns)
   gmc_ck(bUseClientPrediction)
 
-  TArray<AActor*> Actors{};
+  TArray<APawn*> Pawns{};
 
   if (IsValid(GMCAggregator))
   {
-    Actors = static_cast<const TArray<AActor*>>(GMCAggregator->GetPawns());
+    // Pawns outside the rollback radius are rejected by ShouldRollBackGMCPawn anyway, so only query the ones nearby instead of walking all of them.
+    GMCAggregator->GetPawnsInRadius(GetActorLocation_GMC(), GetPawnRollbackRadius(), Pawns);
   }
   else
   {
+    TArray<AActor*> Actors{};
     UGameplayStatics::GetAllActorsOfClass(GetWorld(), AGMC_Pawn::StaticClass(), Actors);
+    Pawns.Reserve(Actors.Num());
+    for (const auto& Actor : Actors)
+    {
+      Pawns.Emplace(Cast<APawn>(Actor));
+    }
   }
 
   TArray<AGMC_Pawn*> RollbackPawns{};
 
-  for (const auto& Actor : Actors)
+  for (const auto& Pawn : Pawns)
   {
-    const auto& GMCPawn = Cast<AGMC_Pawn>(Actor);
+    const auto& GMCPawn = Cast<AGMC_Pawn>(Pawn);
 
     if (!IsValid(GMCPawn) || !CALL_NATIVE_EVENT_CONDITIONAL(bNoBlueprintEvents, this, ShouldRollBackGMCPawn, GMCPawn))
     {
@@ -5933,6 +5985,22 @@ TArray<AGMC_Pawn*> UGMC_ReplicationCmp::GatherRollbackPawns() const
   return RollbackPawns;
 }
 
+double UGMC_ReplicationCmp::GetPawnRollbackRadius() const
+{
+  const double ConfiguredRadius = IsServerPawn() ? ServerPawnRollbackRadius : ClientPawnRollbackRadius;
+  const double MaxSpeed = GetMaxSpeed();
+  if (!bDerivePawnRollbackRadius || MaxSpeed <= 0. || !IsValid(GMCAggregator))
+  {
+    // Without max speeds to derive from (the aggregator knows the ones of the other pawns) the configured radius is used as is.
+    return ConfiguredRadius;
+  }
+
+  // Both this pawn and the fastest other pawn may have closed the distance during the rewound time span.
+  const double MaxOtherSpeed = FMath::Max(GMCAggregator->GetMaxPawnSpeed(), MaxSpeed);
+  const double MaxDisplacement = (MaxSpeed + MaxOtherSpeed) * PawnRollbackRewindWindow;
+  return FMath::Min(ConfiguredRadius, MaxDisplacement + PawnRollbackRadiusPadding);
+}
+
 bool UGMC_ReplicationCmp::ShouldRollBackGMCPawn_Implementation(const AGMC_Pawn* PawnToTest) const
 {
   SCOPE_CYCLE_COUNTER(STAT_ShouldRollBackGMCPawn)
@@ -5971,7 +6039,7 @@ bool UGMC_ReplicationCmp::ShouldRollBackGMCPawn_Implementation(const AGMC_Pawn*
     return false;
   }
 
-  const float ConsiderationRadius = IsServerPawn() ? ServerPawnRollbackRadius : ClientPawnRollbackRadius;
+  const double ConsiderationRadius = GetPawnRollbackRadius();
   if ((PawnToTest->GetActorLocation() - GetActorLocation_GMC()).Size() > ConsiderationRadius)
   {
     // The considered pawn is further away than the set threshold.
@@ -6042,7 +6110,7 @@ void UGMC_ReplicationCmp::RollBackPawns(double Time, const TArray<AGMC_Pawn*>& P
     int32 StartIdx{-1};
     int32 TargetIdx{-1};
     float Alpha{-1.f};
-    if (!ComputeRollbackParams(OwningConnection, SimulationTime, MoveHistoryOther, StartIdx, TargetIdx, Alpha))
+    if (!ComputeRollbackParams(OwningConnection, SimulationTime, ReplicationComponent, StartIdx, TargetIdx, Alpha))
     {
       GMC_LOG(
         LogGMCReplication,
@@ -6158,7 +6226,7 @@ double UGMC_ReplicationCmp::ComputeRollbackSimulationTime(
 bool UGMC_ReplicationCmp::ComputeRollbackParams(
   APlayerController* Connection,
   double Time,
-  const TGMC_CircularArray<FGMC_Move>& MoveHistoryToSearch,
+  const UGMC_ReplicationCmp* const OtherReplicationComponent,
   int32& OutStartIdx,
   int32& OutTargetIdx,
   float& OutAlpha
@@ -6170,32 +6238,29 @@ bool UGMC_ReplicationCmp::ComputeRollbackParams(
   gmc_ck(OutAlpha == -1.f)
   gmc_ck(OutStartIdx == -1)
   gmc_ck(OutTargetIdx == -1)
+  gmc_ck(OtherReplicationComponent)
 
   if (!IsValid(Connection))
   {
     return false;
   }
 
+  const auto& MoveHistoryToSearch = OtherReplicationComponent->MoveHistory;
   const int32 HistoryNum = MoveHistoryToSearch.Num();
   int32 Index{0};
 
+  // On the server only moves that were replicated to the owning client can be used, without a receiver ring none were.
+  const FGMC_MoveReceiverRing* const Receivers = IsServerPawn() ? OtherReplicationComponent->SV_FindMoveReceivers(Connection) : nullptr;
+
   if (IsServerPawn())
   {
     // This branch is usually run for regular move execution on the server (if rollback is enabled) but it may also be entered in another context when the user
     // rewinds a server pawn manually.
 
-    // It is very likely that we need recent moves so we go through the history from newest to oldest.
-    for (Index = HistoryNum - 1; Index >= 0; --Index)
+    // Find the newest move that is not newer than the passed time, from there go back to the newest one that was also replicated to the owning client.
+    for (Index = Receivers ? OtherReplicationComponent->FindLatestMoveIndexAtOrBefore(Time, true) : -1; Index >= 0; --Index)
     {
-      const auto& Move = MoveHistoryToSearch[Index];
-      const double Timestamp = Move.MetaData.bIsUsingServerAuthPhysics ? Move.MetaData.ServerAuthPhysicsTimestamp : Move.MetaData.Timestamp;
-
-      if (Timestamp > Time)
-      {
-        continue;
-      }
-
-      if (!Move.NetInfo.ClientReceivers.Contains(Connection))
+      if (!Receivers->WasReceived(MoveHistoryToSearch.GetSequenceNumber(Index)))
       {
         continue;
       }
@@ -6209,19 +6274,8 @@ bool UGMC_ReplicationCmp::ComputeRollbackParams(
     gmc_ck(IsAutonomousProxy())
     gmc_ck(bRollBackClientPawns)
 
-    for (Index = HistoryNum - 1; Index >= 0; --Index)
-    {
-      const auto& Move = MoveHistoryToSearch[Index];
-      const double Timestamp = Move.MetaData.bIsUsingServerAuthPhysics ? Move.MetaData.ServerAuthPhysicsTimestamp : Move.MetaData.Timestamp;
-
-      if (Timestamp > Time)
-      {
-        continue;
-      }
-
-      OutStartIdx = Index;
-      break;
-    }
+    Index = OtherReplicationComponent->FindLatestMoveIndexAtOrBefore(Time, true);
+    OutStartIdx = Index;
   }
 
   if (Index < 0)
@@ -6244,19 +6298,18 @@ bool UGMC_ReplicationCmp::ComputeRollbackParams(
     // replicated to the owning client.
     while (++Index < HistoryNum)
     {
-      const auto& TargetMove = MoveHistoryToSearch[Index];
-
-      if (!TargetMove.NetInfo.ClientReceivers.Contains(Connection))
+      gmc_ck(Receivers)
+      if (!Receivers->WasReceived(MoveHistoryToSearch.GetSequenceNumber(Index)))
       {
         continue;
       }
 
+      const auto& TargetMove = MoveHistoryToSearch[Index];
+
       OutTargetIdx = Index;
       const auto& StartMove = MoveHistoryToSearch[OutStartIdx];
-      const double StartTimestamp =
-        StartMove.MetaData.bIsUsingServerAuthPhysics ? StartMove.MetaData.ServerAuthPhysicsTimestamp : StartMove.MetaData.Timestamp;
-      const double TargetTimestamp =
-        TargetMove.MetaData.bIsUsingServerAuthPhysics ? TargetMove.MetaData.ServerAuthPhysicsTimestamp : TargetMove.MetaData.Timestamp;
+      const double StartTimestamp = GetRollbackTimestamp(StartMove);
+      const double TargetTimestamp = GetRollbackTimestamp(TargetMove);
       OutAlpha = (Time - StartTimestamp) / FMath::Max(TargetTimestamp - StartTimestamp, MIN_DELTA_TIME);
       gmc_ck(OutAlpha >= 0.f)
       gmc_ck(OutAlpha <= 1.f + UE_KINDA_SMALL_NUMBER)
@@ -6275,10 +6328,8 @@ bool UGMC_ReplicationCmp::ComputeRollbackParams(
       OutTargetIdx = Index;
       const auto& StartMove = MoveHistoryToSearch[OutStartIdx];
       const auto& TargetMove = MoveHistoryToSearch[OutTargetIdx];
-      const double StartTimestamp =
-        StartMove.MetaData.bIsUsingServerAuthPhysics ? StartMove.MetaData.ServerAuthPhysicsTimestamp : StartMove.MetaData.Timestamp;
-      const double TargetTimestamp =
-        TargetMove.MetaData.bIsUsingServerAuthPhysics ? TargetMove.MetaData.ServerAuthPhysicsTimestamp : TargetMove.MetaData.Timestamp;
+      const double StartTimestamp = GetRollbackTimestamp(StartMove);
+      const double TargetTimestamp = GetRollbackTimestamp(TargetMove);
       OutAlpha = (Time - StartTimestamp) / FMath::Max(TargetTimestamp - StartTimestamp, MIN_DELTA_TIME);
       gmc_ck(OutAlpha >= 0.f)
       gmc_ck(OutAlpha <= 1.f + UE_KINDA_SMALL_NUMBER)
@@ -6466,15 +6517,25 @@ void UGMC_ReplicationCmp::RestoreRolledBackPawns(const TArray<AGMC_Pawn*>& Pawns
 }
 
 FGMC_Move UGMC_ReplicationCmp::FindMove(double Timestamp) const
+{
+  if (const FGMC_Move* Move = FindMovePtr(Timestamp))
+  {
+    return *Move;
+  }
+
+  return FGMC_Move{};
+}
+
+const FGMC_Move* UGMC_ReplicationCmp::FindMovePtr(double Timestamp) const
 {
   const int32 Index = FindMoveByIndex(Timestamp);
 
   if (IsValidMoveHistoryIndex(Index))
   {
-    return MoveHistory[Index];
+    return &MoveHistory[Index];
   }
 
-  return FGMC_Move{};
+  return nullptr;
 }
 
 int32 UGMC_ReplicationCmp::FindMoveByIndex(double Timestamp) const
@@ -6490,48 +6551,119 @@ int32 UGMC_ReplicationCmp::FindMoveByIndex(double Timestamp) const
     return -1;
   }
 
-  // It is more likely that a recent move is requested so we go through the history from newest to oldest.
-  double PrevMoveTimestamp = -1.;
-  for (int32 Index = MoveHistoryNum - 1; Index >= 0; --Index)
+  const int32 Index = FindLatestMoveIndexAtOrBefore(Timestamp, false);
+  if (Index == -1)
   {
-    const auto& Move = MoveHistory[Index];
+    // The passed timestamp is farther in the past than the oldest saved move in the move history.
+    return -1;
+  }
 
-    gmc_ck(Move.HasValidTimestamp())
-    const double MoveTimestamp = Move.MetaData.Timestamp;
+  const double MoveTimestamp = MoveHistory[Index].MetaData.Timestamp;
+  gmc_ck(MoveTimestamp <= Timestamp)
 
-    if (MoveTimestamp == Timestamp)
-    {
-      return Index;
-    }
+  const int32 NextIndex = Index + 1;
+  if (MoveTimestamp == Timestamp || !IsValidMoveHistoryIndex(NextIndex))
+  {
+    return Index;
+  }
+
+  const double NextMoveTimestamp = MoveHistory[NextIndex].MetaData.Timestamp;
+  gmc_ck(NextMoveTimestamp > Timestamp)
+
+  const double CurrMoveDiff = Timestamp - MoveTimestamp;
+  const double NextMoveDiff = NextMoveTimestamp - Timestamp;
+  gmc_ck(CurrMoveDiff > 0.)
+  gmc_ck(NextMoveDiff > 0.)
+
+  return CurrMoveDiff <= NextMoveDiff ? Index : NextIndex;
+}
+
+FGMC_MoveReceiverRing& UGMC_ReplicationCmp::SV_GetMoveReceivers(const AActor* const TargetConnection)
+{
+  gmc_ck(IsValid(TargetConnection))
 
-    if (MoveTimestamp > Timestamp)
+  FGMC_MoveReceiverRing* Receivers = SV_MoveReceivers.Find(TargetConnection);
+  if (!Receivers)
+  {
+    // A new connection is a good opportunity to drop the rings of connections that are gone.
+    for (auto It = SV_MoveReceivers.CreateIterator(); It; ++It)
     {
-      PrevMoveTimestamp = MoveTimestamp;
-      continue;
+      if (!It->Key.IsValid())
+      {
+        It.RemoveCurrent();
+      }
     }
 
-    gmc_ck(MoveTimestamp < Timestamp)
+    Receivers = &SV_MoveReceivers.Add(TargetConnection);
+  }
+
+  if (Receivers->GetSize() != MoveHistoryMaxSize)
+  {
+    Receivers->Init(MoveHistoryMaxSize);
+  }
+
+  return *Receivers;
+}
+
+const FGMC_MoveReceiverRing* UGMC_ReplicationCmp::SV_FindMoveReceivers(const AActor* const TargetConnection) const
+{
+  return SV_MoveReceivers.Find(TargetConnection);
+}
 
-    if (PrevMoveTimestamp == -1.)
+double UGMC_ReplicationCmp::GetRollbackTimestamp(const FGMC_Move& Move)
+{
+  return Move.MetaData.bIsUsingServerAuthPhysics ? Move.MetaData.ServerAuthPhysicsTimestamp : Move.MetaData.Timestamp;
+}
+
+int32 UGMC_ReplicationCmp::FindLatestMoveIndexAtOrBefore(double Time, bool bUseRollbackTimestamp) const
+{
+  if (bUseRollbackTimestamp && HasMixedRollbackTimestamps())
+  {
+    // Client and server auth physics timestamps are not comparable, go through the history from newest to oldest.
+    for (int32 Index = MoveHistory.Num() - 1; Index >= 0; --Index)
     {
-      return Index;
+      gmc_ck(MoveHistory[Index].HasValidTimestamp())
+      if (GetRollbackTimestamp(MoveHistory[Index]) <= Time)
+      {
+        return Index;
+      }
     }
+    return -1;
+  }
 
-    gmc_ck(PrevMoveTimestamp > Timestamp)
+  const int32 FirstNewerIndex = MoveHistory.PartitionPoint([Time, bUseRollbackTimestamp](const FGMC_Move& Move) {
+    gmc_ck(Move.HasValidTimestamp())
+    return (bUseRollbackTimestamp ? GetRollbackTimestamp(Move) : Move.MetaData.Timestamp) <= Time;
+  });
+  return FirstNewerIndex - 1;
+}
 
-    const double CurrMoveDiff = Timestamp - MoveTimestamp;
-    const double PrevMoveDiff = PrevMoveTimestamp - Timestamp;
-    gmc_ck(CurrMoveDiff > 0.)
-    gmc_ck(PrevMoveDiff > 0.)
+bool UGMC_ReplicationCmp::HasMixedRollbackTimestamps() const
+{
+  return MoveHistory.Num() > 0 && RollbackTimestampSwitchSequence > MoveHistory.GetSequenceNumber(0);
+}
 
-    const int32 PrevIndex = Index + 1;
-    gmc_ck(IsValidMoveHistoryIndex(PrevIndex))
+void UGMC_ReplicationCmp::OnMoveAddedToHistory()
+{
+  const int32 MoveHistoryNum = MoveHistory.Num();
+  gmc_ck(MoveHistoryNum > 0)
 
-    return CurrMoveDiff <= PrevMoveDiff ? Index : PrevIndex;
+  if (MoveHistoryNum < 2)
+  {
+    return;
   }
 
-  // The passed timestamp is farther in the past than the oldest saved move in the move history.
-  return -1;
+  const auto& NewMove = MoveHistory.Last();
+  const auto& PreviousMove = MoveHistory.Last(1);
+  if (NewMove.MetaData.bIsUsingServerAuthPhysics != PreviousMove.MetaData.bIsUsingServerAuthPhysics)
+  {
+    RollbackTimestampSwitchSequence = MoveHistory.GetSequenceNumber(MoveHistoryNum - 1);
+  }
+  else
+  {
+    // Within one kind the rollback timestamps must keep the order of the history for the binary search.
+    gmc_ck(GetRollbackTimestamp(PreviousMove) <= GetRollbackTimestamp(NewMove))
+  }
 }
 
 bool UGMC_ReplicationCmp::SV_GetRewindParams(
@@ -6586,7 +6718,7 @@ bool UGMC_ReplicationCmp::SV_GetRewindParams(
 
   const double SimulationTime = ComputeRollbackSimulationTime(Time, Connection, Pawn, PawnReplicationComponent);
 
-  if (!ComputeRollbackParams(Connection, SimulationTime, PawnMoveHistory, OutStartIdx, OutTargetIdx, OutAlpha))
+  if (!ComputeRollbackParams(Connection, SimulationTime, PawnReplicationComponent, OutStartIdx, OutTargetIdx, OutAlpha))
   {
     GMC_LOG(LogGMCReplication, PawnOwner, Warning, TEXT("GetRewindParams failed: No moves found."))
     return false;
@@ -6652,7 +6784,7 @@ bool UGMC_ReplicationCmp::SV_RewindPawn(APlayerController* Connection, double Ti
   int32 StartIdx{-1};
   int32 TargetIdx{-1};
   float Alpha{-1.f};
-  if (!ComputeRollbackParams(Connection, SimulationTime, PawnMoveHistory, StartIdx, TargetIdx, Alpha))
+  if (!ComputeRollbackParams(Connection, SimulationTime, PawnReplicationComponent, StartIdx, TargetIdx, Alpha))
   {
     GMC_LOG(LogGMCReplication, PawnOwner, Warning, TEXT("Rewind failed: No moves found."))
     return false;
@@ -8312,13 +8444,13 @@ bool FGMC_Move::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
     gmc_ck(IsValid(TargetConnection))
     gmc_ck(Cast<APlayerController>(TargetConnection))
 
-    // Add the receiver to the latest move in the history (which is the one that is currently being serialized).
-    auto& MoveHistory = NetInfo.OwningComponent->MoveHistory;
+    // Mark the latest move in the history (which is the one that is currently being serialized) as received by the target connection.
+    const auto& MoveHistory = NetInfo.OwningComponent->MoveHistory;
     const int32 LastIdx = MoveHistory.Num() - 1;
     gmc_ck(LastIdx >= 0)
 
-    // It is possible that the receiver is already in the map (in case of a replication retry).
-    MoveHistory[LastIdx].NetInfo.ClientReceivers.FindOrAdd(TargetConnection);
+    // It is possible that the move was already marked (in case of a replication retry).
+    NetInfo.OwningComponent->SV_GetMoveReceivers(TargetConnection).MarkReceived(MoveHistory.GetSequenceNumber(LastIdx));
     gmc_ck(MoveHistory[LastIdx].MetaData.Timestamp == MetaData.Timestamp)
   }
 
@@ -8423,10 +8555,8 @@ bool FGMC_Move::SV_IsNetRelevantFor(const AActor* const TargetConnection)
   return Owner->IsNetRelevantFor(TargetConnection, TargetPawn, ViewLocation);
 }
 
-bool FGMC_Move::SV_BecameNetRelevant(bool bIsNetRelevant, const TGMC_CircularArray<FGMC_Move>& MoveHistory, const AActor* const TargetConnection)
+bool FGMC_Move::SV_BecameNetRelevant(bool bIsNetRelevant, const TGMC_CircularArray<FGMC_Move>& MoveHistory, const FGMC_MoveReceiverRing& Receivers)
 {
-  gmc_ck(IsValid(TargetConnection))
-
   const int32 MoveHistoryNum = MoveHistory.Num();
   if (MoveHistoryNum < 2)
   {
@@ -8436,18 +8566,15 @@ bool FGMC_Move::SV_BecameNetRelevant(bool bIsNetRelevant, const TGMC_CircularArr
 
   // Find the latest move previously serialized to the target connection and check if the net relevancy has changed since then. The move that is currently being
   // serialized is the latest one in the move history so we must skip it.
-  const int32 PreviousMoveIndex = MoveHistoryNum - 2;
-  for (int32 Index = PreviousMoveIndex; Index >= 0; --Index)
+  const int64 PreviousMoveSequence = Receivers.GetLatestReceivedBefore(MoveHistory.GetSequenceNumber(MoveHistoryNum - 1));
+  if (PreviousMoveSequence < MoveHistory.GetSequenceNumber(0))
   {
-    const auto& Move = MoveHistory[Index];
-    if (Move.NetInfo.ClientReceivers.Contains(TargetConnection))
-    {
-      const bool bWasNetRelevantPreviously = Move.NetInfo.ClientReceivers[TargetConnection].bWasNetRelevant;
-      return !bWasNetRelevantPreviously && bIsNetRelevant;
-    }
+    // No previous move left in the move history was serialized to the target connection.
+    return true;
   }
 
-  return true;
+  const bool bWasNetRelevantPreviously = Receivers.WasNetRelevant(PreviousMoveSequence);
+  return !bWasNetRelevantPreviously && bIsNetRelevant;
 }
 
 void FGMC_Move::NetSerializeClientMove(FArchive& Ar, UPackageMap* Map, const AActor* const TargetConnection)
@@ -8686,16 +8813,20 @@ void FGMC_Move::NetSerializeSimulatedProxyState(FArchive& Ar, UPackageMap* Map,
   {
     const bool bIsNetRelevant = SV_IsNetRelevantFor(TargetConnection);
 
-    // Set net relevancy in the move history for the last saved move (which is the one that's being serialized right now).
-    auto& MoveHistory = NetInfo.OwningComponent->MoveHistory;
+    // Set net relevancy for the last saved move (which is the one that's being serialized right now).
+    const auto& MoveHistory = NetInfo.OwningComponent->MoveHistory;
     gmc_ck(MoveHistory.Num() > 0)
-    gmc_ck(MoveHistory.Last().NetInfo.ClientReceivers.Contains(TargetConnection))
-    MoveHistory.Last().NetInfo.ClientReceivers[TargetConnection].bWasNetRelevant = bIsNetRelevant;
+    const int64 MoveSequence = MoveHistory.GetSequenceNumber(MoveHistory.Num() - 1);
+    auto& Receivers = NetInfo.OwningComponent->SV_GetMoveReceivers(TargetConnection);
+    Receivers.SetWasNetRelevant(MoveSequence, bIsNetRelevant);
 
     if (!bForceFullSerialization)
     {
-      bForceFullSerialization |= SV_BecameNetRelevant(bIsNetRelevant, MoveHistory, TargetConnection);
+      bForceFullSerialization |= SV_BecameNetRelevant(bIsNetRelevant, MoveHistory, Receivers);
     }
+
+    SV_NetSerializeSharedSyncData(Ar, Map, TargetConnection, MoveSequence, bForceFullSerialization);
+    return;
   }
 
   NetSerializeSyncData(
@@ -8719,6 +8850,84 @@ void FGMC_Move::NetSerializeSimulatedProxyState(FArchive& Ar, UPackageMap* Map,
   );
 }
 
+void FGMC_Move::SV_NetSerializeSharedSyncData(
+  FArchive& Ar,
+  UPackageMap* Map,
+  const AActor* const TargetConnection,
+  int64 MoveSequence,
+  bool bForceFullSerialization
+)
+{
+  SCOPE_CYCLE_COUNTER(STAT_SV_NetSerializeSharedSyncData)
+
+  gmc_ck(Ar.IsSaving())
+  gmc_ck(NetInfo.NetType == GMCReplication::ESimType::SPMove)
+  gmc_ck(IsValid(TargetConnection))
+
+  auto& Aux = NetInfo.OwningComponent->SV_SimulatedProxySerializationAux;
+  Aux.BeginMove(MoveSequence, *this);
+  int64& BaselineID = Aux.GetBaselineID(TargetConnection);
+
+  if (!Aux.bCanShare)
+  {
+    NetSerializeSyncData(InputState, Ar, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization);
+    NetSerializeSyncData(OutputState, Ar, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization);
+
+    // The connection now has a baseline of its own.
+    BaselineID = Aux.NextBaselineID++;
+    return;
+  }
+
+  if (const auto* const Entry = Aux.FindEntry(bForceFullSerialization, BaselineID))
+  {
+    Ar.SerializeBits(const_cast<uint8*>(Entry->Data.GetData()), Entry->NumBits);
+
+    int32 BitIndex = 0;
+    AdoptSerializedSyncData(InputState, TargetConnection, MetaData, Entry->Record, BitIndex, NetInfo.OwningComponent.Get());
+    AdoptSerializedSyncData(OutputState, TargetConnection, MetaData, Entry->Record, BitIndex, NetInfo.OwningComponent.Get());
+    gmc_ck(BitIndex == Entry->Record.NewValues.Num())
+
+    const bool bSameOutputBaseline = Entry->bOutputIsBaselineIndependent || BaselineID == Entry->InputBaselineID;
+    BaselineID = bSameOutputBaseline ? Entry->OutputBaselineID : Aux.NextBaselineID++;
+
+#if STATS
+    RecordSharedSPSerialization(true, Entry->NumBits);
+#endif
+    return;
+  }
+
+  // Serialize into a separate writer so the bits can be appended to the archives of the other connections as well.
+  FNetBitWriter Writer(Map, 0);
+  Writer.SetEngineNetVer(Ar.EngineNetVer());
+  Writer.SetGameNetVer(Ar.GameNetVer());
+
+  auto& NewEntry = Aux.Entries.AddDefaulted_GetRef();
+  NetSerializeSyncData(InputState, Writer, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization, &NewEntry.Record);
+  NetSerializeSyncData(OutputState, Writer, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization, &NewEntry.Record);
+
+  if (Writer.IsError())
+  {
+    gmc_ckne()
+    Ar.SetError();
+    Aux.Entries.Pop();
+    BaselineID = Aux.NextBaselineID++;
+    return;
+  }
+
+  Ar.SerializeBits(Writer.GetData(), Writer.GetNumBits());
+
+  NewEntry.bForceFullSerialization = bForceFullSerialization;
+  NewEntry.InputBaselineID = BaselineID;
+  NewEntry.OutputBaselineID = BaselineID = Aux.NextBaselineID++;
+  NewEntry.bOutputIsBaselineIndependent = bForceFullSerialization && !NewEntry.Record.bHasSuspendedData;
+  NewEntry.Data = *Writer.GetBuffer();
+  NewEntry.NumBits = Writer.GetNumBits();
+
+#if STATS
+  RecordSharedSPSerialization(false, NewEntry.NumBits);
+#endif
+}
+
 void FGMC_Move::SerializeLinearVelocity(FVector& LinearVelocity, FArchive& Ar, const FGMC_NetInfo& NetInfo, const FGMC_MetaData& MetaData)
 {
   EGMC_FloatPrecision LinearVelocityCompression = ToNativeEnum(NetInfo.OwningComponent->ReplicationSettings.DefaultCompressionSettings.LinearVelocity);
@@ -9183,6 +9392,55 @@ void UGMC_ReplicationCmp::FPredictedClientNetSerializationAux::PreTick(const UGM
   UpdateFrequency = FMath::Min(Outer->PredictedClientNetUpdateFrequency, Outer->PawnOwner->NetUpdateFrequency);
 }
 
+void UGMC_ReplicationCmp::FSimulatedProxySerializationAux::BeginMove(int64 Sequence, const FGMC_Move& Move)
+{
+  if (Sequence == MoveSequence)
+  {
+    return;
+  }
+
+  MoveSequence = Sequence;
+  bCanShare = !HasConnectionDependentSyncData(Move.InputState) && !HasConnectionDependentSyncData(Move.OutputState);
+  Entries.Reset();
+}
+
+int64& UGMC_ReplicationCmp::FSimulatedProxySerializationAux::GetBaselineID(const AActor* const TargetConnection)
+{
+  gmc_ck(IsValid(TargetConnection))
+
+  if (int64* const BaselineID = ConnectionBaselineIDs.Find(TargetConnection))
+  {
+    return *BaselineID;
+  }
+
+  // A new connection is a good opportunity to drop the IDs of connections that are gone.
+  for (auto It = ConnectionBaselineIDs.CreateIterator(); It; ++It)
+  {
+    if (!It->Key.IsValid())
+    {
+      It.RemoveCurrent();
+    }
+  }
+
+  return ConnectionBaselineIDs.Add(TargetConnection, NextBaselineID++);
+}
+
+const UGMC_ReplicationCmp::FSimulatedProxySerializationAux::FEntry* UGMC_ReplicationCmp::FSimulatedProxySerializationAux::FindEntry(
+  bool bForceFullSerialization,
+  int64 InputBaselineID
+) const
+{
+  for (const auto& Entry : Entries)
+  {
+    // A full serialization sends every value no matter what the baseline is.
+    if (Entry.bForceFullSerialization == bForceFullSerialization && (bForceFullSerialization || Entry.InputBaselineID == InputBaselineID))
+    {
+      return &Entry;
+    }
+  }
+  return nullptr;
+}
+
 bool UGMC_ReplicationCmp::FTimestampVerificationAux::ComputeAccumulatedClientTime(double& OutClientTime) const
 {
   OutClientTime = 0.;
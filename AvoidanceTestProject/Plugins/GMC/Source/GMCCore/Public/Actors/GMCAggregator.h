@@ -137,6 +137,23 @@ public:
   UFUNCTION(BlueprintCallable, Category = "General Movement Component")
   const TArray<APawn*>& GetPawns() const;
 
+  /// Returns the registered pawns within the passed radius of a location, in the same order as GetPawns. Pawn locations are bucketed into a uniform grid
+  /// that is rebuilt on the first query of each frame, so a query only visits the pawns in nearby cells instead of every registered pawn.
+  ///
+  /// @param        Location     The centre of the query sphere.
+  /// @param        Radius       The radius of the query sphere.
+  /// @param        OutPawns     The array the pawns within the sphere are appended to.
+  /// @returns      void
+  UFUNCTION(BlueprintCallable, Category = "General Movement Component")
+  void GetPawnsInRadius(const FVector& Location, double Radius, TArray<APawn*>& OutPawns);
+
+  /// Returns the highest max speed of the movement components of all registered pawns. Updated together with the grid used by GetPawnsInRadius, i.e. on the
+  /// first query of each frame.
+  ///
+  /// @returns      double    The highest max speed, 0 if no registered pawn has a movement component.
+  UFUNCTION(BlueprintCallable, Category = "General Movement Component")
+  double GetMaxPawnSpeed();
+
   /// Returns all currently registered movement components.
   ///
   /// @returns      const TArray<UMovementComponent*>&    The array containing all registered movement components.
@@ -194,6 +211,15 @@ public:
   /// Do not toggle at runtime. Some tick group combinations may cause faulty behaviour.
   bool bAggregateMeshComponents{true};
 
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spatial Queries", meta = (ClampMin = "1", UIMin = "500", UIMax = "5000"))
+  /// The edge length of the grid cells used by GetPawnsInRadius. Should be in the order of the typical query radius (e.g. the pawn rollback radius).
+  double PawnGridCellSize{2500.};
+
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spatial Queries", meta = (ClampMin = "0", UIMin = "0", UIMax = "1000"))
+  /// How far a pawn may move between the grid rebuild at its first query of a frame and a later query within the same frame and still be found. Pawns move
+  /// during their own tick, so this should cover the distance the fastest pawn can travel in one frame.
+  double PawnGridMaxStaleDistance{200.};
+
 protected:
 
   /// Determines the order number of the passed controller.
@@ -255,6 +281,26 @@ private:
 
   bool VerifyOrder(int32 CurrentOrderNumber, int32& InOutPreviousOrderNumber) const;
 
+  /// Rebuilds the pawn grid if it was not rebuilt yet this frame or the pawn array changed since.
+  void ConditionalUpdatePawnGrid();
+
+  /// Rebuckets all registered pawns by their current location and updates the max pawn speed.
+  void UpdatePawnGrid();
+
+  FIntPoint GetPawnGridCell(const FVector& Location) const;
+
+  /// Indices into the pawn array, bucketed by grid cell. Only cells that contained pawns at the last rebuild are present.
+  TMap<FIntPoint, TArray<int32, TInlineAllocator<4>>> PawnGrid{};
+
+  /// The highest max speed among the registered pawns at the last rebuild of the pawn grid.
+  double MaxPawnSpeed{0.};
+
+  /// The frame the pawn grid was last rebuilt in.
+  uint64 PawnGridFrame{0};
+
+  /// Set when the pawn array changed since the last rebuild, which invalidates the stored indices.
+  bool bPawnGridDirty{true};
+
   bool bWasEnabledLastFrame{false};
 
   bool bIsFirstUpdate{false};
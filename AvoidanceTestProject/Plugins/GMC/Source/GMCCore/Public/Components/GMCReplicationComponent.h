@@ -33,11 +33,12 @@ struct GMCCORE_API FGMC_Move
   bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
   bool SV_ShouldReplicate();
   bool SV_IsNetRelevantFor(const AActor* const TargetConnection);
-  bool SV_BecameNetRelevant(bool bIsNetRelevant, const TGMC_CircularArray<FGMC_Move>& MoveHistory, const AActor* const TargetConnection);
+  bool SV_BecameNetRelevant(bool bIsNetRelevant, const TGMC_CircularArray<FGMC_Move>& MoveHistory, const FGMC_MoveReceiverRing& Receivers);
 
   void NetSerializeClientMove(FArchive& Ar, UPackageMap* Map, const AActor* const TargetConnection);
   void NetSerializeAutonomousProxyState(FArchive& Ar, UPackageMap* Map, const AActor* const TargetConnection);
   void NetSerializeSimulatedProxyState(FArchive& Ar, UPackageMap* Map, const AActor* const TargetConnection);
+  void SV_NetSerializeSharedSyncData(FArchive& Ar, UPackageMap* Map, const AActor* const TargetConnection, int64 MoveSequence, bool bForceFullSerialization);
   void CopyDataValuesTo(FGMC_Move& Other, UGMC_ReplicationCmp* const Component) const;
   void CopyLastSerializedValuesTo(FGMC_Move& Other, UGMC_ReplicationCmp* const Component) const;
   void CopySuspendedFlagsTo(FGMC_Move& Other, UGMC_ReplicationCmp* const Component) const;
@@ -780,6 +781,14 @@ public:
   UFUNCTION(BlueprintCallable, Category = "General Movement Component")
   int32 FindMoveByIndex(double Timestamp) const;
 
+  /// Version of FindMove that returns a pointer to the move in the move history instead of copying it. Like the index returned by FindMoveByIndex, the pointer
+  /// becomes outdated as soon as the move history is modified.
+  ///
+  /// @param        Timestamp    The timestamp of the move to find.
+  /// @returns      const FGMC_Move*    The move from the move history that most closely matches the passed timestamp, or nullptr if no appropriate move could
+  ///                                   be found.
+  const FGMC_Move* FindMovePtr(double Timestamp) const;
+
   /// Computes rewind parameters according to the passed arguments. This function may be used instead of SV_RewindPawn if you don't want to actually rewind the
   /// pawn but just look at the rewind data numerically. Any relevant preconditions stated in the description of SV_RewindPawn also apply to this function.
   ///
@@ -1759,6 +1768,16 @@ public:
   /// Contains past moves that this pawn has executed. New moves are enqueued at the end (i.e. the most recent move has the highest index).
   TGMC_CircularArray<FGMC_Move> MoveHistory{};
 
+  /// Sequence number of the newest move in the move history whose rollback timestamp is of another kind than the one of the move before it, i.e. the pawn
+  /// switched between server auth physics and regular replication. The history is only ordered by rollback timestamp while this move is not part of it.
+  int64 RollbackTimestampSwitchSequence{-1};
+
+  /// The move that was last acknowledged by the server, swapped out of the move history by CL_ClearAcknowledgedMoves.
+  FGMC_Move CL_AcknowledgedMove{};
+
+  /// Which moves of the move history were serialized to each client connection (server only).
+  TMap<TWeakObjectPtr<const AActor>, FGMC_MoveReceiverRing> SV_MoveReceivers{};
+
   /// The aliases to bind generic data members to.
   FGMC_MemberAliases AliasData{};
 
@@ -2129,6 +2148,58 @@ private:
 
   FPredictedClientNetSerializationAux SV_PredictedClientNetSerializationAux{};
 
+  /// Shares the simulated proxy serialization of the latest move between client connections. The serialized bits only depend on the baseline of a connection
+  /// (i.e. the values last serialized to it) and on whether the serialization is full, so connections with the same baseline get the same bits. Baselines are
+  /// identified by IDs, a connection that receives shared bits moves on to the same baseline ID as the connection they were produced for.
+  struct FSimulatedProxySerializationAux
+  {
+    struct FEntry
+    {
+      bool bForceFullSerialization{false};
+
+      int64 InputBaselineID{-1};
+      int64 OutputBaselineID{-1};
+
+      // A full serialization without suspended data overwrites the entire baseline, so the output baseline is the same for every input baseline.
+      bool bOutputIsBaselineIndependent{false};
+
+      TArray<uint8> Data{};
+      int64 NumBits{0};
+
+      GMCReplication::FSyncDataSerializationRecord Record{};
+    };
+
+    /// The sequence number of the move the entries were serialized from.
+    int64 MoveSequence{-1};
+
+    /// Moves that reference objects are serialized separately for each connection.
+    bool bCanShare{false};
+
+    TArray<FEntry> Entries{};
+
+    TMap<TWeakObjectPtr<const AActor>, int64> ConnectionBaselineIDs{};
+
+    int64 NextBaselineID{0};
+
+    /// Drops the entries of the previous move if the passed one is a different move.
+    void BeginMove(int64 Sequence, const FGMC_Move& Move);
+
+    /// Returns the baseline ID of the passed connection, a connection that did not receive a move yet gets a new one.
+    int64& GetBaselineID(const AActor* const TargetConnection);
+
+    const FEntry* FindEntry(bool bForceFullSerialization, int64 InputBaselineID) const;
+
+    void Reset()
+    {
+      MoveSequence = -1;
+      bCanShare = false;
+      Entries.Reset();
+      ConnectionBaselineIDs.Reset();
+    }
+  };
+
+  FSimulatedProxySerializationAux SV_SimulatedProxySerializationAux{};
+
   struct FTimestampVerificationAux
   {
     static constexpr bool VERIFY_WORLD_TIME = true;
@@ -2421,7 +2492,11 @@ private:
 
   void CL_SendMoves();
 
-  FGMC_Move CL_ClearAcknowledgedMoves(double ReceivedTimestamp);
+  /// Removes all moves up to the received timestamp from the front of the move history.
+  ///
+  /// @param        ReceivedTimestamp    The timestamp of the move acknowledged by the server.
+  /// @returns      FGMC_Move&           The acknowledged move, its timestamp is invalid if it was not found. Only valid until the next call.
+  FGMC_Move& CL_ClearAcknowledgedMoves(double ReceivedTimestamp);
 
   bool CL_CheckPhysicsSettingsSynced(const FGMC_Move& ReplicatedMove) const;
 
@@ -2491,6 +2566,9 @@ private:
 
   TArray<AGMC_Pawn*> GatherRollbackPawns() const;
 
+  /// Returns the radius within which other pawns are considered for rollback by this pawn, see bDerivePawnRollbackRadius.
+  double GetPawnRollbackRadius() const;
+
   void SaveLocalStateBeforeRollback(const APawn* PawnToSave, bool bUseRelative) const;
 
   void RollBackPawns(double Time, const TArray<AGMC_Pawn*>& PawnsToRollBack, EGMC_NetContext Context) const;
@@ -2505,12 +2583,34 @@ private:
   bool ComputeRollbackParams(
     APlayerController* Connection,
     double Time,
-    const TGMC_CircularArray<FGMC_Move>& MoveHistoryToSearch,
+    const UGMC_ReplicationCmp* const OtherReplicationComponent,
     int32& OutStartIdx,
     int32& OutTargetIdx,
     float& OutAlpha
   ) const;
 
+  /// Returns the receiver ring of the passed client connection, which is created on first use.
+  FGMC_MoveReceiverRing& SV_GetMoveReceivers(const AActor* const TargetConnection);
+
+  /// @returns      const FGMC_MoveReceiverRing*    The receiver ring of the passed client connection, or nullptr if no move was serialized to it yet.
+  const FGMC_MoveReceiverRing* SV_FindMoveReceivers(const AActor* const TargetConnection) const;
+
+  /// The timestamp a move is rolled back by, which is the server auth physics timestamp for moves that use server auth physics.
+  static double GetRollbackTimestamp(const FGMC_Move& Move);
+
+  /// Returns the index of the newest move in the move history with a timestamp less than or equal to the passed time, or -1 if all moves are newer. The move
+  /// history is ordered by timestamp so this is a binary search. Rollback timestamps are only ordered as long as the history does not mix moves with and
+  /// without server auth physics, otherwise the history is scanned from the newest move backwards.
+  ///
+  /// @param        bUseRollbackTimestamp    Compare the rollback timestamp of the moves (@see GetRollbackTimestamp) instead of their regular timestamp.
+  int32 FindLatestMoveIndexAtOrBefore(double Time, bool bUseRollbackTimestamp) const;
+
+  /// Whether the move history contains moves with and without server auth physics, @see RollbackTimestampSwitchSequence.
+  bool HasMixedRollbackTimestamps() const;
+
+  /// Must be called after a move was added to the move history to keep track of switches of the rollback timestamp kind.
+  void OnMoveAddedToHistory();
+
   void SetRollbackState(
     double Time,
     double SimulationTime,
@@ -3396,6 +3496,23 @@ public:
   /// If client pawn rollback is enabled, this is the radius of a sphere around the pawn within which other pawns will be considered for rollback on the client.
   double ClientPawnRollbackRadius{2500.};
 
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Networking|Lag Compensation")
+  /// When enabled, the pawn rollback radius is derived from how far pawns can move over the rewind window: this pawn and the fastest pawn registered with the GMC
+  /// aggregator moving towards each other at max speed for PawnRollbackRewindWindow seconds, plus PawnRollbackRadiusPadding. The server and client pawn rollback
+  /// radii above still act as an upper bound. Pawns further away cannot have interacted with this pawn during the rewound time span, so they are neither saved
+  /// nor rolled back. Only pawns registered with the GMC aggregator benefit from the spatial lookup, without an aggregator the configured radius is used and all
+  /// pawns in the world are still tested individually.
+  bool bDerivePawnRollbackRadius{false};
+
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Networking|Lag Compensation", meta = (ClampMin = "0", UIMin = "0.1", UIMax = "1", EditCondition = "bDerivePawnRollbackRadius"))
+  /// The longest time span in seconds that pawns are rolled back by, i.e. the highest client latency plus interpolation delay that should still be fully
+  /// compensated.
+  float PawnRollbackRewindWindow{0.5f};
+
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Networking|Lag Compensation", meta = (ClampMin = "0", UIMin = "0", UIMax = "1000", EditCondition = "bDerivePawnRollbackRadius"))
+  /// Added to the derived pawn rollback radius to account for the extents of the colliding pawns.
+  double PawnRollbackRadiusPadding{200.};
+
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Networking|Lag Compensation", meta = (ClampMin = "0", UIMin = "100", UIMax = "5000"))
   /// If generic server actor rollback is enabled, this is the radius of a sphere around the pawn within which actors will be considered for rollback on the
   /// server.
@@ -141,12 +141,15 @@ private:
   TArray<T> Buffer{};
 };
 
+/// Fixed capacity ring of elements. The logical element 0 is the oldest one at the head, adding to a full array overwrites it. Removing elements from the front
+/// only advances the head, the removed elements stay alive in their slots and are assigned to again by later adds so any memory they own can be reused.
 template<typename T>
 struct TGMC_CircularArray
 {
   void Reset(int32 InMaxSize)
   {
-    Offset = 0;
+    Head = 0;
+    NumElements = 0;
     MaxSize = InMaxSize;
     Container.Empty(MaxSize);
     gmc_ck(Container.Max() == MaxSize)
@@ -154,21 +157,36 @@ struct TGMC_CircularArray
 
   int32 Num() const
   {
-    return Container.Num();
+    return NumElements;
+  }
+
+  bool IsEmpty() const
+  {
+    return NumElements == 0;
+  }
+
+  T& First()
+  {
+    return (*this)[0];
+  }
+
+  const T& First() const
+  {
+    return (*this)[0];
   }
 
   T& Last(int32 IndexFromEnd = 0)
   {
     gmc_ck(IndexFromEnd >= 0)
-    gmc_ck(Container.Num() > IndexFromEnd)
-    return (*this)[Container.Num() - 1 - IndexFromEnd];
+    gmc_ck(NumElements > IndexFromEnd)
+    return (*this)[NumElements - 1 - IndexFromEnd];
   }
 
   const T& Last(int32 IndexFromEnd = 0) const
   {
     gmc_ck(IndexFromEnd >= 0)
-    gmc_ck(Container.Num() > IndexFromEnd)
-    return (*this)[Container.Num() - 1 - IndexFromEnd];
+    gmc_ck(NumElements > IndexFromEnd)
+    return (*this)[NumElements - 1 - IndexFromEnd];
   }
 
   void Add(T&& Item)
@@ -183,17 +201,59 @@ struct TGMC_CircularArray
     Emplace(Item);
   }
 
-  T& operator[](int32 Index)
+  /// Removes the Count oldest elements in O(1).
+  void PopFront(int32 Count = 1)
+  {
+    gmc_ck(Count >= 0)
+    gmc_ck(Count <= NumElements)
+    NumElements -= Count;
+    Head += Count;
+    if (Head >= MaxSize)
+    {
+      Head -= MaxSize;
+    }
+  }
+
+  /// Returns the index of the first element the predicate does not hold for, or Num() if it holds for all of them. The elements must be partitioned with
+  /// respect to the predicate, e.g. it compares a timestamp the elements are ordered by. O(log n).
+  template<typename PredicateType>
+  int32 PartitionPoint(PredicateType Predicate) const
+  {
+    int32 Low = 0;
+    int32 Count = NumElements;
+    while (Count > 0)
+    {
+      const int32 Step = Count / 2;
+      const int32 Index = Low + Step;
+      if (Predicate((*this)[Index]))
+      {
+        Low = Index + 1;
+        Count -= Step + 1;
+      }
+      else
+      {
+        Count = Step;
+      }
+    }
+    return Low;
+  }
+
+  /// Returns the sequence number of the element at the passed index. Every added element gets the next number in order, numbers are never reused for the same
+  /// array, not even after a reset.
+  int64 GetSequenceNumber(int32 Index) const
   {
     gmc_ck(Index >= 0)
-    gmc_ck(Index < Container.Num())
+    gmc_ck(Index < NumElements)
+    return NextSequenceNumber - NumElements + Index;
+  }
+
+  T& operator[](int32 Index)
+  {
     return Container[GetInternalIndex(Index)];
   }
 
   const T& operator[](int32 Index) const
   {
-    gmc_ck(Index >= 0)
-    gmc_ck(Index < Container.Num())
     return Container[GetInternalIndex(Index)];
   }
 
@@ -202,35 +262,49 @@ private:
   int32 GetInternalIndex(int32 Index) const
   {
     gmc_ck(Index >= 0)
-    gmc_ck(Index < Container.Num())
-    return Container.Num() < MaxSize ? Index : (Offset + Index) % MaxSize;
+    gmc_ck(Index < NumElements)
+    // While the container is still growing the elements end at its last slot, so the sum never wraps.
+    const int32 InternalIndex = Head + Index;
+    return InternalIndex < MaxSize ? InternalIndex : InternalIndex - MaxSize;
   }
 
-  template <typename... U>
-  void Emplace(U&&... Args)
+  template <typename U>
+  void Emplace(U&& Item)
   {
-    if (Container.Num() < MaxSize)
+    if (NumElements == MaxSize)
     {
-      Container.Emplace(Forward<U>(Args)...);
+      // Overwrite the oldest element.
+      Container[Head] = Forward<U>(Item);
+      if (++Head == MaxSize)
+      {
+        Head = 0;
+      }
     }
     else
     {
-      Container[Offset] = T(Forward<U>(Args)...);
-      gmc_ck(Container.Num() == MaxSize)
-    }
-
-    if (++Offset == MaxSize)
-    {
-      gmc_ck(Container.Num() == MaxSize)
-      gmc_ck(Container.Num() == Offset)
-      Offset = 0;
+      const int32 Tail = Head + NumElements < MaxSize ? Head + NumElements : Head + NumElements - MaxSize;
+      if (Tail == Container.Num())
+      {
+        gmc_ck(Container.Num() < MaxSize)
+        Container.Emplace(Forward<U>(Item));
+      }
+      else
+      {
+        gmc_ck(Container.Num() == MaxSize)
+        Container[Tail] = Forward<U>(Item);
+      }
+      ++NumElements;
     }
+    ++NextSequenceNumber;
 
     gmc_ck(Container.Max() == MaxSize)
-    gmc_ck(Container.Num() < MaxSize ? Container.Num() == Offset : true)
+    gmc_ck(Container.Num() < MaxSize ? Head + NumElements == Container.Num() : true)
   }
 
-  int32 Offset{0};
+  /// Internal index of the oldest element.
+  int32 Head{0};
+  int32 NumElements{0};
   int32 MaxSize{0};
+  int64 NextSequenceNumber{0};
   TArray<T> Container{};
 };
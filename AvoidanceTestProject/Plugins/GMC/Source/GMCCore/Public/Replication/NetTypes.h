@@ -5,14 +5,6 @@
 #include "SyncMeta.h"
 #include "NetTypes.generated.h"
 
-USTRUCT(BlueprintType)
-struct FGMC_ClientInfo
-{
-  GENERATED_BODY()
-
-  bool bWasNetRelevant{false};
-};
-
 USTRUCT(BlueprintType)
 struct FGMC_NetInfo
 {
@@ -21,8 +13,96 @@ struct FGMC_NetInfo
   GMCReplication::ESimType NetType{};
 
   TWeakObjectPtr<class UGMC_ReplicationCmp> OwningComponent{};
+};
 
-  TMap<TWeakObjectPtr<const AActor>, FGMC_ClientInfo> ClientReceivers{};
+/// Tracks which moves of a server pawn's move history were serialized to one client connection, and whether the pawn was net relevant for the connection at the
+/// time. Moves are identified by their sequence number in the move history (@see TGMC_CircularArray::GetSequenceNumber) and the ring covers as many moves as
+/// the history can hold, so every lookup is a bit test.
+struct FGMC_MoveReceiverRing
+{
+  void Init(int32 InSize)
+  {
+    gmc_ck(InSize > 0)
+    Received.Init(false, InSize);
+    NetRelevant.Init(false, InSize);
+    NewestSequence = -1;
+    LatestReceivedSequence = -1;
+    PreviousReceivedSequence = -1;
+  }
+
+  int32 GetSize() const
+  {
+    return Received.Num();
+  }
+
+  /// Records that the move with the passed sequence number is being serialized to the connection. Moves are serialized in order, marking the same move again
+  /// (in case of a replication retry) keeps its net relevancy.
+  void MarkReceived(int64 Sequence)
+  {
+    gmc_ck(Sequence >= 0)
+    gmc_ck(Sequence >= NewestSequence)
+
+    if (Sequence > NewestSequence)
+    {
+      // Clear the slots of the moves that were skipped for this connection since the last one, they still hold bits from a previous lap of the ring.
+      const int32 Size = GetSize();
+      for (int64 Skipped = FMath::Max(NewestSequence + 1, Sequence - Size + 1); Skipped <= Sequence; ++Skipped)
+      {
+        const int32 Slot = GetSlot(Skipped);
+        Received[Slot] = false;
+        NetRelevant[Slot] = false;
+      }
+      NewestSequence = Sequence;
+    }
+
+    Received[GetSlot(Sequence)] = true;
+    if (Sequence != LatestReceivedSequence)
+    {
+      PreviousReceivedSequence = LatestReceivedSequence;
+      LatestReceivedSequence = Sequence;
+    }
+  }
+
+  void SetWasNetRelevant(int64 Sequence, bool bWasNetRelevant)
+  {
+    gmc_ck(WasReceived(Sequence))
+    NetRelevant[GetSlot(Sequence)] = bWasNetRelevant;
+  }
+
+  bool WasReceived(int64 Sequence) const
+  {
+    return IsInRing(Sequence) && Received[GetSlot(Sequence)];
+  }
+
+  bool WasNetRelevant(int64 Sequence) const
+  {
+    return WasReceived(Sequence) && NetRelevant[GetSlot(Sequence)];
+  }
+
+  /// @returns      int64    The sequence number of the newest move received before the passed one, or -1 if there is none.
+  int64 GetLatestReceivedBefore(int64 Sequence) const
+  {
+    const int64 LatestBefore = LatestReceivedSequence < Sequence ? LatestReceivedSequence : PreviousReceivedSequence;
+    return IsInRing(LatestBefore) ? LatestBefore : -1;
+  }
+
+private:
+
+  bool IsInRing(int64 Sequence) const
+  {
+    return Sequence >= 0 && Sequence <= NewestSequence && Sequence > NewestSequence - GetSize();
+  }
+
+  int32 GetSlot(int64 Sequence) const
+  {
+    return (int32)(Sequence % GetSize());
+  }
+
+  TBitArray<> Received;
+  TBitArray<> NetRelevant;
+  int64 NewestSequence{-1};
+  int64 LatestReceivedSequence{-1};
+  int64 PreviousReceivedSequence{-1};
 };
 
 USTRUCT(BlueprintType)
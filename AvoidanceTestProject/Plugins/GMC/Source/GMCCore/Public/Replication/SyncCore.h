@@ -25,6 +25,14 @@ struct TSyncTypeData
   FSyncSettings Settings{};
 };
 
+/// What a server to client serialization wrote, so the same bits can be sent to another connection with the same baseline. Holds one bit per data element
+/// that was serialized (i.e. replicated to clients and not suspended) in serialization order, set if the value was sent and became the new baseline.
+struct FSyncDataSerializationRecord
+{
+  TBitArray<> NewValues{};
+  bool bHasSuspendedData{false};
+};
+
 template<typename T>
 struct TMemberAliasData
 {
@@ -32,6 +40,90 @@ struct TMemberAliasData
   FSyncSettings Settings{};
 };
 
+/// Where the generic sync data of a pawn state lives within its data block (@see FSyncDataBlock). Built once per component after the
+/// replication data was bound, all pawn states of the component share the same layout.
+struct FSyncDataLayout
+{
+  int32 Size{0};
+  int32 Alignment{1};
+  bool bFinalized{false};
+
+  /// Reserves space for Num consecutive elements of type TData.
+  /// @returns      int32    The offset of the first element within the data block, -1 if Num is 0.
+  template<typename TData>
+  int32 Append(int32 Num)
+  {
+    gmc_ck(!bFinalized)
+    if (Num == 0)
+    {
+      return INDEX_NONE;
+    }
+
+    const int32 Offset = Align(Size, (int32)alignof(TData));
+    Size = Offset + Num * (int32)sizeof(TData);
+    Alignment = FMath::Max(Alignment, (int32)alignof(TData));
+    return Offset;
+  }
+};
+
+/// Single contiguous allocation holding the generic sync data of one pawn state, so a state costs one heap block no matter how many
+/// members are bound. The block only owns the memory, the sync types construct and destroy their elements within it.
+struct FSyncDataBlock
+{
+  FSyncDataBlock() = default;
+  FSyncDataBlock(const FSyncDataBlock&) = delete;
+  FSyncDataBlock& operator=(const FSyncDataBlock&) = delete;
+
+  ~FSyncDataBlock()
+  {
+    FMemory::Free(Memory);
+  }
+
+  /// Reallocates the block unless it already has the requested size and alignment. Must only be called while no elements are constructed.
+  void Reserve(int32 InSize, int32 InAlignment)
+  {
+    if (InSize == Size && InAlignment == Alignment)
+    {
+      return;
+    }
+
+    FMemory::Free(Memory);
+    Memory = InSize > 0 ? (uint8*)FMemory::Malloc(InSize, InAlignment) : nullptr;
+    Size = InSize;
+    Alignment = InAlignment;
+  }
+
+  void Swap(FSyncDataBlock& Other)
+  {
+    ::Swap(Memory, Other.Memory);
+    ::Swap(Size, Other.Size);
+    ::Swap(Alignment, Other.Alignment);
+  }
+
+  template<typename TData>
+  TData* GetElements(int32 Offset, int32 Num) const
+  {
+    gmc_ck(Offset >= 0 && Offset + Num * (int32)sizeof(TData) <= Size)
+    return reinterpret_cast<TData*>(Memory + Offset);
+  }
+
+  int32 GetSize() const
+  {
+    return Size;
+  }
+
+  int32 GetAlignment() const
+  {
+    return Alignment;
+  }
+
+private:
+
+  uint8* Memory{nullptr};
+  int32 Size{0};
+  int32 Alignment{0};
+};
+
 template<typename T>
 using TUnderlyingSyncTypeReference = decltype(DeclVal<T>().Get());
 
@@ -77,6 +169,11 @@ protected:
     return AliasData.Num();
   }
 
+  int32 GetLayoutOffset() const
+  {
+    return LayoutOffset;
+  }
+
 public:
 
   const UType& Read(int32 Index) const
@@ -96,15 +193,25 @@ public:
 
   void BindMember(UType& VariableToBind, const FSyncSettings& Settings, int32& BindingIndex)
   {
+    // Members can only be bound before the layout is built.
+    gmc_ck(LayoutOffset == INDEX_NONE)
+
     TMemberAliasData<UType> NewData;
     NewData.ValueRef = &VariableToBind;
     NewData.Settings = Settings;
     BindingIndex = AliasData.Emplace(MoveTemp(NewData));
   }
 
+  void AddToLayout(FSyncDataLayout& Layout)
+  {
+    LayoutOffset = Layout.Append<TSyncTypeData<UType>>(AliasData.Num());
+  }
+
 private:
 
   TArray<TMemberAliasData<UType>> AliasData;
+
+  int32 LayoutOffset{INDEX_NONE};
 };
 
 template<typename T>
@@ -336,10 +443,12 @@ public:
     const AActor* const TargetConnection,
     const FGMC_NetInfo& NetInfo,
     const FGMC_MetaData& MetaData,
-    bool bForceFullSerialization
+    bool bForceFullSerialization,
+    FSyncDataSerializationRecord* const Record = nullptr
   )
   {
     gmc_ck(GetSimulationState() == ESimState::Input || GetSimulationState() == ESimState::Output)
+    gmc_ck(!Record || (Ar.IsSaving() && GetSimulationType() == ESimType::SPMove))
 
     switch (GetSimulationType())
     {
@@ -351,7 +460,7 @@ public:
       case ESimType::APMove:
       case ESimType::SPMove:
       {
-        NetSerializeServerToClient(Ar, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization);
+        NetSerializeServerToClient(Ar, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization, Record);
         return;
       }
       default:
@@ -440,6 +549,34 @@ public:
     }
   }
 
+  /// Updates the baseline of the target connection as if the values had been serialized to it, using the record of a serialization of the same values to
+  /// another connection with the same baseline. BitIndex is the position within the record and advanced past the data elements of this type.
+  void AdoptSerializedValues(
+    const AActor* const TargetConnection,
+    const FGMC_MetaData& MetaData,
+    const FSyncDataSerializationRecord& Record,
+    int32& BitIndex,
+    ::UGMC_ReplicationCmp* const Component
+  )
+  {
+    gmc_ck(GetSimulationType() == ESimType::SPMove)
+    gmc_ck(TargetConnection)
+    for (int32 Index = 0; Index < GetNumData(); ++Index)
+    {
+      auto& Data = GetData(Index);
+      if (!ShouldReplicateToClient(GetServerSettings(Data), MetaData.bPredictedClientMove, MetaData.bValidClientMove) || Data.bSuspended)
+      {
+        continue;
+      }
+
+      gmc_ck(BitIndex < Record.NewValues.Num())
+      if (Record.NewValues[BitIndex++])
+      {
+        GetLastSerializedValue(Data, TargetConnection, Component) = Data.Value;
+      }
+    }
+  }
+
   virtual ~TSyncTypeBase() {}
 
 protected:
@@ -952,7 +1089,8 @@ private:
     const AActor* const TargetConnection,
     const FGMC_NetInfo& NetInfo,
     const FGMC_MetaData& MetaData,
-    bool bForceFullSerialization
+    bool bForceFullSerialization,
+    FSyncDataSerializationRecord* const Record
   )
   {
     gmc_ck(GetSimulationType() == ESimType::APMove || GetSimulationType() == ESimType::SPMove)
@@ -972,6 +1110,10 @@ private:
         if (Data.bSuspended)
         {
           Data.bWasSuspended = true;
+          if (Record)
+          {
+            Record->bHasSuspendedData = true;
+          }
           continue;
         }
 
@@ -987,6 +1129,11 @@ private:
           LastSerializedValue = Value;
         }
 
+        if (Record)
+        {
+          Record->NewValues.Add(bNewValue);
+        }
+
         bWasSuspended = false;
       }
     }
@@ -1256,16 +1403,36 @@ struct TSyncTypeMulti : public TSyncTypeBase<T>
 
 protected:
 
-  TSyncTypeData<UType>& GetData(int32 DataIndex) override final { return MultiData[DataIndex]; }
+  TSyncTypeData<UType>& GetData(int32 DataIndex) override final
+  {
+    gmc_ck(DataIndex >= 0 && DataIndex < NumData)
+    return Data[DataIndex];
+  }
 
-  const TSyncTypeData<UType>& GetData(int32 DataIndex) const override final { return MultiData[DataIndex]; }
+  const TSyncTypeData<UType>& GetData(int32 DataIndex) const override final
+  {
+    gmc_ck(DataIndex >= 0 && DataIndex < NumData)
+    return Data[DataIndex];
+  }
 
-  int32 GetNumData() const override final { return MultiData.Num(); }
+  int32 GetNumData() const override final { return NumData; }
 
 public:
 
+  TSyncTypeMulti() = default;
+
+  // The data lives in the data block of the owning pawn state, which copies it (@see FGMC_PawnState).
+  TSyncTypeMulti(const TSyncTypeMulti&) = delete;
+  TSyncTypeMulti& operator=(const TSyncTypeMulti&) = delete;
+
+  ~TSyncTypeMulti()
+  {
+    DestroyData();
+  }
+
   void Initialize(
     const TMemberAlias<T>& Alias,
+    FSyncDataBlock& Block,
     ESimState SimState,
     ESimType SimType,
     ::UGMC_ReplicationCmp* const Component
@@ -1273,16 +1440,76 @@ public:
   {
     this->InitializeBase(SimState, SimType);
 
-    MultiData.Reset();
-    for (int32 Index = 0; Index < Alias.GetNumData(); ++Index)
+    ConstructData(Block, Alias.GetLayoutOffset(), Alias.GetNumData());
+    for (int32 Index = 0; Index < NumData; ++Index)
     {
-      TSyncTypeData<UType> NewData;
+      auto& NewData = Data[Index];
       NewData.Settings = Alias.GetData(Index).Settings;
       this->InitDefault(NewData.Value, Component);
-      MultiData.Emplace(MoveTemp(NewData));
     }
   }
 
+  bool HasSameLayout(const TSyncTypeMulti& Other) const
+  {
+    return LayoutOffset == Other.LayoutOffset && NumData == Other.NumData;
+  }
+
+  /// Copies the data of the same sync type of another pawn state into Block, the data block of the state this belongs to.
+  /// If the layouts match the elements are assigned in place, otherwise all data of the state must have been destroyed beforehand.
+  void CopyData(const TSyncTypeMulti& Other, FSyncDataBlock& Block, bool bSameLayout)
+  {
+    this->InitializeBase(Other.GetSimulationState(), Other.GetSimulationType());
+
+    if (bSameLayout)
+    {
+      gmc_ck(HasSameLayout(Other))
+      for (int32 Index = 0; Index < NumData; ++Index)
+      {
+        Data[Index] = Other.Data[Index];
+      }
+      return;
+    }
+
+    gmc_ck(NumData == 0)
+    if (Other.NumData == 0)
+    {
+      return;
+    }
+
+    Data = Block.GetElements<TSyncTypeData<UType>>(Other.LayoutOffset, Other.NumData);
+    NumData = Other.NumData;
+    LayoutOffset = Other.LayoutOffset;
+    for (int32 Index = 0; Index < NumData; ++Index)
+    {
+      new (Data + Index) TSyncTypeData<UType>(Other.Data[Index]);
+    }
+  }
+
+  /// Swaps the data of two pawn states, the owning states swap their data blocks along with it.
+  void SwapData(TSyncTypeMulti& Other)
+  {
+    const ESimState SimState = this->GetSimulationState();
+    const ESimType SimType = this->GetSimulationType();
+    this->InitializeBase(Other.GetSimulationState(), Other.GetSimulationType());
+    Other.InitializeBase(SimState, SimType);
+
+    Swap(Data, Other.Data);
+    Swap(NumData, Other.NumData);
+    Swap(LayoutOffset, Other.LayoutOffset);
+  }
+
+  void DestroyData()
+  {
+    for (int32 Index = 0; Index < NumData; ++Index)
+    {
+      Data[Index].~TSyncTypeData<UType>();
+    }
+
+    Data = nullptr;
+    NumData = 0;
+    LayoutOffset = INDEX_NONE;
+  }
+
   void Process(
     const TMemberAlias<T>& Alias,
     FDataOpDirective Directive,
@@ -1452,7 +1679,27 @@ public:
 
 private:
 
-  TArray<TSyncTypeData<UType>> MultiData;
+  void ConstructData(FSyncDataBlock& Block, int32 Offset, int32 Num)
+  {
+    DestroyData();
+    if (Num == 0)
+    {
+      return;
+    }
+
+    Data = Block.GetElements<TSyncTypeData<UType>>(Offset, Num);
+    NumData = Num;
+    LayoutOffset = Offset;
+    for (int32 Index = 0; Index < NumData; ++Index)
+    {
+      new (Data + Index) TSyncTypeData<UType>();
+    }
+  }
+
+  /// Points into the data block of the owning pawn state, the elements are constructed in place.
+  TSyncTypeData<UType>* Data{nullptr};
+  int32 NumData{0};
+  int32 LayoutOffset{INDEX_NONE};
 };
 
 template<typename T>
@@ -1882,7 +2129,8 @@ private:
     const AActor* const TargetConnection,
     const FGMC_NetInfo& NetInfo,
     const FGMC_MetaData& MetaData,
-    bool bForceFullSerialization
+    bool bForceFullSerialization,
+    FSyncDataSerializationRecord* const Record
   ) override
   {
     gmc_ck(GetSimulationType() == ESimType::APMove || GetSimulationType() == ESimType::SPMove)
@@ -1905,6 +2153,10 @@ private:
       {
         Quantize(Value, NetInfo.OwningComponent.Get());
         Serialize(Value, Ar, Map, NetInfo, MetaData);
+        if (Record)
+        {
+          Record->NewValues.Add(true);
+        }
       }
       else
       {
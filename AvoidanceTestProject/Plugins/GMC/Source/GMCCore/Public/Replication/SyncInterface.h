@@ -53,28 +53,138 @@ namespace DataFilterMode
 
 #define ADD_SYNC_TYPE(Name)\
   GMCReplication::TSyncType<GMCReplication::F##Name> Name;
+#define COPY_INTEGRATED(Name)\
+  Name = Other.Name;
+#define SWAP_INTEGRATED(Name)\
+  Swap(Name, Other.Name);
+#define COPY_GENERIC(Name)\
+  Name.CopyData(Other.Name, DataBlock, bSameLayout);
+#define SWAP_GENERIC(Name)\
+  Name.SwapData(Other.Name);
+#define HAS_SAME_LAYOUT(Name)\
+  bSameLayout = bSameLayout && Name.HasSameLayout(Other.Name);
+#define DESTROY_GENERIC(Name)\
+  Name.DestroyData();
 
 USTRUCT(BlueprintType)
 struct GMCCORE_API FGMC_PawnState
 {
   GENERATED_BODY()
 
+  FGMC_PawnState() = default;
+
+  FGMC_PawnState(const FGMC_PawnState& Other)
+  {
+    *this = Other;
+  }
+
+  FGMC_PawnState(FGMC_PawnState&& Other)
+  {
+    *this = MoveTemp(Other);
+  }
+
+  /// States of the same component share a layout, copying between them assigns the generic data in place without allocating.
+  FGMC_PawnState& operator=(const FGMC_PawnState& Other)
+  {
+    if (this == &Other)
+    {
+      return *this;
+    }
+
+    bool bSameLayout = DataBlock.GetSize() == Other.DataBlock.GetSize();
+    FOR_EACH(HAS_SAME_LAYOUT, GENERIC_SYNC_TYPES)
+    if (!bSameLayout)
+    {
+      DestroyGenericData();
+      DataBlock.Reserve(Other.DataBlock.GetSize(), Other.DataBlock.GetAlignment());
+    }
+
+    FOR_EACH(COPY_INTEGRATED, INTEGRATED_SYNC_TYPES)
+    FOR_EACH(COPY_GENERIC, GENERIC_SYNC_TYPES)
+    return *this;
+  }
+
+  FGMC_PawnState& operator=(FGMC_PawnState&& Other)
+  {
+    if (this == &Other)
+    {
+      return *this;
+    }
+
+    // The generic data stays where it is in memory, only the ownership of the data blocks changes.
+    DataBlock.Swap(Other.DataBlock);
+    FOR_EACH(SWAP_INTEGRATED, INTEGRATED_SYNC_TYPES)
+    FOR_EACH(SWAP_GENERIC, GENERIC_SYNC_TYPES)
+    return *this;
+  }
+
+  /// Destroys the generic data and reallocates the data block for the given layout if required, the generic sync types must be
+  /// initialized again afterwards (@see InitializeSyncData).
+  void ResetDataBlock(const GMCReplication::FSyncDataLayout& Layout)
+  {
+    gmc_ck(Layout.bFinalized)
+    DestroyGenericData();
+    DataBlock.Reserve(Layout.Size, Layout.Alignment);
+  }
+
+  /// Holds the data of all generic sync types. Declared first so it is freed after the sync types destroyed their elements.
+  GMCReplication::FSyncDataBlock DataBlock;
+
   FOR_EACH(ADD_SYNC_TYPE, ALL_SYNC_TYPES)
+
+private:
+
+  void DestroyGenericData()
+  {
+    FOR_EACH(DESTROY_GENERIC, GENERIC_SYNC_TYPES)
+  }
 };
 
 #undef ADD_SYNC_TYPE
+#undef COPY_INTEGRATED
+#undef SWAP_INTEGRATED
+#undef COPY_GENERIC
+#undef SWAP_GENERIC
+#undef HAS_SAME_LAYOUT
+#undef DESTROY_GENERIC
 
 #define ADD_MEMBER_ALIAS(Name)\
   GMCReplication::TMemberAlias<GMCReplication::F##Name> Name;
 
+#define ADD_TO_LAYOUT(Name)\
+  Name.AddToLayout(Layout);
+
 struct GMCCORE_API FGMC_MemberAliases
 {
   // Integrated sync types are defined directly within the pawn state, they don't need member aliases.
 
   FOR_EACH(ADD_MEMBER_ALIAS, GENERIC_SYNC_TYPES)
+
+  /// Assigns every bound member its offset within the data block of a pawn state. Must be called once after the replication data was
+  /// bound and before any pawn state is initialized, no further members can be bound afterwards.
+  void FinalizeLayout()
+  {
+    if (Layout.bFinalized)
+    {
+      return;
+    }
+
+    FOR_EACH(ADD_TO_LAYOUT, GENERIC_SYNC_TYPES)
+    Layout.bFinalized = true;
+  }
+
+  const GMCReplication::FSyncDataLayout& GetLayout() const
+  {
+    return Layout;
+  }
+
+private:
+
+  GMCReplication::FSyncDataLayout Layout{};
 };
 
 #undef ADD_MEMBER_ALIAS
+#undef ADD_TO_LAYOUT
 
 #define INIT_INTEGRATED_DEFAULTS(Name)\
   State.Name.Initialize(\
@@ -93,7 +203,7 @@ struct GMCCORE_API FGMC_MemberAliases
   );
 
 #define INIT_GENERIC(Name)\
-  State.Name.Initialize(AliasData.Name, SimulationState, SimulationType, Component);
+  State.Name.Initialize(AliasData.Name, State.DataBlock, SimulationState, SimulationType, Component);
 
 inline void InitializeSyncData(
   FGMC_PawnState& State,
@@ -107,6 +217,7 @@ inline void InitializeSyncData(
 {
   FOR_EACH(INIT_INTEGRATED_DEFAULTS, INTEGRATED_SYNC_TYPES_DEFAULTS)
   //FOR_EACH(INIT_INTEGRATED_TAGS, INTEGRATED_SYNC_TYPES_TAGS)
+  State.ResetDataBlock(AliasData.GetLayout());
   FOR_EACH(INIT_GENERIC, GENERIC_SYNC_TYPES)
 }
 
@@ -358,7 +469,7 @@ inline bool CheckSyncDataForcedNetUpdate(
 #undef SHOULD_FORCE_NET_UPDATE
 
 #define NET_SERIALIZE(Name)\
-  State.Name.NetSerializeValue(Ar, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization);
+  State.Name.NetSerializeValue(Ar, Map, TargetConnection, NetInfo, MetaData, bForceFullSerialization, Record);
 
 inline void NetSerializeSyncData(
   FGMC_PawnState& State,
@@ -367,7 +478,8 @@ inline void NetSerializeSyncData(
   const AActor* const TargetConnection,
   const FGMC_NetInfo& NetInfo,
   const FGMC_MetaData& MetaData,
-  bool bForceFullSerialization
+  bool bForceFullSerialization,
+  GMCReplication::FSyncDataSerializationRecord* const Record = nullptr
 )
 {
   FOR_EACH(NET_SERIALIZE, ALL_SYNC_TYPES)
@@ -375,6 +487,42 @@ inline void NetSerializeSyncData(
 
 #undef NET_SERIALIZE
 
+#define ADOPT_SERIALIZED(Name)\
+  State.Name.AdoptSerializedValues(TargetConnection, MetaData, Record, BitIndex, Component);
+
+/// Updates the baseline of the target connection from the record of a server to client serialization of the state to another connection.
+inline void AdoptSerializedSyncData(
+  FGMC_PawnState& State,
+  const AActor* const TargetConnection,
+  const FGMC_MetaData& MetaData,
+  const GMCReplication::FSyncDataSerializationRecord& Record,
+  int32& BitIndex,
+  UGMC_ReplicationCmp* const Component
+)
+{
+  FOR_EACH(ADOPT_SERIALIZED, ALL_SYNC_TYPES)
+}
+
+#undef ADOPT_SERIALIZED
+
+#define HAS_OBJECT_REFERENCE(Name)\
+  for (int32 Index = 0; Index < State.Name.Num(); ++Index) { if (State.Name.Read(Index)) return true; }
+
+/// Whether the server to client serialization of the state can differ between connections with the same baseline. Object references are exported through the
+/// package map of each connection, and instanced structs as well as user-defined types may contain them.
+inline bool HasConnectionDependentSyncData(const FGMC_PawnState& State)
+{
+#ifdef GMC_ENABLE_USER_SYNC_TYPES
+  return true;
+#else
+  FOR_EACH(HAS_OBJECT_REFERENCE, ActorBase, ActorReference, ActorComponentReference, AnimMontageReference)
+
+  return State.InstancedStruct.Num() > 0;
+#endif
+}
+
+#undef HAS_OBJECT_REFERENCE
+
 #define TO_RELATIVE(Name)\
   State.Name.ToRelativeValue(TargetBase, Filters, (GMCReplication::EDataFilterMode)FilterMode, Component);
 
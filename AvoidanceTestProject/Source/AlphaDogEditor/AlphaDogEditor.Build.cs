@@ -47,6 +47,7 @@ public class AlphaDogEditor : ModuleRules
                 "DeveloperToolSettings",
                 "CollectionManager",
                 "SourceControl",
+                "BeansTestUtilities",
             }
         );
     }
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BeansTestUtilities.h"
+
+#if WITH_AUTOMATION_WORKER
+
+#include "AvoidanceCapture.h"
+#include "AvoidanceKernel.h"
+#include "AvoidancePlannerSubsystem.h"
+#include "AvoidanceSpatialHash.h"
+#include "AvoidanceTestHelpers.h"
+#include "HAL/FileManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace AvoidanceCaptureReplay
+{
+	FString GetCaptureDir()
+	{
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("AvoidanceCaptures"));
+	}
+}
+
+#define OUU_TEST_CATEGORY AlphaDog.Avoidance
+#define OUU_TEST_TYPE Benchmark
+
+/**
+ * Feeds recorded crowds back into AvoidanceKernel::SolveForces and times every frame, one test case per capture in Saved/AvoidanceCaptures.
+ * Record with AlphaDog.Avoidance.Capture 1 in a running game, then run headless with:
+ * UnrealEditor-Cmd AlphaDog.uproject -ExecCmds="Automation RunTests AlphaDog.Avoidance.Benchmark.CaptureReplay; Quit" -unattended -nullrhi
+ * Every frame solves the recorded state, not state integrated from earlier solves, so different solver builds see the same inputs.
+ * Per-frame timings are written next to the benchmark results in Saved/Automation/AvoidanceBenchmark as CSV and JSON.
+ */
+OUU_IMPLEMENT_COMPLEX_AUTOMATION_TEST_BEGIN(CaptureReplay, EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+	TArray<FString> CaptureFiles;
+	IFileManager::Get().FindFiles(CaptureFiles, *FPaths::Combine(AvoidanceCaptureReplay::GetCaptureDir(), TEXT("*.adcap")), true, false);
+	for (const FString& CaptureFile : CaptureFiles)
+	{
+		OUU_COMPLEX_AUTOMATION_TESTCASE_NAMED(FPaths::GetBaseFilename(CaptureFile).Replace(TEXT("."), TEXT("")), CaptureFile)
+	}
+OUU_IMPLEMENT_COMPLEX_AUTOMATION_TEST_END(CaptureReplay)
+{
+	using namespace AvoidanceCaptureReplay;
+	using namespace AvoidanceTestHelpers;
+
+	FAvoidanceCaptureReader Reader;
+	if (!TestTrue(TEXT("Open capture"), Reader.Open(FPaths::Combine(GetCaptureDir(), Parameters))))
+	{
+		return false;
+	}
+
+	// Solve with the tuning and broadphase a game world would use, the recorded time step drives ORCA
+	FOUUScopedAutomationTestWorld TestWorld(TEXT("AvoidanceCaptureReplayWorld"));
+	const UAvoidancePlannerSubsystem* Planner = TestWorld.World->GetSubsystem<UAvoidancePlannerSubsystem>();
+	if (!TestNotNull(TEXT("Avoidance planner"), Planner))
+	{
+		return false;
+	}
+	FAvoidanceSolverParams Params = Planner->GetSolverParams();
+	FAvoidanceSolveOptions Options;
+	Options.bUseSpatialHash = GetConsoleBool(TEXT("AlphaDog.Avoidance.UseSpatialHash"));
+	Options.bUseSimdKernel = GetConsoleBool(TEXT("AlphaDog.Avoidance.UseSimdKernel"));
+	Options.MaxNeighbours = FMath::Max(GetConsoleInt(TEXT("AlphaDog.Avoidance.MaxNeighbours")), 0);
+	Options.NeighbourCacheMargin = GetConsoleFloat(TEXT("AlphaDog.Avoidance.NeighbourCacheMargin"), Options.NeighbourCacheMargin);
+	Options.MaxNeighbourListAge = GetConsoleInt(TEXT("AlphaDog.Avoidance.MaxNeighbourListAge"));
+
+	FAvoidanceCaptureFrame Frame;
+	FAvoidanceSpatialHash SpatialHash;
+	FAvoidanceNeighbourCache NeighbourCache;
+	TArray<FVector> Forces;
+	TArray<double> FrameMs;
+	TArray<FString> CsvLines;
+	CsvLines.Add(TEXT("frame,agents,spawns,despawns,delta_time,solve_ms,pair_tests,neighbour_lists_built"));
+	int64 NumPairTests = 0;
+	while (Reader.ReadFrame(Frame))
+	{
+		if (Frame.NumDespawns > 0)
+		{
+			NeighbourCache.Remap(Frame.SlotSources); // Slots moved, same as the planner
+		}
+		Params.TimeStep = FMath::Max(Frame.DeltaTime, UE_KINDA_SMALL_NUMBER);
+		Forces.SetNumUninitialized(Frame.Agents.Num(), EAllowShrinking::No);
+
+		FAvoidanceSolveStats Stats;
+		const double StartTime = FPlatformTime::Seconds();
+		AvoidanceKernel::SolveForces(Frame.Agents, Frame.GoalVelocities, Params, Options, SpatialHash, Forces, &Stats, Frame.Modes, &NeighbourCache);
+		const double Ms = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		CsvLines.Add(FString::Printf(TEXT("%d,%d,%d,%d,%.6f,%.6f,%lld,%d"), FrameMs.Num(), Frame.Agents.Num(), Frame.NumSpawns, Frame.NumDespawns,
+			Frame.DeltaTime, Ms, Stats.NumPairTests, Stats.NumNeighbourListsBuilt));
+		FrameMs.Add(Ms);
+		NumPairTests += Stats.NumPairTests;
+	}
+	if (!TestFalse(TEXT("Capture is well formed"), Reader.HasError()) || !TestTrue(TEXT("Capture has frames"), FrameMs.Num() > 0))
+	{
+		return false;
+	}
+
+	double TotalMs = 0.0;
+	for (const double Ms : FrameMs)
+	{
+		TotalMs += Ms;
+	}
+	const int32 NumFrames = FrameMs.Num();
+	TArray<double> SortedMs = FrameMs;
+	SortedMs.Sort();
+	const double MeanMs = TotalMs / NumFrames;
+	const double P50Ms = SortedMs[NumFrames / 2];
+	const double P99Ms = SortedMs[FMath::Min(FMath::CeilToInt32(NumFrames * 0.99) - 1, NumFrames - 1)];
+	const double MaxMs = SortedMs.Last();
+	const int32 MaxFrame = FrameMs.IndexOfByKey(MaxMs);
+	AddInfo(FString::Printf(TEXT("%s: %d frames, mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms at frame %d, %.3g pair tests/s"),
+		*Parameters, NumFrames, MeanMs, P50Ms, P99Ms, MaxMs, MaxFrame, TotalMs > 0.0 ? NumPairTests / (TotalMs * 0.001) : 0.0));
+
+	const FString Timestamp = FDateTime::UtcNow().ToString();
+	const FString Json = FString::Printf(TEXT("{\n\t\"capture\": \"%s\",\n\t\"timestamp\": \"%s\",\n\t\"spatial_hash\": %s,\n\t\"simd\": %s,\n\t\"max_neighbours\": %d,\n\t\"frames\": %d,\n\t\"mean_ms\": %.6f,\n\t\"p50_ms\": %.6f,\n\t\"p99_ms\": %.6f,\n\t\"max_ms\": %.6f,\n\t\"max_frame\": %d\n}\n"),
+		*Parameters.ReplaceCharWithEscapedChar(), *Timestamp, Options.bUseSpatialHash ? TEXT("true") : TEXT("false"), Options.bUseSimdKernel ? TEXT("true") : TEXT("false"),
+		Options.MaxNeighbours, NumFrames, MeanMs, P50Ms, P99Ms, MaxMs, MaxFrame);
+
+	const FString OutputBase = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Automation"), TEXT("AvoidanceBenchmark"),
+		FString::Printf(TEXT("%s_Replay_%s"), *Timestamp, *FPaths::GetBaseFilename(Parameters)));
+	TestTrue(TEXT("Write CSV"), FFileHelper::SaveStringArrayToFile(CsvLines, *(OutputBase + TEXT(".csv"))));
+	TestTrue(TEXT("Write JSON"), FFileHelper::SaveStringToFile(Json, *(OutputBase + TEXT(".json"))));
+	AddInfo(FString::Printf(TEXT("Results written to %s.csv/.json"), *OutputBase));
+	return true;
+}
+
+#undef OUU_TEST_CATEGORY
+#undef OUU_TEST_TYPE
+
+#endif
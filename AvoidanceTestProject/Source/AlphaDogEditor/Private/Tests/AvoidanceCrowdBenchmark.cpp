@@ -0,0 +1,455 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BeansTestUtilities.h"
+
+#if WITH_AUTOMATION_WORKER
+
+#include "AvoidanceKernel.h"
+#include "AvoidancePlannerSubsystem.h"
+#include "AvoidanceSpatialHash.h"
+#include "AvoidanceTestHelpers.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace AvoidanceCrowdBenchmark
+{
+	// Crowd sizes every layout is measured at
+	const int32 AgentCounts[] = { 100, 500, 1000, 2000, 5000, 10000, 20000 };
+	constexpr int32 WarmupTicks = 10;
+	constexpr int32 MeasuredTicks = 60;
+	// Extra single threaded ticks whose allocations are counted, kept out of the timings
+	constexpr int32 CountedTicks = 10;
+	constexpr float DeltaTime = 1.0f / 60.0f;
+	constexpr float AgentRadius = 30.0f;
+	constexpr float AgentSpeed = 50.0f;
+	// Average distance between neighbours at spawn, keeps density roughly constant as the crowd grows
+	constexpr float AgentSpacing = 80.0f;
+
+	/**
+	 * Forwards to the real allocator and counts the allocation calls of the thread inside an FScopedAllocationCount, other threads pass through.
+	 * Installed as GMalloc on first use and never removed, so a thread that read GMalloc just before is never left calling a dead allocator.
+	 */
+	class FMallocCounter final : public FMalloc
+	{
+	public:
+		explicit FMallocCounter(FMalloc* InInner) : Inner(InInner) {}
+
+		static FMallocCounter& Install()
+		{
+			static FMallocCounter* Counter = []()
+			{
+				FMallocCounter* NewCounter = new FMallocCounter(GMalloc);
+				FPlatformAtomics::InterlockedExchangePtr(reinterpret_cast<void**>(&GMalloc), NewCounter);
+				return NewCounter;
+			}();
+			return *Counter;
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override { CountOnThread(); return Inner->Malloc(Count, Alignment); }
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override { CountOnThread(); return Inner->TryMalloc(Count, Alignment); }
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override { CountOnThread(); return Inner->Realloc(Original, Count, Alignment); }
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override { CountOnThread(); return Inner->TryRealloc(Original, Count, Alignment); }
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		static inline thread_local int64* ThreadCount = nullptr; // Set by FScopedAllocationCount on its thread
+
+	private:
+		static void CountOnThread()
+		{
+			if (ThreadCount)
+			{
+				++*ThreadCount;
+			}
+		}
+
+		FMalloc* Inner;
+	};
+
+	/** Counts the allocations made by the current thread during its lifetime, run the solve single threaded to count all of them. */
+	struct FScopedAllocationCount
+	{
+		FScopedAllocationCount() { FMallocCounter::Install(); FMallocCounter::ThreadCount = &NumAllocations; }
+		~FScopedAllocationCount() { FMallocCounter::ThreadCount = nullptr; }
+		int64 GetNumAllocations() const { return NumAllocations; }
+
+	private:
+		int64 NumAllocations = 0;
+	};
+
+	/** Synthetic crowd integrated without actors, the same state the planner snapshots for its solve. */
+	struct FCrowd
+	{
+		FAvoidanceAgentArrays Agents;
+		TArray<FVector> Goals;
+		TArray<FVector> GoalVelocities;
+		TArray<FVector> Forces;
+
+		void Init(const int32 NumAgents)
+		{
+			Agents.SetNum(NumAgents);
+			Goals.SetNumZeroed(NumAgents);
+			GoalVelocities.SetNumZeroed(NumAgents);
+			Forces.SetNumZeroed(NumAgents);
+		}
+
+		void AddAgent(const int32 i, const FVector& Position, const FVector& Goal)
+		{
+			Agents.SetPosition(i, Position);
+			Agents.Radii[i] = AgentRadius;
+			Goals[i] = Goal;
+			GoalVelocities[i] = (Goal - Position).GetSafeNormal2D() * AgentSpeed;
+			Agents.SetVelocity(i, GoalVelocities[i]);
+		}
+
+		// Same velocity update the planner applies, plus the movement the pawns would have done
+		void Integrate()
+		{
+			for (int32 i = 0; i < Agents.Num(); ++i)
+			{
+				const FVector Velocity = (Agents.GetVelocity(i) + Forces[i] * DeltaTime).GetClampedToMaxSize(2.0f * AgentSpeed);
+				const FVector Position = Agents.GetPosition(i) + Velocity * DeltaTime;
+				Agents.SetVelocity(i, Velocity);
+				Agents.SetPosition(i, Position);
+				GoalVelocities[i] = (Goals[i] - Position).GetSafeNormal2D() * AgentSpeed;
+			}
+		}
+	};
+
+	// Agents evenly spaced on a circle, each heading for the opposite point, so everyone meets in the middle
+	void BuildCircleSwap(FCrowd& Crowd, const int32 NumAgents, FRandomStream&)
+	{
+		Crowd.Init(NumAgents);
+		const float Radius = FMath::Max(500.0f, NumAgents * AgentSpacing / UE_TWO_PI);
+		for (int32 i = 0; i < NumAgents; ++i)
+		{
+			const float Angle = UE_TWO_PI * i / NumAgents;
+			const FVector Position(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), 0.0f);
+			Crowd.AddAgent(i, Position, -Position);
+		}
+	}
+
+	// Two packed streams walking down perpendicular corridors that cross at the origin
+	void BuildCrossingCorridor(FCrowd& Crowd, const int32 NumAgents, FRandomStream& Random)
+	{
+		Crowd.Init(NumAgents);
+		constexpr float CorridorWidth = 1000.0f;
+		const int32 Columns = FMath::Max(1, FMath::FloorToInt32(CorridorWidth / AgentSpacing));
+		const float StreamLength = FMath::DivideAndRoundUp(NumAgents / 2 + 1, Columns) * AgentSpacing;
+		for (int32 i = 0; i < NumAgents; ++i)
+		{
+			const int32 StreamIndex = i / 2;
+			const float Lateral = (StreamIndex % Columns + 0.5f) * AgentSpacing - CorridorWidth * 0.5f + Random.FRandRange(-5.0f, 5.0f);
+			const float Along = -CorridorWidth - (StreamIndex / Columns) * AgentSpacing;
+			const float GoalAlong = CorridorWidth + StreamLength;
+			if (i % 2 == 0)
+			{
+				Crowd.AddAgent(i, FVector(Along, Lateral, 0.0f), FVector(GoalAlong, Lateral, 0.0f));
+			}
+			else
+			{
+				Crowd.AddAgent(i, FVector(Lateral, Along, 0.0f), FVector(Lateral, GoalAlong, 0.0f));
+			}
+		}
+	}
+
+	// Uniformly scattered agents, each heading for a random point of the same square
+	void BuildRandom(FCrowd& Crowd, const int32 NumAgents, FRandomStream& Random)
+	{
+		Crowd.Init(NumAgents);
+		const float HalfSize = FMath::Sqrt(static_cast<float>(NumAgents)) * AgentSpacing * 0.5f;
+		auto RandomPoint = [&Random, HalfSize]()
+		{
+			return FVector(Random.FRandRange(-HalfSize, HalfSize), Random.FRandRange(-HalfSize, HalfSize), 0.0f);
+		};
+		for (int32 i = 0; i < NumAgents; ++i)
+		{
+			const FVector Position = RandomPoint();
+			Crowd.AddAgent(i, Position, RandomPoint());
+		}
+	}
+
+	struct FResult
+	{
+		int32 NumAgents = 0;
+		double MeanMs = 0.0;
+		double P50Ms = 0.0;
+		double P99Ms = 0.0;
+		double PairTestsPerSecond = 0.0;
+		double AllocationsPerTick = 0.0;
+	};
+
+	FResult Run(const TFunctionRef<void(FCrowd&, int32, FRandomStream&)> BuildLayout, const int32 NumAgents,
+		const FAvoidanceSolverParams& Params, const FAvoidanceSolveOptions& Options)
+	{
+		FRandomStream Random(NumAgents);
+		FCrowd Crowd;
+		BuildLayout(Crowd, NumAgents, Random);
+		FAvoidanceSpatialHash SpatialHash;
+		FAvoidanceNeighbourCache NeighbourCache;
+
+		for (int32 Tick = 0; Tick < WarmupTicks; ++Tick)
+		{
+			AvoidanceKernel::SolveForces(Crowd.Agents, Crowd.GoalVelocities, Params, Options, SpatialHash, Crowd.Forces, nullptr, {}, &NeighbourCache);
+			Crowd.Integrate();
+		}
+
+		TArray<double> TickMs;
+		TickMs.Reserve(MeasuredTicks);
+		int64 NumPairTests = 0;
+		for (int32 Tick = 0; Tick < MeasuredTicks; ++Tick)
+		{
+			FAvoidanceSolveStats Stats;
+			const double StartTime = FPlatformTime::Seconds();
+			AvoidanceKernel::SolveForces(Crowd.Agents, Crowd.GoalVelocities, Params, Options, SpatialHash, Crowd.Forces, &Stats, {}, &NeighbourCache);
+			TickMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+			NumPairTests += Stats.NumPairTests;
+			Crowd.Integrate();
+		}
+
+		// Same solve on this thread alone, so only its own allocations are counted, not the workers' bookkeeping or other threads'
+		FAvoidanceSolveOptions CountedOptions = Options;
+		CountedOptions.bSingleThreaded = true;
+		int64 NumAllocations = 0;
+		for (int32 Tick = 0; Tick < CountedTicks; ++Tick)
+		{
+			{
+				FScopedAllocationCount AllocationCount;
+				AvoidanceKernel::SolveForces(Crowd.Agents, Crowd.GoalVelocities, Params, CountedOptions, SpatialHash, Crowd.Forces, nullptr, {}, &NeighbourCache);
+				NumAllocations += AllocationCount.GetNumAllocations();
+			}
+			Crowd.Integrate();
+		}
+
+		FResult Result;
+		Result.NumAgents = NumAgents;
+		double TotalMs = 0.0;
+		for (const double Ms : TickMs)
+		{
+			TotalMs += Ms;
+		}
+		TickMs.Sort();
+		Result.MeanMs = TotalMs / MeasuredTicks;
+		Result.P50Ms = TickMs[MeasuredTicks / 2];
+		Result.P99Ms = TickMs[FMath::Min(FMath::CeilToInt32(MeasuredTicks * 0.99) - 1, MeasuredTicks - 1)];
+		Result.PairTestsPerSecond = TotalMs > 0.0 ? NumPairTests / (TotalMs * 0.001) : 0.0;
+		Result.AllocationsPerTick = static_cast<double>(NumAllocations) / CountedTicks;
+		return Result;
+	}
+
+	struct FKernelResult
+	{
+		int64 NumPairTests = 0;
+		double ScalarMs = 0.0;
+		double SimdMs = 0.0;
+		float MaxForceError = 0.0f; // Largest difference between the two kernels' per-agent sums, relative to the force
+	};
+
+	// Agents of the pair kernel comparison, scattered over the 3x3 cells a broadphase query covers so about the same share of pairs is in range
+	constexpr int32 KernelAgents = 1024;
+	constexpr int32 KernelRepeats = 5;
+
+	// Every agent against every batch, first through AccumulateBatchScalar then through AccumulateBatchSimd.
+	// Single threaded and without broadphase, so the ratio is the kernel's own.
+	FKernelResult RunPairKernel(const FAvoidanceSolverParams& Params)
+	{
+		FRandomStream Random(KernelAgents);
+		FCrowd Crowd;
+		Crowd.Init(KernelAgents);
+		const float HalfSize = 1.5f * FMath::Sqrt(Params.SensingRadiusSq);
+		auto RandomPoint = [&Random, HalfSize]()
+		{
+			return FVector(Random.FRandRange(-HalfSize, HalfSize), Random.FRandRange(-HalfSize, HalfSize), 0.0f);
+		};
+		for (int32 i = 0; i < KernelAgents; ++i)
+		{
+			const FVector Position = RandomPoint();
+			Crowd.AddAgent(i, Position, RandomPoint());
+		}
+		const FAvoidanceAgentArrays& Agents = Crowd.Agents;
+
+		TArray<FVector3f> ScalarForces;
+		ScalarForces.SetNumZeroed(KernelAgents);
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Repeat = 0; Repeat < KernelRepeats; ++Repeat)
+		{
+			for (int32 i = 0; i < KernelAgents; ++i)
+			{
+				FVector3f Force = FVector3f::ZeroVector;
+				for (int32 j = 0; j < KernelAgents; j += AvoidanceBatchSize)
+				{
+					AvoidanceKernel::AccumulateBatchScalar(Agents, Params, i, j, Force);
+				}
+				ScalarForces[i] = Force;
+			}
+		}
+
+		FKernelResult Result;
+		Result.ScalarMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		TArray<FVector3f> SimdForces;
+		SimdForces.SetNumZeroed(KernelAgents);
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Repeat = 0; Repeat < KernelRepeats; ++Repeat)
+		{
+			for (int32 i = 0; i < KernelAgents; ++i)
+			{
+				AvoidanceKernel::FLaneForces Forces;
+				for (int32 j = 0; j < KernelAgents; j += AvoidanceBatchSize)
+				{
+					AvoidanceKernel::AccumulateBatchSimd(Agents, Params, i, j, Forces);
+				}
+				SimdForces[i] = Forces.Reduce();
+			}
+		}
+		Result.SimdMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		Result.NumPairTests = static_cast<int64>(KernelRepeats) * KernelAgents * KernelAgents;
+
+		// Also keeps either loop from being optimized away
+		for (int32 i = 0; i < KernelAgents; ++i)
+		{
+			const float Error = FVector3f::Dist(ScalarForces[i], SimdForces[i]) / FMath::Max(ScalarForces[i].Size(), 1.0f);
+			Result.MaxForceError = FMath::Max(Result.MaxForceError, Error);
+		}
+		return Result;
+	}
+}
+
+#define OUU_TEST_CATEGORY AlphaDog.Avoidance
+#define OUU_TEST_TYPE Benchmark
+
+/**
+ * Times AvoidanceKernel::SolveForces on synthetic crowds, without pawns or PIE.
+ * Run headless with: UnrealEditor-Cmd AlphaDog.uproject -ExecCmds="Automation RunTests AlphaDog.Avoidance.Benchmark; Quit" -unattended -nullrhi
+ * Results are written to Saved/Automation/AvoidanceBenchmark as CSV and JSON, one file pair per layout and run.
+ */
+OUU_IMPLEMENT_COMPLEX_AUTOMATION_TEST_BEGIN(CrowdSolve, EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+OUU_COMPLEX_AUTOMATION_TESTCASE("CircleSwap")
+OUU_COMPLEX_AUTOMATION_TESTCASE("CrossingCorridor")
+OUU_COMPLEX_AUTOMATION_TESTCASE("Random")
+OUU_IMPLEMENT_COMPLEX_AUTOMATION_TEST_END(CrowdSolve)
+{
+	using namespace AvoidanceCrowdBenchmark;
+	using namespace AvoidanceTestHelpers;
+
+	void (*BuildLayout)(FCrowd&, int32, FRandomStream&) = nullptr;
+	if (Parameters == TEXT("CircleSwap"))
+	{
+		BuildLayout = &BuildCircleSwap;
+	}
+	else if (Parameters == TEXT("CrossingCorridor"))
+	{
+		BuildLayout = &BuildCrossingCorridor;
+	}
+	else if (Parameters == TEXT("Random"))
+	{
+		BuildLayout = &BuildRandom;
+	}
+	if (!TestNotNull(TEXT("Layout"), BuildLayout))
+	{
+		return false;
+	}
+
+	// Solve with the tuning and broadphase a game world would use
+	FOUUScopedAutomationTestWorld TestWorld(TEXT("AvoidanceBenchmarkWorld"));
+	const UAvoidancePlannerSubsystem* Planner = TestWorld.World->GetSubsystem<UAvoidancePlannerSubsystem>();
+	if (!TestNotNull(TEXT("Avoidance planner"), Planner))
+	{
+		return false;
+	}
+	const FAvoidanceSolverParams Params = Planner->GetSolverParams();
+	FAvoidanceSolveOptions Options;
+	Options.bUseSpatialHash = GetConsoleBool(TEXT("AlphaDog.Avoidance.UseSpatialHash"));
+	Options.bUseSimdKernel = GetConsoleBool(TEXT("AlphaDog.Avoidance.UseSimdKernel"));
+	Options.MaxNeighbours = FMath::Max(GetConsoleInt(TEXT("AlphaDog.Avoidance.MaxNeighbours")), 0);
+	Options.NeighbourCacheMargin = GetConsoleFloat(TEXT("AlphaDog.Avoidance.NeighbourCacheMargin"), Options.NeighbourCacheMargin);
+	Options.MaxNeighbourListAge = GetConsoleInt(TEXT("AlphaDog.Avoidance.MaxNeighbourListAge"));
+
+	const FString Timestamp = FDateTime::UtcNow().ToString();
+	const FString BuildVersion = FApp::GetBuildVersion();
+	TArray<FString> CsvLines;
+	CsvLines.Add(TEXT("layout,agents,spatial_hash,simd,max_neighbours,ticks,mean_ms,p50_ms,p99_ms,pair_tests_per_sec,allocs_per_tick"));
+	TArray<FString> JsonRuns;
+	for (const int32 NumAgents : AgentCounts)
+	{
+		const FResult Result = Run(BuildLayout, NumAgents, Params, Options);
+		AddInfo(FString::Printf(TEXT("%s %d agents: mean %.3f ms, p50 %.3f ms, p99 %.3f ms, %.3g pair tests/s, %.1f allocs/tick"),
+			*Parameters, NumAgents, Result.MeanMs, Result.P50Ms, Result.P99Ms, Result.PairTestsPerSecond, Result.AllocationsPerTick));
+
+		CsvLines.Add(FString::Printf(TEXT("%s,%d,%d,%d,%d,%d,%.6f,%.6f,%.6f,%.0f,%.2f"),
+			*Parameters, NumAgents, Options.bUseSpatialHash, Options.bUseSimdKernel, Options.MaxNeighbours, MeasuredTicks,
+			Result.MeanMs, Result.P50Ms, Result.P99Ms, Result.PairTestsPerSecond, Result.AllocationsPerTick));
+		JsonRuns.Add(FString::Printf(TEXT("\t\t{ \"agents\": %d, \"ticks\": %d, \"mean_ms\": %.6f, \"p50_ms\": %.6f, \"p99_ms\": %.6f, \"pair_tests_per_sec\": %.0f, \"allocs_per_tick\": %.2f }"),
+			NumAgents, MeasuredTicks, Result.MeanMs, Result.P50Ms, Result.P99Ms, Result.PairTestsPerSecond, Result.AllocationsPerTick));
+	}
+
+	const FString Json = FString::Printf(TEXT("{\n\t\"layout\": \"%s\",\n\t\"timestamp\": \"%s\",\n\t\"build_version\": \"%s\",\n\t\"spatial_hash\": %s,\n\t\"simd\": %s,\n\t\"max_neighbours\": %d,\n\t\"runs\": [\n%s\n\t]\n}\n"),
+		*Parameters, *Timestamp, *BuildVersion.ReplaceCharWithEscapedChar(), Options.bUseSpatialHash ? TEXT("true") : TEXT("false"),
+		Options.bUseSimdKernel ? TEXT("true") : TEXT("false"), Options.MaxNeighbours, *FString::Join(JsonRuns, TEXT(",\n")));
+
+	const FString OutputBase = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Automation"), TEXT("AvoidanceBenchmark"), FString::Printf(TEXT("%s_%s"), *Timestamp, *Parameters));
+	TestTrue(TEXT("Write CSV"), FFileHelper::SaveStringArrayToFile(CsvLines, *(OutputBase + TEXT(".csv"))));
+	TestTrue(TEXT("Write JSON"), FFileHelper::SaveStringToFile(Json, *(OutputBase + TEXT(".json"))));
+	AddInfo(FString::Printf(TEXT("Results written to %s.csv/.json"), *OutputBase));
+	return true;
+}
+
+/**
+ * Times the pair kernel alone, scalar against SIMD, and reports the speedup. The SIMD kernel must be at least 3x faster where the platform has vector intrinsics.
+ * Run like CrowdSolve, results are written to Saved/Automation/AvoidanceBenchmark as CSV and JSON.
+ */
+OUU_IMPLEMENT_SIMPLE_AUTOMATION_TEST(PairKernel, EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+{
+	using namespace AvoidanceCrowdBenchmark;
+
+	// Same tuning a game world would use, see CrowdSolve
+	FOUUScopedAutomationTestWorld TestWorld(TEXT("AvoidanceBenchmarkWorld"));
+	const UAvoidancePlannerSubsystem* Planner = TestWorld.World->GetSubsystem<UAvoidancePlannerSubsystem>();
+	if (!TestNotNull(TEXT("Avoidance planner"), Planner))
+	{
+		return false;
+	}
+	const FKernelResult Result = RunPairKernel(Planner->GetSolverParams());
+	const double Speedup = Result.SimdMs > 0.0 ? Result.ScalarMs / Result.SimdMs : 0.0;
+	const double ScalarPairsPerSecond = Result.ScalarMs > 0.0 ? Result.NumPairTests / (Result.ScalarMs * 0.001) : 0.0;
+	const double SimdPairsPerSecond = Result.SimdMs > 0.0 ? Result.NumPairTests / (Result.SimdMs * 0.001) : 0.0;
+	AddInfo(FString::Printf(TEXT("Pair kernel, %lld pair tests: scalar %.3f ms (%.3g pairs/s), SIMD %.3f ms (%.3g pairs/s), speedup %.2fx, max force error %.2g"),
+		Result.NumPairTests, Result.ScalarMs, ScalarPairsPerSecond, Result.SimdMs, SimdPairsPerSecond, Speedup, Result.MaxForceError));
+	TestTrue(TEXT("SIMD and scalar kernels agree"), Result.MaxForceError < 1e-3f);
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+	TestTrue(FString::Printf(TEXT("SIMD pair kernel is at least 3x the scalar one (%.2fx)"), Speedup), Speedup >= 3.0);
+#else
+	// VectorRegister4Float falls back to four scalar lanes here, there is no speedup to hold it to
+	AddInfo(FString::Printf(TEXT("No vector intrinsics, SIMD pair kernel is %.2fx the scalar one"), Speedup));
+#endif
+
+	const FString Timestamp = FDateTime::UtcNow().ToString();
+	const TArray<FString> CsvLines = {
+		TEXT("pair_tests,scalar_ms,simd_ms,scalar_pairs_per_sec,simd_pairs_per_sec,speedup,max_force_error"),
+		FString::Printf(TEXT("%lld,%.6f,%.6f,%.0f,%.0f,%.3f,%.3g"),
+			Result.NumPairTests, Result.ScalarMs, Result.SimdMs, ScalarPairsPerSecond, SimdPairsPerSecond, Speedup, Result.MaxForceError)
+	};
+	const FString Json = FString::Printf(TEXT("{\n\t\"timestamp\": \"%s\",\n\t\"build_version\": \"%s\",\n\t\"pair_tests\": %lld,\n\t\"scalar_ms\": %.6f,\n\t\"simd_ms\": %.6f,\n\t\"speedup\": %.3f,\n\t\"max_force_error\": %.3g\n}\n"),
+		*Timestamp, *FString(FApp::GetBuildVersion()).ReplaceCharWithEscapedChar(), Result.NumPairTests, Result.ScalarMs, Result.SimdMs, Speedup, Result.MaxForceError);
+
+	const FString OutputBase = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Automation"), TEXT("AvoidanceBenchmark"), FString::Printf(TEXT("%s_PairKernel"), *Timestamp));
+	TestTrue(TEXT("Write CSV"), FFileHelper::SaveStringArrayToFile(CsvLines, *(OutputBase + TEXT(".csv"))));
+	TestTrue(TEXT("Write JSON"), FFileHelper::SaveStringToFile(Json, *(OutputBase + TEXT(".json"))));
+	return true;
+}
+
+#undef OUU_TEST_CATEGORY
+#undef OUU_TEST_TYPE
+
+#endif
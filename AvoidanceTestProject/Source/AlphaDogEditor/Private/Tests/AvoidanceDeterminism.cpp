@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BeansTestUtilities.h"
+
+#if WITH_AUTOMATION_WORKER
+
+#include "AvoidanceComponent.h"
+#include "AvoidancePlannerSubsystem.h"
+#include "Engine/TargetPoint.h"
+#include "GameModes/ADogWorldSettings.h"
+#include "MyGMC_Pawn.h"
+
+namespace AvoidanceDeterminism
+{
+	constexpr int32 NumAgents = 16;
+	// Dyadic step and frame times, so both frame sequences add up to the same number of steps without rounding
+	constexpr float FixedStepRate = 32.0f;
+	constexpr float SimulatedTime = 2.0f;
+
+	/**
+	 * Two lines of agents walking through each other towards one goal, stepped by the deterministic planner over the given frame times.
+	 * Returns the agents' positions after the last frame, in spawn order.
+	 */
+	bool Run(FAutomationTestBase& Test, const TCHAR* Name, TConstArrayView<float> FrameTimes, TArray<FVector>& OutPositions)
+	{
+		FOUUScopedAutomationTestWorld TestWorld(Name);
+		AADogWorldSettings* WorldSettings = Cast<AADogWorldSettings>(TestWorld.World->GetWorldSettings());
+		if (!Test.TestNotNull(TEXT("ADog world settings"), WorldSettings))
+		{
+			return false;
+		}
+		WorldSettings->AvoidanceSolver.bDeterministic = true;
+		WorldSettings->AvoidanceSolver.FixedStepRate = FixedStepRate;
+		WorldSettings->AvoidanceSolver.MaxStepsPerFrame = 8;
+		WorldSettings->AvoidanceSolver.bFixedPointPositions = true;
+
+		// Agents look the goal up by tag in their BeginPlay
+		ATargetPoint* Goal = TestWorld.World->SpawnActor<ATargetPoint>(FVector(2000.0f, 0.0f, 0.0f), FRotator::ZeroRotator);
+		Goal->Tags.Add(FName("GoalPoint"));
+		TestWorld.BeginPlay();
+
+		TArray<AMyGMC_Pawn*> Pawns;
+		for (int32 i = 0; i < NumAgents; ++i)
+		{
+			const FVector Location(i % 2 == 0 ? 0.0f : 600.0f, (i / 2) * 80.0f - 280.0f, 0.0f);
+			AMyGMC_Pawn* Pawn = TestWorld.World->SpawnActorDeferred<AMyGMC_Pawn>(AMyGMC_Pawn::StaticClass(), FTransform(Location));
+			Pawn->AvoidanceComponent->bHasGoal = true;
+			Pawn->FinishSpawning(FTransform(Location));
+			Pawns.Add(Pawn);
+		}
+
+		for (const float FrameTime : FrameTimes)
+		{
+			TestWorld.World->Tick(LEVELTICK_All, FrameTime);
+		}
+
+		OutPositions.Reset(NumAgents);
+		for (const AMyGMC_Pawn* Pawn : Pawns)
+		{
+			OutPositions.Add(Pawn->GetActorLocation());
+		}
+		return true;
+	}
+}
+
+#define OUU_TEST_CATEGORY AlphaDog.Avoidance
+#define OUU_TEST_TYPE Deterministic
+
+/**
+ * Runs the same crowd at two frame rates, one of them uneven, and expects the deterministic planner to put every agent in exactly the same place.
+ * Goals are followed per fixed step, so the frame times must not leak into the simulation.
+ */
+OUU_IMPLEMENT_SIMPLE_AUTOMATION_TEST(FrameRateIndependence, EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+{
+	using namespace AvoidanceDeterminism;
+
+	// 128 frames of 1/64 s against alternating 3/64 s and 1/64 s frames, both 2 s
+	const int32 NumEvenFrames = FMath::RoundToInt32(SimulatedTime * 64.0f);
+	TArray<float> EvenFrames;
+	TArray<float> UnevenFrames;
+	for (int32 Frame = 0; Frame < NumEvenFrames; ++Frame)
+	{
+		EvenFrames.Add(1.0f / 64.0f);
+	}
+	for (int32 Frame = 0; Frame < NumEvenFrames / 2; ++Frame)
+	{
+		UnevenFrames.Add(Frame % 2 == 0 ? 3.0f / 64.0f : 1.0f / 64.0f);
+	}
+
+	TArray<FVector> EvenPositions;
+	TArray<FVector> UnevenPositions;
+	if (!Run(*this, TEXT("AvoidanceDeterminismEven"), EvenFrames, EvenPositions) || !Run(*this, TEXT("AvoidanceDeterminismUneven"), UnevenFrames, UnevenPositions))
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < NumAgents; ++i)
+	{
+		// Bit for bit, not nearly equal
+		if (EvenPositions[i] != UnevenPositions[i])
+		{
+			AddError(FString::Printf(TEXT("Agent %d ended at %s with even frames but at %s with uneven frames"), i, *EvenPositions[i].ToString(), *UnevenPositions[i].ToString()));
+		}
+		TestFalse(FString::Printf(TEXT("Agent %d moved"), i), EvenPositions[i].Equals(FVector(i % 2 == 0 ? 0.0f : 600.0f, (i / 2) * 80.0f - 280.0f, 0.0f)));
+	}
+	return true;
+}
+
+#undef OUU_TEST_CATEGORY
+#undef OUU_TEST_TYPE
+
+#endif
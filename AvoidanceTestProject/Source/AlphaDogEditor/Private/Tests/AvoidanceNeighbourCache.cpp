@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BeansTestUtilities.h"
+
+#if WITH_AUTOMATION_WORKER
+
+#include "AvoidanceKernel.h"
+#include "AvoidanceSpatialHash.h"
+#include "Math/RandomStream.h"
+
+#define OUU_TEST_CATEGORY AlphaDog.Avoidance
+#define OUU_TEST_TYPE NeighbourCache
+
+/**
+ * Despawns agents from a crowd the way the planner does, swapping the last agent into the freed slot, and remaps the cache.
+ * Nothing moved, so the kept lists must give exactly the forces of lists built from scratch, and only the lists around the despawns are rebuilt.
+ */
+OUU_IMPLEMENT_SIMPLE_AUTOMATION_TEST(RemapAfterDespawn, EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+{
+	constexpr int32 GridSize = 20;
+	FRandomStream Random(1234);
+	FAvoidanceAgentArrays Agents;
+	TArray<FVector> GoalVelocities;
+	for (int32 y = 0; y < GridSize; ++y)
+	{
+		for (int32 x = 0; x < GridSize; ++x)
+		{
+			const int32 i = Agents.Add();
+			Agents.SetPosition(i, FVector(x * 40.0f, y * 40.0f, 0.0f));
+			Agents.SetVelocity(i, FVector(Random.FRandRange(-50.0f, 50.0f), Random.FRandRange(-50.0f, 50.0f), 0.0f));
+			Agents.Radii[i] = 15.0f;
+			GoalVelocities.Add(Agents.GetVelocity(i));
+		}
+	}
+
+	FAvoidanceSolverParams Params;
+	FAvoidanceSolveOptions Options;
+	Options.MaxNeighbours = 6;
+	FAvoidanceSpatialHash SpatialHash;
+	FAvoidanceNeighbourCache NeighbourCache;
+	TArray<FVector> Forces;
+	Forces.SetNumUninitialized(Agents.Num());
+	AvoidanceKernel::SolveForces(Agents, GoalVelocities, Params, Options, SpatialHash, Forces, nullptr, {}, &NeighbourCache);
+
+	TArray<int32> Sources;
+	for (int32 i = 0; i < Agents.Num(); ++i)
+	{
+		Sources.Add(i);
+	}
+	for (const int32 Slot : { 0, 57, 210, 211, 396 })
+	{
+		Agents.RemoveAtSwap(Slot);
+		GoalVelocities.RemoveAtSwap(Slot);
+		Sources.RemoveAtSwap(Slot);
+	}
+	NeighbourCache.Remap(Sources);
+
+	FAvoidanceSolveStats Stats;
+	TArray<FVector> CachedForces;
+	CachedForces.SetNumUninitialized(Agents.Num());
+	AvoidanceKernel::SolveForces(Agents, GoalVelocities, Params, Options, SpatialHash, CachedForces, &Stats, {}, &NeighbourCache);
+
+	FAvoidanceNeighbourCache FreshCache;
+	TArray<FVector> FreshForces;
+	FreshForces.SetNumUninitialized(Agents.Num());
+	AvoidanceKernel::SolveForces(Agents, GoalVelocities, Params, Options, SpatialHash, FreshForces, nullptr, {}, &FreshCache);
+
+	TestTrue(TEXT("Only lists around the despawned agents are rebuilt"), Stats.NumNeighbourListsBuilt > 0 && Stats.NumNeighbourListsBuilt < Agents.Num() / 4);
+	for (int32 i = 0; i < Agents.Num(); ++i)
+	{
+		// Bit for bit, the kept lists hold the same agents in the same order
+		if (CachedForces[i] != FreshForces[i])
+		{
+			AddError(FString::Printf(TEXT("Agent %d got %s from its remapped list but %s from a fresh one"), i, *CachedForces[i].ToString(), *FreshForces[i].ToString()));
+		}
+	}
+	return true;
+}
+
+#undef OUU_TEST_CATEGORY
+#undef OUU_TEST_TYPE
+
+#endif
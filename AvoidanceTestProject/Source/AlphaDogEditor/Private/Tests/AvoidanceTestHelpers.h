@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "HAL/IConsoleManager.h"
+
+/** Shared by the avoidance tests that run with the game's console settings. */
+namespace AvoidanceTestHelpers
+{
+	inline bool GetConsoleBool(const TCHAR* Name)
+	{
+		const IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(Name);
+		return Variable && Variable->GetBool();
+	}
+
+	inline int32 GetConsoleInt(const TCHAR* Name)
+	{
+		const IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(Name);
+		return Variable ? Variable->GetInt() : 0;
+	}
+
+	inline float GetConsoleFloat(const TCHAR* Name, const float DefaultValue)
+	{
+		const IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(Name);
+		return Variable ? Variable->GetFloat() : DefaultValue;
+	}
+}
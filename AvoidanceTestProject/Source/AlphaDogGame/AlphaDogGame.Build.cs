@@ -1,4 +1,5 @@
-﻿using UnrealBuildTool;
+﻿using System.IO;
+using UnrealBuildTool;
 
 public class AlphaDogGame : ModuleRules
 {
@@ -6,6 +7,9 @@ public class AlphaDogGame : ModuleRules
     {
         PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
 
+        // The avoidance planner sits outside Public, expose it to the editor module's crowd benchmark
+        PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Avoidance"));
+
         PublicDependencyModuleNames.AddRange(
             new string[]
             {
@@ -21,6 +25,7 @@ public class AlphaDogGame : ModuleRules
                 "GameplayTasks",
                 "GMCCore",
                 "GMCAbilitySystem",
+                "MassEntity",
                 "CommonLoadingScreen",
                 "BeansGameplayTags",
                 "BeansIndicators",
@@ -50,6 +55,7 @@ public class AlphaDogGame : ModuleRules
                 "BeansLogging",
                 "AudioModulation",
                 "NavigationSystem",
+                "Navmesh",
                 "AudioMixer",
                 "EngineSettings",
                 "UMG",
@@ -0,0 +1,208 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceCapture.h"
+#include "HAL/FileManager.h"
+
+bool FAvoidanceCaptureWriter::Open(const FString& Filename)
+{
+    Close();
+    FArchive* Writer = IFileManager::Get().CreateFileWriter(*Filename);
+    if (!Writer)
+    {
+        return false;
+    }
+    File = MakeShareable(Writer);
+    Buffer.Reserve(FlushThreshold);
+    const FAvoidanceCaptureHeader Header;
+    Append(&Header, sizeof(Header));
+    return true;
+}
+
+void FAvoidanceCaptureWriter::Close()
+{
+    if (!File.IsValid())
+    {
+        return;
+    }
+    FlushBuffer();
+    WriteTask.Wait();
+    File->Close();
+    File.Reset();
+    Buffer.Empty();
+}
+
+void FAvoidanceCaptureWriter::WriteSpawn(const uint32 AgentId)
+{
+    const EAvoidanceCaptureRecord Record = EAvoidanceCaptureRecord::Spawn;
+    Append(&Record, sizeof(Record));
+    Append(&AgentId, sizeof(AgentId));
+}
+
+void FAvoidanceCaptureWriter::WriteDespawn(const int32 Slot)
+{
+    const EAvoidanceCaptureRecord Record = EAvoidanceCaptureRecord::Despawn;
+    Append(&Record, sizeof(Record));
+    Append(&Slot, sizeof(Slot));
+}
+
+void FAvoidanceCaptureWriter::WriteFrame(const float DeltaTime, const FAvoidanceAgentArrays& Agents, TConstArrayView<FVector> GoalVelocities,
+    TConstArrayView<EAvoidanceSolveMode> Modes)
+{
+    const int32 NumAgents = Agents.Num();
+    check(GoalVelocities.Num() == NumAgents && (Modes.IsEmpty() || Modes.Num() == NumAgents));
+    const EAvoidanceCaptureRecord Record = EAvoidanceCaptureRecord::Frame;
+    const uint8 bHasModes = !Modes.IsEmpty();
+    Append(&Record, sizeof(Record));
+    Append(&DeltaTime, sizeof(DeltaTime));
+    Append(&NumAgents, sizeof(NumAgents));
+    Append(&bHasModes, sizeof(bHasModes));
+
+    // The lanes are already SoA floats, only the goal velocities need narrowing
+    const int32 LaneBytes = NumAgents * sizeof(float);
+    for (const FAvoidanceAgentArrays::FFloatArray* Lane : { &Agents.PosX, &Agents.PosY, &Agents.PosZ, &Agents.VelX, &Agents.VelY, &Agents.VelZ })
+    {
+        Append(Lane->GetData(), LaneBytes);
+    }
+    for (int32 Axis = 0; Axis < 3; ++Axis)
+    {
+        const int32 Offset = Buffer.AddUninitialized(LaneBytes);
+        float* Out = reinterpret_cast<float*>(Buffer.GetData() + Offset);
+        for (int32 i = 0; i < NumAgents; ++i)
+        {
+            Out[i] = static_cast<float>(GoalVelocities[i][Axis]);
+        }
+        BytesWritten += LaneBytes;
+    }
+    Append(Agents.Radii.GetData(), LaneBytes);
+    if (bHasModes)
+    {
+        Append(Modes.GetData(), Modes.Num() * sizeof(EAvoidanceSolveMode));
+    }
+
+    if (Buffer.Num() >= FlushThreshold)
+    {
+        FlushBuffer();
+    }
+}
+
+void FAvoidanceCaptureWriter::Append(const void* Data, const int32 NumBytes)
+{
+    Buffer.Append(static_cast<const uint8*>(Data), NumBytes);
+    BytesWritten += NumBytes;
+}
+
+void FAvoidanceCaptureWriter::FlushBuffer()
+{
+    if (Buffer.IsEmpty())
+    {
+        return;
+    }
+    WriteTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [File = File, Data = MoveTemp(Buffer)]() mutable
+    {
+        File->Serialize(Data.GetData(), Data.Num());
+    }, UE::Tasks::Prerequisites(WriteTask));
+    Buffer.Reset(FlushThreshold);
+}
+
+bool FAvoidanceCaptureReader::Open(const FString& Filename)
+{
+    File.Reset(IFileManager::Get().CreateFileReader(*Filename));
+    bError = false;
+    if (!File)
+    {
+        return false;
+    }
+    FAvoidanceCaptureHeader Header;
+    File->Serialize(&Header, sizeof(Header));
+    bError = File->IsError() || Header.Magic != FAvoidanceCaptureHeader::ExpectedMagic || Header.Version != FAvoidanceCaptureHeader::CurrentVersion;
+    return !bError;
+}
+
+bool FAvoidanceCaptureReader::ReadFrame(FAvoidanceCaptureFrame& InOutFrame)
+{
+    if (!File || bError)
+    {
+        return false;
+    }
+    InOutFrame.NumSpawns = 0;
+    InOutFrame.NumDespawns = 0;
+    InOutFrame.SlotSources.SetNumUninitialized(InOutFrame.AgentIds.Num(), EAllowShrinking::No);
+    for (int32 i = 0; i < InOutFrame.SlotSources.Num(); ++i)
+    {
+        InOutFrame.SlotSources[i] = i;
+    }
+    while (!File->AtEnd())
+    {
+        EAvoidanceCaptureRecord Record;
+        File->Serialize(&Record, sizeof(Record));
+        if (Record == EAvoidanceCaptureRecord::Spawn)
+        {
+            uint32 AgentId = 0;
+            File->Serialize(&AgentId, sizeof(AgentId));
+            InOutFrame.AgentIds.Add(AgentId);
+            InOutFrame.SlotSources.Add(INDEX_NONE);
+            ++InOutFrame.NumSpawns;
+        }
+        else if (Record == EAvoidanceCaptureRecord::Despawn)
+        {
+            int32 Slot = INDEX_NONE;
+            File->Serialize(&Slot, sizeof(Slot));
+            if (!InOutFrame.AgentIds.IsValidIndex(Slot))
+            {
+                bError = true;
+                return false;
+            }
+            InOutFrame.AgentIds.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+            InOutFrame.SlotSources.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+            ++InOutFrame.NumDespawns;
+        }
+        else if (Record == EAvoidanceCaptureRecord::Frame)
+        {
+            int32 NumAgents = 0;
+            uint8 bHasModes = 0;
+            File->Serialize(&InOutFrame.DeltaTime, sizeof(InOutFrame.DeltaTime));
+            File->Serialize(&NumAgents, sizeof(NumAgents));
+            File->Serialize(&bHasModes, sizeof(bHasModes));
+            if (NumAgents != InOutFrame.AgentIds.Num())
+            {
+                bError = true; // Events and frames disagree on the agent count
+                return false;
+            }
+
+            FAvoidanceAgentArrays& Agents = InOutFrame.Agents;
+            Agents.SetNum(NumAgents);
+            for (FAvoidanceAgentArrays::FFloatArray* Lane : { &Agents.PosX, &Agents.PosY, &Agents.PosZ, &Agents.VelX, &Agents.VelY, &Agents.VelZ })
+            {
+                ReadFloats(*Lane, NumAgents);
+            }
+            InOutFrame.GoalVelocities.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+            for (int32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Scratch.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+                File->Serialize(Scratch.GetData(), NumAgents * sizeof(float));
+                for (int32 i = 0; i < NumAgents; ++i)
+                {
+                    InOutFrame.GoalVelocities[i][Axis] = Scratch[i];
+                }
+            }
+            ReadFloats(Agents.Radii, NumAgents);
+            InOutFrame.Modes.SetNumUninitialized(bHasModes ? NumAgents : 0, EAllowShrinking::No);
+            File->Serialize(InOutFrame.Modes.GetData(), InOutFrame.Modes.Num() * sizeof(EAvoidanceSolveMode));
+            bError = File->IsError();
+            return !bError;
+        }
+        else
+        {
+            bError = true;
+            return false;
+        }
+    }
+    return false;
+}
+
+void FAvoidanceCaptureReader::ReadFloats(FAvoidanceAgentArrays::FFloatArray& Out, const int32 Num)
+{
+    File->Serialize(Out.GetData(), Num * sizeof(float));
+    // SetNum keeps stale values in padding lanes when shrinking, the kernel expects them zeroed
+    FMemory::Memzero(Out.GetData() + Num, (Out.Num() - Num) * sizeof(float));
+}
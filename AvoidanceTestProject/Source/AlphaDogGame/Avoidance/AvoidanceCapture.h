@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AvoidanceKernel.h"
+#include "Tasks/Task.h"
+
+/**
+ * Binary recording of the agent state the planner hands to the force solve, one frame per solve plus spawn and despawn events.
+ * Slots follow the planner's: a spawn appends an agent and a despawn moves the last agent into the freed slot,
+ * so a reader replaying the events sees every frame in the slot order the solve saw.
+ *
+ * Layout, native endian: FAvoidanceCaptureHeader, then records of one EAvoidanceCaptureRecord byte followed by
+ *   Spawn:   uint32 AgentId
+ *   Despawn: int32 Slot
+ *   Frame:   float DeltaTime, int32 NumAgents, uint8 bHasModes, then NumAgents floats each of
+ *            PosX, PosY, PosZ, VelX, VelY, VelZ, GoalVelX, GoalVelY, GoalVelZ, Radii, and NumAgents EAvoidanceSolveMode bytes if bHasModes
+ */
+enum class EAvoidanceCaptureRecord : uint8
+{
+	Spawn,
+	Despawn,
+	Frame,
+};
+
+struct FAvoidanceCaptureHeader
+{
+	static constexpr uint32 ExpectedMagic = 0x43414441; // "ADAC"
+	static constexpr uint32 CurrentVersion = 1;
+
+	uint32 Magic = ExpectedMagic;
+	uint32 Version = CurrentVersion;
+};
+
+/**
+ * Streams a capture to disk. Records are appended to a memory buffer, and full buffers are written by a background task
+ * chained after the previous one, so the game thread never waits on the file.
+ */
+class ALPHADOGGAME_API FAvoidanceCaptureWriter
+{
+public:
+	~FAvoidanceCaptureWriter() { Close(); }
+
+	bool Open(const FString& Filename);
+	// Writes out what is buffered and waits for it
+	void Close();
+	bool IsOpen() const { return File.IsValid(); }
+
+	void WriteSpawn(uint32 AgentId);
+	void WriteDespawn(int32 Slot);
+	// Modes may be empty when every agent is fully solved
+	void WriteFrame(float DeltaTime, const FAvoidanceAgentArrays& Agents, TConstArrayView<FVector> GoalVelocities, TConstArrayView<EAvoidanceSolveMode> Modes);
+
+	int64 GetBytesWritten() const { return BytesWritten; }
+
+private:
+	void Append(const void* Data, int32 NumBytes);
+	void FlushBuffer();
+
+	static constexpr int32 FlushThreshold = 1 << 20;
+
+	TSharedPtr<FArchive, ESPMode::ThreadSafe> File; // Only touched by WriteTask while it runs
+	TArray<uint8> Buffer;
+	UE::Tasks::FTask WriteTask;
+	int64 BytesWritten = 0;
+};
+
+/** Agent state of one recorded solve, in the planner's slot order at the time. */
+struct FAvoidanceCaptureFrame
+{
+	float DeltaTime = 0.0f;
+	FAvoidanceAgentArrays Agents;
+	TArray<FVector> GoalVelocities;
+	TArray<EAvoidanceSolveMode> Modes; // Empty when every agent was fully solved
+	TArray<uint32> AgentIds; // Spawn id of each slot
+	int32 NumSpawns = 0; // Events applied since the previous frame
+	int32 NumDespawns = 0;
+	TArray<int32> SlotSources; // Slot each agent had in the previous frame, INDEX_NONE for spawns
+};
+
+/** Reads a capture back one frame at a time, applying the spawn and despawn events in between. */
+class ALPHADOGGAME_API FAvoidanceCaptureReader
+{
+public:
+	bool Open(const FString& Filename);
+
+	// Applies the events up to the next frame and reads it into InOutFrame, which must be the one passed on the previous call.
+	// False at the end of the capture, or if it is malformed, see HasError.
+	bool ReadFrame(FAvoidanceCaptureFrame& InOutFrame);
+	bool HasError() const { return bError; }
+
+private:
+	void ReadFloats(FAvoidanceAgentArrays::FFloatArray& Out, int32 Num);
+
+	TUniquePtr<FArchive> File;
+	TArray<float> Scratch;
+	bool bError = false;
+};
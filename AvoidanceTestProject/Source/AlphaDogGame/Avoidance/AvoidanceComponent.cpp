@@ -2,6 +2,7 @@
 #include "AvoidanceComponent.h"
 
 #include "AlphaDogGame.h"
+#include "AvoidancePlannerSubsystem.h"
 #include "GMCPawn.h"
 #include "NavigationPath.h"
 #include "NavigationSystem.h"
@@ -9,6 +10,16 @@
 #include "DrawDebugHelpers.h"
 #include "NavigationInvokerComponent.h"
 
+namespace AvoidanceConsoleVariables
+{
+    static int32 LineOfSightStagger = 4;
+    static FAutoConsoleVariableRef CVarLineOfSightStagger(
+        TEXT("AlphaDog.Avoidance.LineOfSightStagger"),
+        LineOfSightStagger,
+        TEXT("Each agent issues its async obstacle trace once every this many frames, agents are spread across the frames by slot."),
+        ECVF_Default);
+}
+
 UAvoidanceComponent::UAvoidanceComponent()
 {
     PrimaryComponentTick.bCanEverTick = true;
@@ -19,44 +30,87 @@ void UAvoidanceComponent::BeginPlay()
 {
     Super::BeginPlay();
     ActorIns = Cast<AGMC_Pawn>(GetOwner());
-    NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+    if (!GetOwner()->HasAuthority())
+    {
+        // Avoidance is server authoritative, proxies are moved and smoothed by UAvoidanceMovementComponent through GMC
+        SetComponentTickEnabled(false);
+        return;
+    }
+    if (bMassAgent)
+    {
+        // The agent's Mass entity keeps its goal, flow field and slot in the solve, this pawn only gives it a body
+        bDrivenByPlanner = true;
+        SetComponentTickEnabled(false);
+        return;
+    }
+    LineOfSightTraceDelegate.BindUObject(this, &UAvoidanceComponent::OnLineOfSightTraceDone);
+    // Tiles around the invoker are regenerated by the navigation system, the planner repaths us if our corridor is touched
     if (NavInvokerComponent)
     {
         NavInvokerComponent->Activate(true);
     }
-    // Periodically request navmesh updates
-    GetWorld()->GetTimerManager().SetTimer(NavMeshUpdateTimer, this, &UAvoidanceComponent::UpdateNavMesh, 1.0f, true);
 
     if (const AActor* GoalActor = FindFirstActorWithTag(GetWorld(), FName("GoalPoint")))
     {
         GoalLocation = GoalActor->GetActorLocation();
     }
-    FindNewPath();
+    // Head straight for the goal until the first path arrives
+    NextLocation = GoalLocation;
+
+    UAvoidancePlannerSubsystem* Planner = GetWorld()->GetSubsystem<UAvoidancePlannerSubsystem>();
+    if (Planner)
+    {
+        Planner->RegisterAgent(this);
+    }
+    if (!bUseFlowField || !Planner || Planner->AcquireFlowField(this) == INDEX_NONE)
+    {
+        FindNewPath();
+    }
+}
+
+void UAvoidanceComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (UAvoidancePlannerSubsystem* Planner = GetWorld()->GetSubsystem<UAvoidancePlannerSubsystem>())
+    {
+        Planner->ReleaseFlowField(this);
+        Planner->UnregisterAgent(this);
+    }
+    Super::EndPlay(EndPlayReason);
 }
 
 void UAvoidanceComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
     Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+    if (bSteppedByPlanner)
+    {
+        return;
+    }
+
     if (bHasGoal)
     {
-        const float DistanceToGoal = FVector::Dist(ActorIns->GetActorLocation(), GoalLocation);
+        const FVector Location = ActorIns->GetActorLocation();
+        const float DistanceToGoal = FVector::Dist(Location, GoalLocation);
 
         if (DistanceToGoal <= StopRadius)
         {
-            GoalLocation = FVector::ZeroVector;
-            CombinedVelocity = FVector::ZeroVector;
-            bHasReachGoal = true;
+            ReachGoal();
+        }
+        else if (FlowFieldHandle != INDEX_NONE)
+        {
+            // The shared field already routes around obstacles, there is no path of our own to maintain
+            ApplySteering(DeltaTime);
         }
         else
         {
             ApplySteering(DeltaTime);
+            RequestLineOfSightTrace();
             // Adjust path if necessary or follow the path points
-            if (FVector::Dist(ActorIns->GetActorLocation(), NextLocation) < 100.0f)
+            if (FVector::Dist(Location, NextLocation) < 100.0f)
             {
-                UpdatePathPoints();
+                UpdatePathPoints(Location);
             }
-            if (ShouldRecalculatePath())
+            if (ShouldRecalculatePath(Location))
             {
                 FindNewPath();
             }
@@ -66,8 +120,11 @@ void UAvoidanceComponent::TickComponent(float DeltaTime, ELevelTick TickType, FA
 
 void UAvoidanceComponent::ApplySteering(float DeltaTime)
 {
-    // Calculate the desired velocity towards the next path point
-    DesiredVelocity = (NextLocation - ActorIns->GetActorLocation()).GetSafeNormal() * MovementSpeed;
+    DesiredVelocity = ComputeDesiredVelocity(ActorIns->GetActorLocation());
+    if (bDrivenByPlanner)
+    {
+        return;
+    }
     CombinedVelocity = DesiredVelocity + AvoidanceVelocity;
     CombinedVelocity = CombinedVelocity.GetClampedToMaxSize(MovementSpeed); 
     // Apply the combined velocity as movement input
@@ -75,70 +132,137 @@ void UAvoidanceComponent::ApplySteering(float DeltaTime)
     AvoidanceVelocity = FVector::ZeroVector;
 }
 
+FVector UAvoidanceComponent::ComputeDesiredVelocity(const FVector& Location) const
+{
+    FVector Direction;
+    const UAvoidancePlannerSubsystem* Planner = FlowFieldHandle != INDEX_NONE ? GetWorld()->GetSubsystem<UAvoidancePlannerSubsystem>() : nullptr;
+    if (!Planner || !Planner->GetFlowFieldDirection(this, Location, Direction))
+    {
+        Direction = (NextLocation - Location).GetSafeNormal();
+    }
+    return Direction * MovementSpeed;
+}
+
+FVector UAvoidanceComponent::StepGoal(const FVector& Location)
+{
+    if (!bHasGoal || bHasReachGoal)
+    {
+        return FVector::ZeroVector;
+    }
+    if (FVector::Dist(Location, GoalLocation) <= StopRadius)
+    {
+        ReachGoal();
+        return FVector::ZeroVector;
+    }
+    // No line of sight traces here, their results land on frame boundaries. Deviation repaths still go through UpdatePathPoints
+    if (FlowFieldHandle == INDEX_NONE && FVector::Dist(Location, NextLocation) < 100.0f)
+    {
+        UpdatePathPoints(Location);
+    }
+    DesiredVelocity = ComputeDesiredVelocity(Location);
+    return DesiredVelocity;
+}
+
+void UAvoidanceComponent::ReachGoal()
+{
+    GoalLocation = FVector::ZeroVector;
+    CombinedVelocity = FVector::ZeroVector;
+    bHasReachGoal = true;
+    if (FlowFieldHandle != INDEX_NONE)
+    {
+        GetWorld()->GetSubsystem<UAvoidancePlannerSubsystem>()->ReleaseFlowField(this);
+    }
+}
+
 void UAvoidanceComponent::FindNewPath()
 {
-    if (NavSystem && !GoalLocation.IsNearlyZero())
+    // Queued on the planner and resolved asynchronously, keep following the current path until OnPathFound
+    if (!GoalLocation.IsNearlyZero())
     {
-        const UNavigationPath* NavPath = NavSystem->FindPathToLocationSynchronously(GetWorld(), ActorIns->GetActorLocation(), GoalLocation);
-        if (NavPath && NavPath->PathPoints.Num() > 1)
-        {
-            PathPoints = NavPath->PathPoints;
-            NextLocation = PathPoints[1];  // Move to the second point in the path
-        }
-        else
+        if (UAvoidancePlannerSubsystem* Planner = GetWorld()->GetSubsystem<UAvoidancePlannerSubsystem>())
         {
-            NextLocation = GoalLocation;
-            PathPoints.Empty();  // Clear path points as only the goal remains
+            Planner->RequestPath(this);
         }
     }
 }
 
-void UAvoidanceComponent::UpdatePathPoints()
+void UAvoidanceComponent::OnPathFound(const FNavPathSharedPtr& NavPath)
+{
+    if (NavPath.IsValid() && NavPath->GetPathPoints().Num() > 1)
+    {
+        PathCorridor.Assign(NavPath->GetPathPoints(), NavPath->GetNavigationDataUsed());
+        // The agent kept moving while the query was in flight, it may already see past the first corners
+        PathCorridor.Shortcut(ActorIns->GetActorLocation(), MaxShortcutLookahead);
+        NextLocation = PathCorridor.GetCurrentPoint();
+    }
+    else
+    {
+        NextLocation = GoalLocation;
+        PathCorridor.Reset();  // Clear path points as only the goal remains
+    }
+}
+
+void UAvoidanceComponent::UpdatePathPoints(const FVector& Location)
 {
-    if (PathPoints.Num() > 1)
+    PathCorridor.Advance();
+    if (!PathCorridor.IsFinished())
     {
-        // Remove the first path point and move to the next
-        PathPoints.RemoveAt(0);
-        NextLocation = PathPoints[0];
+        PathCorridor.Shortcut(Location, MaxShortcutLookahead);
+        NextLocation = PathCorridor.GetCurrentPoint();
     }
     else
     {
         NextLocation = GoalLocation;
     }
 
-    if (ShouldRecalculatePath())
+    if (ShouldRecalculatePath(Location))
     {
         FindNewPath();
     }
 }
 
-bool UAvoidanceComponent::ShouldRecalculatePath() const
+bool UAvoidanceComponent::ShouldRecalculatePath(const FVector& Location)
 {
     // Check if the actor has deviated too far from the current path
     constexpr float DeviationThreshold = 200.0f;
-    if (FVector::Dist(ActorIns->GetActorLocation(), NextLocation) > DeviationThreshold)
+    if (FVector::Dist(Location, NextLocation) > DeviationThreshold)
     {
         return true;
     }
-    const FVector TraceStart = ActorIns->GetActorLocation();
-    const FVector TraceEnd = TraceStart + CombinedVelocity.GetSafeNormal() * 500.0f; 
-    FHitResult HitResult;
-    FCollisionQueryParams QueryParams;
-    QueryParams.bReturnPhysicalMaterial = false;
-    QueryParams.AddIgnoredActor(ActorIns);
-    if (GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, ECC_Visibility, QueryParams))
+    // An obstacle reported by the last staggered trace repaths once, not on every frame until the next trace lands
+    if (bLineOfSightBlocked)
     {
-        //If there's an obstacle, recalculate the path
+        bLineOfSightBlocked = false;
         return true;
     }
-    return false;  
+    return false;
+}
+
+void UAvoidanceComponent::RequestLineOfSightTrace()
+{
+    const uint64 Stagger = FMath::Max(AvoidanceConsoleVariables::LineOfSightStagger, 1);
+    if (GetWorld()->IsTraceHandleValid(LineOfSightTraceHandle, false) || (GFrameCounter + static_cast<uint64>(FMath::Max(AvoidanceSlot, 0))) % Stagger != 0)
+    {
+        return;
+    }
+    const FVector TraceStart = ActorIns->GetActorLocation();
+    // Before the planner's first solve reaches the agent only the desired velocity is known
+    const FVector& TraceVelocity = CombinedVelocity.IsNearlyZero() ? DesiredVelocity : CombinedVelocity;
+    const FVector TraceEnd = TraceStart + TraceVelocity.GetSafeNormal() * 500.0f;
+    FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AvoidanceLineOfSight));
+    QueryParams.bReturnPhysicalMaterial = false;
+    QueryParams.AddIgnoredActor(ActorIns);
+    LineOfSightTraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, TraceStart, TraceEnd, ECC_Visibility,
+        QueryParams, FCollisionResponseParams::DefaultResponseParam, &LineOfSightTraceDelegate);
 }
 
-void UAvoidanceComponent::UpdateNavMesh()
+void UAvoidanceComponent::OnLineOfSightTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
 {
-    if (NavSystem)
+    if (TraceHandle != LineOfSightTraceHandle)
     {
-        NavSystem->Build();
-        FindNewPath(); 
+        return;
     }
+    LineOfSightTraceHandle = FTraceHandle();
+    //If there's an obstacle, recalculate the path
+    bLineOfSightBlocked = FHitResult::GetFirstBlockingHit(TraceDatum.OutHits) != nullptr;
 }
@@ -3,7 +3,10 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "AvoidancePathCorridor.h"
 #include "Components/ActorComponent.h"
+#include "NavigationData.h"
+#include "WorldCollision.h"
 #include "AvoidanceComponent.generated.h"
 
 class UNavigationInvokerComponent;
@@ -21,6 +24,7 @@ public:
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
@@ -31,8 +35,13 @@ public:
 	FVector DesiredVelocity; // Desired velocity based on the navigation system
 	FVector CombinedVelocity; // Final combined velocity
 	FVector NextLocation;
-	TArray<FVector> PathPoints;
+	FAvoidancePathCorridor PathCorridor;
+	static constexpr int32 MaxShortcutLookahead = 3; // Waypoints past the current one tested for a straight navmesh shortcut
 	void ApplySteering(float DeltaTime);
+	// Along the flow field, or towards the next path point, at MovementSpeed
+	FVector ComputeDesiredVelocity(const FVector& Location) const;
+	// Deterministic mode: goal arrival and path following from the simulated Location, once per fixed step. Returns the velocity to seek
+	FVector StepGoal(const FVector& Location);
 
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category= "Movement")
@@ -51,21 +60,38 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Movement")
 	float MovementSpeed = 50;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Goal")
-	bool bDebug = true;
+	bool bDebug = false;
+	// Follow a flow field shared with every agent heading to the same goal instead of pathfinding individually
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Goal")
+	bool bUseFlowField = false;
 	
 public:
-	UPROPERTY()
-	class UNavigationSystemV1* NavSystem = nullptr;
 	UPROPERTY()
 	UNavigationInvokerComponent* NavInvokerComponent;
-	FTimerHandle NavMeshUpdateTimer;
 	void FindNewPath();
-	bool ShouldRecalculatePath() const;
-	void UpdatePathPoints();
-	void UpdateNavMesh();
+	void OnPathFound(const FNavPathSharedPtr& NavPath);
+	bool ShouldRecalculatePath(const FVector& Location);
+	void UpdatePathPoints(const FVector& Location);
+	void ReachGoal();
+	void RequestLineOfSightTrace();
+	void OnLineOfSightTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
 	
 	UPROPERTY()
 	TObjectPtr<AGMC_Pawn>ActorIns;
 
+	int32 AvoidanceSlot = INDEX_NONE; // Index into the planner's agent arrays, owned by UAvoidancePlannerSubsystem
+	uint32 PathQueryId = INVALID_NAVQUERYID; // Async query in flight, owned by UAvoidancePlannerSubsystem
+	bool bPathRequestQueued = false;
+	bool bRepathWhenDelivered = false; // A repath was requested while a query was in flight
+	int32 FlowFieldHandle = INDEX_NONE; // Shared flow field being followed, owned by UAvoidancePlannerSubsystem
+	double LastPathlessRetryTime = TNumericLimits<double>::Lowest(); // Last time a navmesh tile rebuild retried the path of this agent while it had none
+
+	FTraceDelegate LineOfSightTraceDelegate;
+	FTraceHandle LineOfSightTraceHandle; // Async trace in flight, results land next frame
+	bool bLineOfSightBlocked = false; // Latest trace result, consumed by ShouldRecalculatePath
+	bool bDrivenByPlanner = false; // The planner moves the pawn, through its movement component or by placing it in deterministic mode, ApplySteering only computes DesiredVelocity
+	bool bSteppedByPlanner = false; // Deterministic mode, the tick leaves goal arrival and path following to StepGoal so they advance with the fixed steps
+	bool bMassAgent = false; // Stands in for a Mass agent near players and is moved by UAvoidanceMassProcessor, set before BeginPlay
+
 	
 };
@@ -0,0 +1,378 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceFlowField.h"
+#include "NavigationData.h"
+
+// Orthogonal neighbours first, diagonals after, so Integrate can look up the two orthogonals a diagonal cuts past
+const FIntPoint FAvoidanceFlowField::NeighbourOffsets[8] =
+{
+    FIntPoint(1, 0), FIntPoint(0, 1), FIntPoint(-1, 0), FIntPoint(0, -1),
+    FIntPoint(1, 1), FIntPoint(-1, 1), FIntPoint(-1, -1), FIntPoint(1, -1)
+};
+
+const FVector FAvoidanceFlowField::NeighbourDirections[8] =
+{
+    FVector(1.0, 0.0, 0.0), FVector(0.0, 1.0, 0.0), FVector(-1.0, 0.0, 0.0), FVector(0.0, -1.0, 0.0),
+    FVector(UE_INV_SQRT_2, UE_INV_SQRT_2, 0.0), FVector(-UE_INV_SQRT_2, UE_INV_SQRT_2, 0.0),
+    FVector(-UE_INV_SQRT_2, -UE_INV_SQRT_2, 0.0), FVector(UE_INV_SQRT_2, -UE_INV_SQRT_2, 0.0)
+};
+
+const float FAvoidanceFlowField::StepCosts[8] = { 1.0f, 1.0f, 1.0f, 1.0f, UE_SQRT_2, UE_SQRT_2, UE_SQRT_2, UE_SQRT_2 };
+
+bool FAvoidanceFlowField::Build(const ANavigationData& InNavData, const FVector& Goal, const float InCellSize, const float MaxHalfExtent)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceFlowField_Build);
+    check(InCellSize > 0.0f);
+    Reset();
+
+    const FBox NavBounds = InNavData.GetBounds();
+    const FBox FieldBounds = NavBounds.Overlap(FBox::BuildAABB(Goal, FVector(MaxHalfExtent, MaxHalfExtent, NavBounds.GetExtent().Z)));
+    if (!FieldBounds.IsValid || !FieldBounds.IsInsideXY(Goal))
+    {
+        return false;
+    }
+
+    NavData = &InNavData;
+    GoalLocation = Goal;
+    CellSize = InCellSize;
+    InvCellSize = 1.0f / InCellSize;
+    Origin = FVector2D(FieldBounds.Min);
+    Size = FIntPoint(
+        FMath::Max(1, FMath::CeilToInt32(FieldBounds.GetSize().X * InvCellSize)),
+        FMath::Max(1, FMath::CeilToInt32(FieldBounds.GetSize().Y * InvCellSize)));
+
+    const int32 NumCells = Size.X * Size.Y;
+    Walkable.Init(false, NumCells);
+    GoalCell = GetCellIndex(Goal);
+
+    if (GoalCell == INDEX_NONE)
+    {
+        Reset();
+        return false;
+    }
+    // Only the goal is checked up front, the rest of the grid is sampled by ContinueBuild
+    const FIntPoint GoalCellXY(GoalCell % Size.X, GoalCell / Size.X);
+    SampleCells(InNavData, GoalCellXY, GoalCellXY);
+    if (!Walkable[GoalCell])
+    {
+        Reset();
+        return false;
+    }
+    NextSampleRow = 0;
+    return true;
+}
+
+bool FAvoidanceFlowField::ContinueBuild(const double EndTime)
+{
+    if (!IsBuilding())
+    {
+        return IsBuilt();
+    }
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceFlowField_ContinueBuild);
+
+    if (NextSampleRow < Size.Y)
+    {
+        const ANavigationData* InNavData = NavData.Get();
+        if (!InNavData)
+        {
+            Reset();
+            return false;
+        }
+        do
+        {
+            SampleCells(*InNavData, FIntPoint(0, NextSampleRow), FIntPoint(Size.X - 1, NextSampleRow));
+            ++NextSampleRow;
+        }
+        while (NextSampleRow < Size.Y && FPlatformTime::Seconds() < EndTime);
+
+        if (NextSampleRow == Size.Y)
+        {
+            LaunchIntegration();
+        }
+        return false;
+    }
+
+    if (!IntegrationTask.IsCompleted())
+    {
+        return false;
+    }
+    if (bResampledDuringIntegration)
+    {
+        LaunchIntegration();
+        return false;
+    }
+    FIntegration& Result = IntegrationTask.GetResult();
+    Integration = MoveTemp(Result.Costs);
+    FlowDirections = MoveTemp(Result.Directions);
+    IntegrationTask = UE::Tasks::TTask<FIntegration>();
+    return true;
+}
+
+void FAvoidanceFlowField::LaunchIntegration()
+{
+    bResampledDuringIntegration = false;
+    IntegrationTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [GridSize = Size, InGoalCell = GoalCell, InWalkable = Walkable]()
+    {
+        FIntegration Result;
+        Integrate(GridSize, InGoalCell, InWalkable, Result);
+        return Result;
+    });
+}
+
+void FAvoidanceFlowField::RebuildArea(const ANavigationData& InNavData, TConstArrayView<FBox> DirtyBounds)
+{
+    if (GoalCell == INDEX_NONE)
+    {
+        return;
+    }
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceFlowField_RebuildArea);
+
+    // While sampling, rows not reached yet will see the rebuilt tiles anyway
+    const int32 NumSampledRows = IsBuilding() ? NextSampleRow : Size.Y;
+    TArray<int32> ChangedCells;
+    for (const FBox& Bounds : DirtyBounds)
+    {
+        const FIntPoint MinCell(
+            FMath::Max(0, FMath::FloorToInt32((Bounds.Min.X - Origin.X) * InvCellSize)),
+            FMath::Max(0, FMath::FloorToInt32((Bounds.Min.Y - Origin.Y) * InvCellSize)));
+        const FIntPoint MaxCell(
+            FMath::Min(Size.X - 1, FMath::FloorToInt32((Bounds.Max.X - Origin.X) * InvCellSize)),
+            FMath::Min(NumSampledRows - 1, FMath::FloorToInt32((Bounds.Max.Y - Origin.Y) * InvCellSize)));
+        if (MinCell.X <= MaxCell.X && MinCell.Y <= MaxCell.Y)
+        {
+            SampleCells(InNavData, MinCell, MaxCell, &ChangedCells);
+        }
+    }
+    if (ChangedCells.IsEmpty())
+    {
+        return;
+    }
+    if (IsBuilding())
+    {
+        // The running integration copied the old walkability, it is redone once it finishes
+        bResampledDuringIntegration |= NextSampleRow == Size.Y;
+        return;
+    }
+    Repair(ChangedCells);
+}
+
+void FAvoidanceFlowField::Reset()
+{
+    NavData.Reset();
+    Size = FIntPoint::ZeroValue;
+    GoalCell = INDEX_NONE;
+    Walkable.Reset();
+    Integration.Reset();
+    FlowDirections.Reset();
+    NextSampleRow = 0;
+    IntegrationTask = UE::Tasks::TTask<FIntegration>();
+    bResampledDuringIntegration = false;
+}
+
+void FAvoidanceFlowField::SampleCells(const ANavigationData& InNavData, const FIntPoint& MinCell, const FIntPoint& MaxCell, TArray<int32>* OutChangedCells)
+{
+    const FBox NavBounds = InNavData.GetBounds();
+    // Any navmesh within the cell footprint and the navmesh height range counts as walkable
+    const FVector Extent(CellSize * 0.5f, CellSize * 0.5f, NavBounds.GetExtent().Z);
+    const double CenterZ = NavBounds.GetCenter().Z;
+
+    FNavLocation Projected;
+    for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+    {
+        for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+        {
+            const FVector Center(Origin.X + (CellX + 0.5) * CellSize, Origin.Y + (CellY + 0.5) * CellSize, CenterZ);
+            const bool bWalkable = InNavData.ProjectPoint(Center, Projected, Extent);
+            const int32 Cell = CellY * Size.X + CellX;
+            if (OutChangedCells && Walkable[Cell] != bWalkable)
+            {
+                OutChangedCells->Add(Cell);
+            }
+            Walkable[Cell] = bWalkable;
+        }
+    }
+}
+
+bool FAvoidanceFlowField::CanStep(const FIntPoint& GridSize, const TArray<bool>& InWalkable, const int32 CellX, const int32 CellY, const int32 Neighbour)
+{
+    const FIntPoint To(CellX + NeighbourOffsets[Neighbour].X, CellY + NeighbourOffsets[Neighbour].Y);
+    if (To.X < 0 || To.Y < 0 || To.X >= GridSize.X || To.Y >= GridSize.Y || !InWalkable[To.Y * GridSize.X + To.X])
+    {
+        return false;
+    }
+    if (Neighbour >= 4)
+    {
+        return InWalkable[CellY * GridSize.X + To.X] && InWalkable[To.Y * GridSize.X + CellX];
+    }
+    return true;
+}
+
+void FAvoidanceFlowField::Propagate(const FIntPoint& GridSize, const TArray<bool>& InWalkable, TArray<float>& Costs, TArray<TPair<float, int32>>& Open,
+    TArray<int32>* OutLowered)
+{
+    const auto CheapestFirst = [](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; };
+    Open.Heapify(CheapestFirst);
+    while (!Open.IsEmpty())
+    {
+        TPair<float, int32> Current;
+        Open.HeapPop(Current, CheapestFirst, EAllowShrinking::No);
+        if (Current.Key > Costs[Current.Value])
+        {
+            continue; // Stale entry, the cell was already settled cheaper
+        }
+        const int32 CellX = Current.Value % GridSize.X;
+        const int32 CellY = Current.Value / GridSize.X;
+        for (int32 Neighbour = 0; Neighbour < 8; ++Neighbour)
+        {
+            if (!CanStep(GridSize, InWalkable, CellX, CellY, Neighbour))
+            {
+                continue;
+            }
+            const int32 NeighbourCell = (CellY + NeighbourOffsets[Neighbour].Y) * GridSize.X + CellX + NeighbourOffsets[Neighbour].X;
+            const float Cost = Current.Key + StepCosts[Neighbour];
+            if (Cost < Costs[NeighbourCell])
+            {
+                Costs[NeighbourCell] = Cost;
+                Open.HeapPush(TPair<float, int32>(Cost, NeighbourCell), CheapestFirst);
+                if (OutLowered)
+                {
+                    OutLowered->Add(NeighbourCell);
+                }
+            }
+        }
+    }
+}
+
+uint8 FAvoidanceFlowField::FindFlowDirection(const FIntPoint& GridSize, const TArray<bool>& InWalkable, const TArray<float>& Costs, const int32 InGoalCell, const int32 Cell)
+{
+    // The goal cell has no direction, agents in it steer straight at the goal location
+    uint8 BestNeighbour = NoDirection;
+    if (Cell != InGoalCell && Costs[Cell] < FLT_MAX)
+    {
+        const int32 CellX = Cell % GridSize.X;
+        const int32 CellY = Cell / GridSize.X;
+        float BestCost = Costs[Cell];
+        for (int32 Neighbour = 0; Neighbour < 8; ++Neighbour)
+        {
+            if (CanStep(GridSize, InWalkable, CellX, CellY, Neighbour))
+            {
+                const float NeighbourCost = Costs[(CellY + NeighbourOffsets[Neighbour].Y) * GridSize.X + CellX + NeighbourOffsets[Neighbour].X];
+                if (NeighbourCost < BestCost)
+                {
+                    BestCost = NeighbourCost;
+                    BestNeighbour = static_cast<uint8>(Neighbour);
+                }
+            }
+        }
+    }
+    return BestNeighbour;
+}
+
+void FAvoidanceFlowField::Integrate(const FIntPoint& GridSize, const int32 InGoalCell, const TArray<bool>& InWalkable, FIntegration& Out)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceFlowField_Integrate);
+    const int32 NumCells = InWalkable.Num();
+    Out.Costs.Init(FLT_MAX, NumCells);
+    Out.Costs[InGoalCell] = 0.0f;
+    TArray<TPair<float, int32>> Open;
+    Open.Emplace(0.0f, InGoalCell);
+    Propagate(GridSize, InWalkable, Out.Costs, Open, nullptr);
+
+    Out.Directions.SetNumUninitialized(NumCells);
+    for (int32 Cell = 0; Cell < NumCells; ++Cell)
+    {
+        Out.Directions[Cell] = FindFlowDirection(GridSize, InWalkable, Out.Costs, InGoalCell, Cell);
+    }
+}
+
+void FAvoidanceFlowField::Repair(TConstArrayView<int32> ChangedCells)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceFlowField_Repair);
+    const int32 NumCells = Walkable.Num();
+    TBitArray<> Invalid(false, NumCells);
+    TArray<int32> Invalidated;
+    const auto ForEachNeighbour = [this](const int32 Cell, auto&& Func)
+    {
+        const int32 CellX = Cell % Size.X;
+        const int32 CellY = Cell / Size.X;
+        for (int32 Neighbour = 0; Neighbour < 8; ++Neighbour)
+        {
+            const FIntPoint To(CellX + NeighbourOffsets[Neighbour].X, CellY + NeighbourOffsets[Neighbour].Y);
+            if (To.X >= 0 && To.Y >= 0 && To.X < Size.X && To.Y < Size.Y)
+            {
+                Func(To.Y * Size.X + To.X, Neighbour);
+            }
+        }
+    };
+    const auto Invalidate = [&Invalid, &Invalidated](const int32 Cell)
+    {
+        if (!Invalid[Cell])
+        {
+            Invalid[Cell] = true;
+            Invalidated.Add(Cell);
+        }
+    };
+
+    // A changed cell breaks the paths through it and the diagonals cutting past it, which all start next to it.
+    // Downstream, a cell is invalidated with any neighbour it may have taken its cost from, costs are exact sums of the steps
+    for (const int32 Cell : ChangedCells)
+    {
+        Invalidate(Cell);
+        ForEachNeighbour(Cell, [&Invalidate](const int32 NeighbourCell, int32) { Invalidate(NeighbourCell); });
+    }
+    for (int32 Index = 0; Index < Invalidated.Num(); ++Index)
+    {
+        const int32 Cell = Invalidated[Index];
+        const float Cost = Integration[Cell];
+        if (Cost == FLT_MAX)
+        {
+            continue;
+        }
+        ForEachNeighbour(Cell, [this, &Invalid, &Invalidate, Cost](const int32 NeighbourCell, const int32 Neighbour)
+        {
+            if (!Invalid[NeighbourCell] && Integration[NeighbourCell] < FLT_MAX && Cost + StepCosts[Neighbour] <= Integration[NeighbourCell] + UE_KINDA_SMALL_NUMBER)
+            {
+                Invalidate(NeighbourCell);
+            }
+        });
+    }
+
+    // Every other cell kept its path, the ones bordering the invalidated area are where costs spread back in from
+    for (const int32 Cell : Invalidated)
+    {
+        Integration[Cell] = FLT_MAX;
+    }
+    TArray<TPair<float, int32>> Open;
+    if (Invalid[GoalCell] && Walkable[GoalCell])
+    {
+        Integration[GoalCell] = 0.0f;
+        Open.Emplace(0.0f, GoalCell);
+    }
+    for (const int32 Cell : Invalidated)
+    {
+        ForEachNeighbour(Cell, [this, &Invalid, &Open](const int32 NeighbourCell, int32)
+        {
+            if (!Invalid[NeighbourCell] && Integration[NeighbourCell] < FLT_MAX)
+            {
+                Open.Emplace(Integration[NeighbourCell], NeighbourCell);
+            }
+        });
+    }
+    TArray<int32> Lowered;
+    Propagate(Size, Walkable, Integration, Open, &Lowered);
+
+    // A direction depends on the cell's neighbours, so it is refreshed around every cell whose cost moved
+    TBitArray<> DirectionDirty(false, NumCells);
+    for (const TArray<int32>* Cells : { &Invalidated, &Lowered })
+    {
+        for (const int32 Cell : *Cells)
+        {
+            DirectionDirty[Cell] = true;
+            ForEachNeighbour(Cell, [&DirectionDirty](const int32 NeighbourCell, int32) { DirectionDirty[NeighbourCell] = true; });
+        }
+    }
+    for (TConstSetBitIterator<> It(DirectionDirty); It; ++It)
+    {
+        FlowDirections[It.GetIndex()] = FindFlowDirection(Size, Walkable, Integration, GoalCell, It.GetIndex());
+    }
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+
+class ANavigationData;
+
+/**
+ * Integration field over a uniform XY grid sampled from the navmesh, shared by every agent heading to the same goal.
+ * Each walkable cell stores the direction to its cheapest neighbour, so steering is a single O(1) cell lookup.
+ * Built in the background: walkability is sampled a few rows per ContinueBuild on the game thread, then integrated on a task.
+ * Until then GetDirection fails and agents steer straight at the goal.
+ * Walkability is only resampled inside rebuilt navmesh tiles, and the integration is repaired from the cells that changed.
+ */
+struct ALPHADOGGAME_API FAvoidanceFlowField
+{
+	// Sets up the grid around Goal, clipped to the navmesh bounds, and starts building it. Fails if the goal is not on the navmesh.
+	bool Build(const ANavigationData& InNavData, const FVector& Goal, float InCellSize, float MaxHalfExtent);
+	// Game thread: samples rows until EndTime, at least one, then collects the integration once its task is done. True once built
+	bool ContinueBuild(double EndTime);
+	// Resamples the cells overlapping DirtyBounds and repairs the integration around the ones that changed
+	void RebuildArea(const ANavigationData& InNavData, TConstArrayView<FBox> DirtyBounds);
+	void Reset();
+
+	// Unit XY direction to follow from Location, false outside the field, where the goal is unreachable, or while building
+	bool GetDirection(const FVector& Location, FVector& OutDirection) const
+	{
+		const int32 Cell = IsBuilt() ? GetCellIndex(Location) : INDEX_NONE;
+		if (Cell == INDEX_NONE || FlowDirections[Cell] == NoDirection)
+		{
+			return false;
+		}
+		OutDirection = NeighbourDirections[FlowDirections[Cell]];
+		return true;
+	}
+
+	bool IsBuilt() const { return !FlowDirections.IsEmpty(); }
+	bool IsBuilding() const { return !IsBuilt() && GoalCell != INDEX_NONE; }
+	const FVector& GetGoalLocation() const { return GoalLocation; }
+	float GetCellSize() const { return CellSize; }
+	const ANavigationData* GetNavData() const { return NavData.Get(); }
+
+	int32 NumUsers = 0; // Agents following this field, owned by UAvoidancePlannerSubsystem
+
+private:
+	static constexpr uint8 NoDirection = 0xFF;
+	static const FVector NeighbourDirections[8];
+	static const FIntPoint NeighbourOffsets[8];
+	static const float StepCosts[8];
+
+	/** Costs and directions of a whole field, produced on the integration task from a copy of the walkability. */
+	struct FIntegration
+	{
+		TArray<float> Costs;
+		TArray<uint8> Directions;
+	};
+
+	int32 GetCellIndex(const FVector& Location) const
+	{
+		const int32 CellX = FMath::FloorToInt32((Location.X - Origin.X) * InvCellSize);
+		const int32 CellY = FMath::FloorToInt32((Location.Y - Origin.Y) * InvCellSize);
+		if (CellX < 0 || CellY < 0 || CellX >= Size.X || CellY >= Size.Y)
+		{
+			return INDEX_NONE;
+		}
+		return CellY * Size.X + CellX;
+	}
+
+	// Projects the centre of every cell in [MinCell, MaxCell] onto the navmesh, appending the cells whose walkability flipped
+	void SampleCells(const ANavigationData& InNavData, const FIntPoint& MinCell, const FIntPoint& MaxCell, TArray<int32>* OutChangedCells = nullptr);
+	void LaunchIntegration();
+	// Dijkstra from the goal cell over the 8-connected grid, then points every cell at its cheapest neighbour
+	static void Integrate(const FIntPoint& GridSize, int32 InGoalCell, const TArray<bool>& InWalkable, FIntegration& Out);
+	// Raises the cost of every cell whose cheapest path ran past ChangedCells, then lowers costs again from the cells around them
+	void Repair(TConstArrayView<int32> ChangedCells);
+
+	// Diagonal moves must not cut a blocked corner, either orthogonal cell being blocked rules them out
+	static bool CanStep(const FIntPoint& GridSize, const TArray<bool>& InWalkable, int32 CellX, int32 CellY, int32 Neighbour);
+	// Settles the open cells cheapest first, lowering Costs of the cells they reach. Appends every lowered cell to OutLowered if given
+	static void Propagate(const FIntPoint& GridSize, const TArray<bool>& InWalkable, TArray<float>& Costs, TArray<TPair<float, int32>>& Open, TArray<int32>* OutLowered);
+	static uint8 FindFlowDirection(const FIntPoint& GridSize, const TArray<bool>& InWalkable, const TArray<float>& Costs, int32 InGoalCell, int32 Cell);
+
+	TWeakObjectPtr<const ANavigationData> NavData;
+	FVector GoalLocation = FVector::ZeroVector;
+	FVector2D Origin = FVector2D::ZeroVector;
+	float CellSize = 100.0f;
+	float InvCellSize = 0.01f;
+	FIntPoint Size = FIntPoint::ZeroValue;
+	int32 GoalCell = INDEX_NONE;
+	TArray<bool> Walkable;
+	TArray<float> Integration; // Path cost to the goal, FLT_MAX where unreachable
+	TArray<uint8> FlowDirections; // Index into NeighbourDirections, NoDirection where unreachable. Empty while building
+
+	// Build state
+	int32 NextSampleRow = 0;
+	UE::Tasks::TTask<FIntegration> IntegrationTask; // Works on its own copy, the field may move or go away while it runs
+	bool bResampledDuringIntegration = false; // Walkability changed after IntegrationTask copied it
+};
@@ -0,0 +1,791 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceKernel.h"
+#include "AvoidanceObstacles.h"
+#include "AvoidanceOrca.h"
+#include "AvoidanceSpatialHash.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include <atomic>
+
+void FAvoidanceAgentArrays::SetNum(const int32 InNumAgents)
+{
+    NumAgents = InNumAgents;
+    const int32 PaddedNum = Align(InNumAgents, AvoidanceBatchSize);
+    for (FFloatArray* Array : { &PosX, &PosY, &PosZ, &VelX, &VelY, &VelZ, &Radii })
+    {
+        Array->SetNumZeroed(PaddedNum, EAllowShrinking::No);
+    }
+}
+
+int32 FAvoidanceAgentArrays::Add()
+{
+    const int32 Index = NumAgents;
+    SetNum(NumAgents + 1);
+    return Index;
+}
+
+void FAvoidanceAgentArrays::RemoveAtSwap(const int32 i)
+{
+    check(i >= 0 && i < NumAgents);
+    const int32 Last = NumAgents - 1;
+    for (FFloatArray* Array : { &PosX, &PosY, &PosZ, &VelX, &VelY, &VelZ, &Radii })
+    {
+        (*Array)[i] = (*Array)[Last];
+        (*Array)[Last] = 0.0f; // Keep padding lanes zeroed
+    }
+    SetNum(Last);
+}
+
+float AvoidanceKernel::ComputeTimeToCollision(const FAvoidanceAgentArrays& Agents, const int32 i, const int32 j)
+{
+    const float r = Agents.Radii[i] + Agents.Radii[j];
+    const FVector3f w(Agents.PosX[j] - Agents.PosX[i], Agents.PosY[j] - Agents.PosY[i], Agents.PosZ[j] - Agents.PosZ[i]);
+    const float c = FVector3f::DotProduct(w, w) - r * r;
+    if (c < 0.0f) // Agents are colliding
+    {
+        return 0.0f;
+    }
+    const FVector3f v(Agents.VelX[i] - Agents.VelX[j], Agents.VelY[i] - Agents.VelY[j], Agents.VelZ[i] - Agents.VelZ[j]);
+    const float a = FVector3f::DotProduct(v, v);
+    const float b = FVector3f::DotProduct(w, v);
+    const float Discr = b * b - a * c;
+
+    if (Discr <= 0.0f) { return FLT_MAX; }
+
+    const float Tau = (b - FMath::Sqrt(Discr)) / a;
+    return (Tau < 0.0f) ? FLT_MAX : Tau;
+}
+
+void FAvoidanceNeighbourCache::Prepare(const int32 NumAgents, const int32 MaxNeighbours)
+{
+    if (MaxNeighbours != Stride)
+    {
+        Invalidate();
+        Stride = MaxNeighbours;
+    }
+    // Slots past the end are gone, so are the lists pointing at them
+    for (int32 i = 0; NumAgents < Counts.Num() && i < NumAgents; ++i)
+    {
+        for (const int32 Neighbour : GetNeighbours(i))
+        {
+            if (Neighbour >= NumAgents)
+            {
+                Counts[i] = 0;
+                Ages[i] = MAX_int32;
+                break;
+            }
+        }
+    }
+    // New slots start without a list, existing ones keep theirs
+    Indices.SetNumUninitialized(NumAgents * Stride, EAllowShrinking::No);
+    Counts.SetNumZeroed(NumAgents, EAllowShrinking::No);
+    Drifts.SetNumZeroed(NumAgents, EAllowShrinking::No);
+    const int32 OldNumAges = Ages.Num();
+    Ages.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    for (int32 i = OldNumAges; i < NumAgents; ++i)
+    {
+        Ages[i] = MAX_int32;
+    }
+    LastPositions.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    HasLastPositions.SetNum(NumAgents, false);
+}
+
+void FAvoidanceNeighbourCache::Invalidate()
+{
+    Indices.Reset();
+    Counts.Reset();
+    Drifts.Reset();
+    Ages.Reset();
+    LastPositions.Reset();
+    HasLastPositions.Empty();
+}
+
+void FAvoidanceNeighbourCache::Remap(const TConstArrayView<int32> Sources)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceNeighbourCache_Remap);
+    const int32 OldNum = Counts.Num();
+    const int32 NewNum = Sources.Num();
+    // New slot of each old one, INDEX_NONE once its agent left
+    TArray<int32> Targets;
+    Targets.Init(INDEX_NONE, OldNum);
+    for (int32 i = 0; i < NewNum; ++i)
+    {
+        if (Sources[i] >= 0 && Sources[i] < OldNum)
+        {
+            Targets[Sources[i]] = i;
+        }
+    }
+
+    TArray<int32> NewIndices;
+    TArray<int32> NewCounts;
+    TArray<float> NewDrifts;
+    TArray<int32> NewAges;
+    TArray<FVector3f> NewLastPositions;
+    TBitArray<> NewHasLastPositions(false, NewNum);
+    NewIndices.SetNumUninitialized(NewNum * Stride);
+    NewCounts.SetNumZeroed(NewNum);
+    NewDrifts.SetNumZeroed(NewNum);
+    NewAges.Init(MAX_int32, NewNum);
+    NewLastPositions.SetNumUninitialized(NewNum);
+    for (int32 i = 0; i < NewNum; ++i)
+    {
+        const int32 Source = Sources[i];
+        if (Source < 0 || Source >= OldNum)
+        {
+            continue;
+        }
+        NewLastPositions[i] = LastPositions[Source];
+        NewHasLastPositions[i] = HasLastPositions[Source];
+        if (Ages[Source] == MAX_int32)
+        {
+            continue;
+        }
+        int32* Neighbours = NewIndices.GetData() + i * Stride;
+        bool bLostNeighbour = false;
+        for (int32 n = 0; n < Counts[Source] && !bLostNeighbour; ++n)
+        {
+            Neighbours[n] = Targets[Indices[Source * Stride + n]];
+            bLostNeighbour = Neighbours[n] == INDEX_NONE;
+        }
+        if (bLostNeighbour)
+        {
+            continue;
+        }
+        // Kept in ascending slots like a freshly built list
+        Algo::Sort(MakeArrayView(Neighbours, Counts[Source]));
+        NewCounts[i] = Counts[Source];
+        NewDrifts[i] = Drifts[Source];
+        NewAges[i] = Ages[Source];
+    }
+    Indices = MoveTemp(NewIndices);
+    Counts = MoveTemp(NewCounts);
+    Drifts = MoveTemp(NewDrifts);
+    Ages = MoveTemp(NewAges);
+    LastPositions = MoveTemp(NewLastPositions);
+    HasLastPositions = MoveTemp(NewHasLastPositions);
+}
+
+struct FAvoidanceNeighbourCacheAccess
+{
+    static float GetGatherRadius(const FAvoidanceSolverParams& Params, const FAvoidanceSolveOptions& Options)
+    {
+        return FMath::Sqrt(Params.SensingRadiusSq) + 2.0f * Options.NeighbourCacheMargin;
+    }
+
+    // Adds the longest step taken near each agent since the previous solve to its list's drift. While the drift stays within the margin
+    // no two agents in range of each other closed in by more than twice the margin, so every agent in range now, newcomers included,
+    // was within the gather radius when the list was built. Steps are bucketed by cell, so a fast agent only ages the lists around it.
+    // Done for every list each solve whatever its agent's mode, serial and O(agents).
+    static void UpdateDrifts(FAvoidanceNeighbourCache& Cache, const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params,
+        const FAvoidanceSolveOptions& Options)
+    {
+        TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceNeighbourCache_UpdateDrifts);
+        const int32 NumAgents = Agents.Num();
+        // A cell as large as the gather radius, so a list only looks at the 3x3 cells around its agent. Shared buckets only ever overestimate
+        const float InvCellSize = 1.0f / GetGatherRadius(Params, Options);
+        const uint32 CellMask = FMath::RoundUpToPowerOfTwo(FMath::Max(NumAgents * 2, 64)) - 1;
+        auto GetBucket = [](const int32 CellX, const int32 CellY, const uint32 Mask)
+        {
+            return ((static_cast<uint32>(CellX) * 73856093u) ^ (static_cast<uint32>(CellY) * 19349663u)) & Mask;
+        };
+        Cache.CellSteps.Reset();
+        Cache.CellSteps.SetNumZeroed(CellMask + 1);
+        for (int32 k = 0; k < NumAgents; ++k)
+        {
+            const FVector3f Position(Agents.PosX[k], Agents.PosY[k], Agents.PosZ[k]);
+            // An agent in a new slot came from anywhere, every list around it has to look again
+            const float Step = Cache.HasLastPositions[k] ? FVector3f::Dist(Position, Cache.LastPositions[k]) : UE_OLD_WORLD_MAX;
+            Cache.LastPositions[k] = Position;
+            float& CellStep = Cache.CellSteps[GetBucket(FMath::FloorToInt32(Position.X * InvCellSize), FMath::FloorToInt32(Position.Y * InvCellSize), CellMask)];
+            CellStep = FMath::Max(CellStep, Step);
+        }
+        Cache.HasLastPositions.SetRange(0, NumAgents, true);
+
+        for (int32 i = 0; i < NumAgents; ++i)
+        {
+            if (Cache.Ages[i] == MAX_int32)
+            {
+                continue;
+            }
+            const int32 CellX = FMath::FloorToInt32(Agents.PosX[i] * InvCellSize);
+            const int32 CellY = FMath::FloorToInt32(Agents.PosY[i] * InvCellSize);
+            float MaxStep = 0.0f;
+            for (int32 OffsetY = -1; OffsetY <= 1; ++OffsetY)
+            {
+                for (int32 OffsetX = -1; OffsetX <= 1; ++OffsetX)
+                {
+                    MaxStep = FMath::Max(MaxStep, Cache.CellSteps[GetBucket(CellX + OffsetX, CellY + OffsetY, CellMask)]);
+                }
+            }
+            Cache.Drifts[i] += MaxStep;
+        }
+    }
+
+    // Rebuilds agent i's list if it is missing, too old, or it drifted past the margin. Only touches slot i, safe in parallel.
+    static bool Refresh(FAvoidanceNeighbourCache& Cache, const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params,
+        const FAvoidanceSolveOptions& Options, const FAvoidanceSpatialHash& SpatialHash, const int32 i, int64& InOutPairTests)
+    {
+        const FVector3f Position(Agents.PosX[i], Agents.PosY[i], Agents.PosZ[i]);
+        if (Cache.Ages[i] < Options.MaxNeighbourListAge && Cache.Drifts[i] <= Options.NeighbourCacheMargin)
+        {
+            ++Cache.Ages[i];
+            return false;
+        }
+
+        struct FCandidate
+        {
+            float TimeToCollision;
+            float DistSq;
+            int32 Index;
+        };
+        // Worst candidate on top of the heap. Soonest collision first, then nearest, then by position so ties don't depend on slots.
+        const auto WorseFirst = [&Agents](const FCandidate& A, const FCandidate& B)
+        {
+            if (A.TimeToCollision != B.TimeToCollision)
+            {
+                return A.TimeToCollision > B.TimeToCollision;
+            }
+            if (A.DistSq != B.DistSq)
+            {
+                return A.DistSq > B.DistSq;
+            }
+            return AvoidanceKernel::IsBefore(Agents, B.Index, A.Index);
+        };
+
+        const float GatherRadius = GetGatherRadius(Params, Options);
+        const float GatherRadiusSq = FMath::Square(GatherRadius);
+        TArray<FCandidate, TInlineAllocator<32>> Best;
+        auto Consider = [&](const int32 k)
+        {
+            ++InOutPairTests;
+            const float DistSq = FVector3f::DistSquared(Position, FVector3f(Agents.PosX[k], Agents.PosY[k], Agents.PosZ[k]));
+            if (k == i || DistSq > GatherRadiusSq)
+            {
+                return;
+            }
+            Best.HeapPush({ AvoidanceKernel::ComputeTimeToCollision(Agents, i, k), DistSq, k }, WorseFirst);
+            if (Best.Num() > Cache.Stride)
+            {
+                FCandidate Dropped;
+                Best.HeapPop(Dropped, WorseFirst, EAllowShrinking::No);
+            }
+        };
+        if (Options.bUseSpatialHash)
+        {
+            SpatialHash.ForEachCandidate(Agents.PosX[i], Agents.PosY[i], GatherRadius, Consider);
+        }
+        else
+        {
+            for (int32 k = 0; k < Agents.Num(); ++k)
+            {
+                Consider(k);
+            }
+        }
+
+        // Ascending slots walk the SoA arrays front to back when the list is evaluated
+        Best.Sort([](const FCandidate& A, const FCandidate& B) { return A.Index < B.Index; });
+        int32* Neighbours = Cache.Indices.GetData() + i * Cache.Stride;
+        for (int32 n = 0; n < Best.Num(); ++n)
+        {
+            Neighbours[n] = Best[n].Index;
+        }
+        Cache.Counts[i] = Best.Num();
+        Cache.Drifts[i] = 0.0f;
+        Cache.Ages[i] = 0;
+        return true;
+    }
+};
+
+void AvoidanceKernel::AccumulatePair(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, const int32 i, const int32 k,
+    FVector3f& InOutAvoid, FVector3f& InOutSeparation)
+{
+    const FVector3f Pos_I(Agents.PosX[i], Agents.PosY[i], Agents.PosZ[i]);
+    const FVector3f Vel_I(Agents.VelX[i], Agents.VelY[i], Agents.VelZ[i]);
+    const FVector3f Pos_K(Agents.PosX[k], Agents.PosY[k], Agents.PosZ[k]);
+    const FVector3f Vel_K(Agents.VelX[k], Agents.VelY[k], Agents.VelZ[k]);
+    const float DistSq = FVector3f::DistSquared(Pos_I, Pos_K);
+    if (DistSq <= Params.SensingRadiusSq)
+    {
+        const float t = ComputeTimeToCollision(Agents, i, k);
+        // Outside the horizon the magnitude is zero, skip it so FLT_MAX never reaches the prediction
+        if (t <= Params.TimeHorizon)
+        {
+            FVector3f FAvoid = (Pos_I + Vel_I * t) - (Pos_K + Vel_K * t);
+            const float SizeSq = FAvoid.SizeSquared();
+            if (SizeSq > 0.0f)
+            {
+                const float Mag = FMath::Min((Params.TimeHorizon - t) / (t + 0.001f), Params.MaxForce);
+                InOutAvoid += FAvoid * (Mag / FMath::Sqrt(SizeSq));
+            }
+        }
+    }
+    if (DistSq < Params.SeparationDistanceSq) // Separation force
+    {
+        InOutSeparation += (Pos_I - Pos_K).GetSafeNormal() * Params.SeparationForceMag;
+    }
+}
+
+bool AvoidanceKernel::IsBefore(const FAvoidanceAgentArrays& Agents, const int32 A, const int32 B)
+{
+    if (Agents.PosX[A] != Agents.PosX[B])
+    {
+        return Agents.PosX[A] < Agents.PosX[B];
+    }
+    if (Agents.PosY[A] != Agents.PosY[B])
+    {
+        return Agents.PosY[A] < Agents.PosY[B];
+    }
+    if (Agents.PosZ[A] != Agents.PosZ[B])
+    {
+        return Agents.PosZ[A] < Agents.PosZ[B];
+    }
+    return A < B; // Coincident agents, only these fall back to slots
+}
+
+/** Order-independent force sum. Contributions are rounded to a fixed-point grid and summed as integers, which is associative. */
+struct FFixedPointForceSum
+{
+    static constexpr float Scale = 4096.0f;
+
+    void Add(const FVector3f& Force)
+    {
+        X += FMath::RoundToInt64(Force.X * Scale);
+        Y += FMath::RoundToInt64(Force.Y * Scale);
+        Z += FMath::RoundToInt64(Force.Z * Scale);
+    }
+
+    FVector Get() const { return FVector(X, Y, Z) / Scale; }
+
+private:
+    int64 X = 0;
+    int64 Y = 0;
+    int64 Z = 0;
+};
+
+// Segments with a cell near (X, Y) in a tile at Z's height, each once and in index order so the result does not depend on bucket layout.
+// Index order follows tile build history, deterministic solves order by coordinates instead.
+static void GatherObstacleCandidates(const FAvoidanceObstacleIndex& Obstacles, const float X, const float Y, const float Z, const float Radius, const float HalfHeight,
+    const bool bOrderByPosition, TArray<int32, TInlineAllocator<32>>& OutSegments)
+{
+    Obstacles.ForEachCandidate(X, Y, Z, Radius, HalfHeight, [&OutSegments](const int32 SegmentIndex)
+    {
+        OutSegments.Add(SegmentIndex);
+    });
+    OutSegments.Sort();
+    int32 NumUnique = 0;
+    for (int32 Index = 0; Index < OutSegments.Num(); ++Index)
+    {
+        if (NumUnique == 0 || OutSegments[NumUnique - 1] != OutSegments[Index])
+        {
+            OutSegments[NumUnique++] = OutSegments[Index];
+        }
+    }
+    OutSegments.SetNum(NumUnique, EAllowShrinking::No);
+    if (bOrderByPosition)
+    {
+        OutSegments.Sort([&Obstacles](const int32 A, const int32 B)
+        {
+            const FAvoidanceSegment& SegmentA = Obstacles.GetSegment(A);
+            const FAvoidanceSegment& SegmentB = Obstacles.GetSegment(B);
+            const float KeysA[] = { SegmentA.Start.X, SegmentA.Start.Y, SegmentA.End.X, SegmentA.End.Y };
+            const float KeysB[] = { SegmentB.Start.X, SegmentB.Start.Y, SegmentB.End.X, SegmentB.End.Y };
+            for (int32 Key = 0; Key < UE_ARRAY_COUNT(KeysA); ++Key)
+            {
+                if (KeysA[Key] != KeysB[Key])
+                {
+                    return KeysA[Key] < KeysB[Key];
+                }
+            }
+            return A < B;
+        });
+    }
+}
+
+void AvoidanceKernel::AccumulateObstacles(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, const FAvoidanceObstacleIndex& Obstacles,
+    const int32 i, FVector3f& InOutForce, const bool bOrderByPosition)
+{
+    const FVector2f Position(Agents.PosX[i], Agents.PosY[i]);
+    const FVector2f Velocity(Agents.VelX[i], Agents.VelY[i]);
+    TArray<int32, TInlineAllocator<32>> Segments;
+    GatherObstacleCandidates(Obstacles, Position.X, Position.Y, Agents.PosZ[i], FMath::Sqrt(Params.SensingRadiusSq), Params.ObstacleHalfHeight, bOrderByPosition, Segments);
+    for (const int32 SegmentIndex : Segments)
+    {
+        const FAvoidanceSegment& Segment = Obstacles.GetSegment(SegmentIndex);
+        if (FVector2f::DistSquared(Position, AvoidanceObstacles::GetClosestPoint(Segment, Position)) > Params.SensingRadiusSq
+            || !AvoidanceObstacles::IsAtHeight(Segment, Position, Agents.PosZ[i], Params.ObstacleHalfHeight))
+        {
+            continue;
+        }
+        const float t = AvoidanceObstacles::ComputeTimeToCollision(Segment, Position, Velocity, Agents.Radii[i]);
+        if (t > Params.TimeHorizon)
+        {
+            continue;
+        }
+        // Same magnitude as an agent pair, pushing away from where the wall would be touched
+        const FVector2f Predicted = Position + Velocity * t;
+        const FVector2f FAvoid = Predicted - AvoidanceObstacles::GetClosestPoint(Segment, Predicted);
+        const float SizeSq = FAvoid.SizeSquared();
+        if (SizeSq > 0.0f)
+        {
+            const float Mag = FMath::Min((Params.TimeHorizon - t) / (t + 0.001f), Params.MaxForce);
+            InOutForce += FVector3f(FAvoid * (Mag / FMath::Sqrt(SizeSq)), 0.0f);
+        }
+    }
+}
+
+void AvoidanceKernel::AccumulateBatchScalar(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, const int32 i, const int32 j, FVector3f& InOutForce)
+{
+    const int32 BatchEnd = FMath::Min(j + AvoidanceBatchSize, Agents.Num());
+    FVector3f AvoidSum = FVector3f::ZeroVector;
+    for (int32 k = j; k < BatchEnd; ++k)
+    {
+        if (k != i) // Skip self-interaction
+        {
+            AccumulatePair(Agents, Params, i, k, AvoidSum, InOutForce);
+        }
+    }
+    InOutForce += AvoidSum;
+}
+
+FVector3f AvoidanceKernel::FLaneForces::Reduce() const
+{
+    alignas(16) float LanesX[4], LanesY[4], LanesZ[4];
+    VectorStoreAligned(X, LanesX);
+    VectorStoreAligned(Y, LanesY);
+    VectorStoreAligned(Z, LanesZ);
+    // Fixed lane order so the result does not depend on how the compiler reassociates
+    return FVector3f(
+        ((LanesX[0] + LanesX[1]) + LanesX[2]) + LanesX[3],
+        ((LanesY[0] + LanesY[1]) + LanesY[2]) + LanesY[3],
+        ((LanesZ[0] + LanesZ[1]) + LanesZ[2]) + LanesZ[3]);
+}
+
+void AvoidanceKernel::AccumulateBatchSimd(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, const int32 i, const int32 j, FLaneForces& InOutForces)
+{
+    checkSlow(j % AvoidanceBatchSize == 0);
+    const VectorRegister4Float Zero = GlobalVectorConstants::FloatZero;
+    const VectorRegister4Float One = GlobalVectorConstants::FloatOne;
+
+    // Self-pair and padding lanes are masked out by index
+    const VectorRegister4Float LaneIndex = MakeVectorRegisterFloat(float(j), float(j + 1), float(j + 2), float(j + 3));
+    const VectorRegister4Float ValidMask = VectorBitwiseAnd(
+        VectorCompareNE(LaneIndex, VectorSetFloat1(float(i))),
+        VectorCompareLT(LaneIndex, VectorSetFloat1(float(Agents.Num()))));
+
+    // w = Pos_K - Pos_I, v = Vel_I - Vel_K
+    const VectorRegister4Float Wx = VectorSubtract(VectorLoadAligned(&Agents.PosX[j]), VectorSetFloat1(Agents.PosX[i]));
+    const VectorRegister4Float Wy = VectorSubtract(VectorLoadAligned(&Agents.PosY[j]), VectorSetFloat1(Agents.PosY[i]));
+    const VectorRegister4Float Wz = VectorSubtract(VectorLoadAligned(&Agents.PosZ[j]), VectorSetFloat1(Agents.PosZ[i]));
+    const VectorRegister4Float Vx = VectorSubtract(VectorSetFloat1(Agents.VelX[i]), VectorLoadAligned(&Agents.VelX[j]));
+    const VectorRegister4Float Vy = VectorSubtract(VectorSetFloat1(Agents.VelY[i]), VectorLoadAligned(&Agents.VelY[j]));
+    const VectorRegister4Float Vz = VectorSubtract(VectorSetFloat1(Agents.VelZ[i]), VectorLoadAligned(&Agents.VelZ[j]));
+
+    const VectorRegister4Float DistSq = VectorMultiplyAdd(Wx, Wx, VectorMultiplyAdd(Wy, Wy, VectorMultiply(Wz, Wz)));
+    const VectorRegister4Float SenseMask = VectorBitwiseAnd(ValidMask, VectorCompareLE(DistSq, VectorSetFloat1(Params.SensingRadiusSq)));
+
+    // Time to collision, see ComputeTimeToCollision
+    const VectorRegister4Float R = VectorAdd(VectorSetFloat1(Agents.Radii[i]), VectorLoadAligned(&Agents.Radii[j]));
+    const VectorRegister4Float C = VectorSubtract(DistSq, VectorMultiply(R, R));
+    const VectorRegister4Float A = VectorMultiplyAdd(Vx, Vx, VectorMultiplyAdd(Vy, Vy, VectorMultiply(Vz, Vz)));
+    const VectorRegister4Float B = VectorMultiplyAdd(Wx, Vx, VectorMultiplyAdd(Wy, Vy, VectorMultiply(Wz, Vz)));
+    const VectorRegister4Float Discr = VectorSubtract(VectorMultiply(B, B), VectorMultiply(A, C));
+    const VectorRegister4Float SafeA = VectorSelect(VectorCompareGT(A, Zero), A, One);
+    const VectorRegister4Float Tau = VectorDivide(VectorSubtract(B, VectorSqrt(VectorMax(Discr, Zero))), SafeA);
+    const VectorRegister4Float HasRootMask = VectorBitwiseAnd(VectorCompareGT(Discr, Zero), VectorCompareGE(Tau, Zero));
+    const VectorRegister4Float T = VectorSelect(VectorCompareLT(C, Zero), Zero, VectorSelect(HasRootMask, Tau, VectorSetFloat1(FLT_MAX)));
+
+    // Lanes past the horizon get no magnitude, predict with t = 0 there so nothing overflows
+    const VectorRegister4Float HorizonMask = VectorCompareLE(T, VectorSetFloat1(Params.TimeHorizon));
+    const VectorRegister4Float SafeT = VectorSelect(HorizonMask, T, Zero);
+
+    // Predicted Pos_I - Pos_K at time t
+    const VectorRegister4Float Ax = VectorMultiplyAdd(Vx, SafeT, VectorNegate(Wx));
+    const VectorRegister4Float Ay = VectorMultiplyAdd(Vy, SafeT, VectorNegate(Wy));
+    const VectorRegister4Float Az = VectorMultiplyAdd(Vz, SafeT, VectorNegate(Wz));
+    const VectorRegister4Float AvoidSq = VectorMultiplyAdd(Ax, Ax, VectorMultiplyAdd(Ay, Ay, VectorMultiply(Az, Az)));
+    const VectorRegister4Float AvoidDirMask = VectorCompareGT(AvoidSq, Zero);
+    const VectorRegister4Float AvoidLen = VectorSqrt(VectorSelect(AvoidDirMask, AvoidSq, One));
+
+    const VectorRegister4Float Mag = VectorMin(
+        VectorDivide(VectorSubtract(VectorSetFloat1(Params.TimeHorizon), SafeT), VectorAdd(SafeT, VectorSetFloat1(0.001f))),
+        VectorSetFloat1(Params.MaxForce));
+    const VectorRegister4Float AvoidMask = VectorBitwiseAnd(SenseMask, VectorBitwiseAnd(HorizonMask, AvoidDirMask));
+    const VectorRegister4Float AvoidScale = VectorSelect(AvoidMask, VectorDivide(Mag, AvoidLen), Zero);
+
+    // Separation pushes along -w, coincident agents have no direction and get none
+    const VectorRegister4Float SeparationMask = VectorBitwiseAnd(ValidMask,
+        VectorBitwiseAnd(VectorCompareLT(DistSq, VectorSetFloat1(Params.SeparationDistanceSq)), VectorCompareGT(DistSq, Zero)));
+    const VectorRegister4Float SeparationScale = VectorSelect(SeparationMask,
+        VectorDivide(VectorSetFloat1(Params.SeparationForceMag), VectorSqrt(VectorSelect(SeparationMask, DistSq, One))), Zero);
+
+    InOutForces.X = VectorMultiplyAdd(Ax, AvoidScale, VectorSubtract(InOutForces.X, VectorMultiply(Wx, SeparationScale)));
+    InOutForces.Y = VectorMultiplyAdd(Ay, AvoidScale, VectorSubtract(InOutForces.Y, VectorMultiply(Wy, SeparationScale)));
+    InOutForces.Z = VectorMultiplyAdd(Az, AvoidScale, VectorSubtract(InOutForces.Z, VectorMultiply(Wz, SeparationScale)));
+}
+
+void AvoidanceKernel::SolveForces(const FAvoidanceAgentArrays& Agents, TConstArrayView<FVector> GoalVelocities, const FAvoidanceSolverParams& Params,
+    const FAvoidanceSolveOptions& Options, FAvoidanceSpatialHash& SpatialHash, TArrayView<FVector> OutForces, FAvoidanceSolveStats* OutStats,
+    TConstArrayView<EAvoidanceSolveMode> SolveModes, FAvoidanceNeighbourCache* NeighbourCache, const FAvoidanceObstacleIndex* Obstacles)
+{
+    const int32 NumAgents = Agents.Num();
+    check(GoalVelocities.Num() >= NumAgents && OutForces.Num() >= NumAgents);
+    check(SolveModes.IsEmpty() || SolveModes.Num() >= NumAgents);
+    const float SensingRadius = FMath::Sqrt(Params.SensingRadiusSq);
+    // No distance passes a negative squared sensing radius, which leaves only the separation term
+    FAvoidanceSolverParams SeparationParams = Params;
+    SeparationParams.SensingRadiusSq = -1.0f;
+    const float SeparationRadius = FMath::Sqrt(Params.SeparationDistanceSq);
+    if (Options.bUseSpatialHash)
+    {
+        SpatialHash.Build(Agents.PosX, Agents.PosY, NumAgents, SensingRadius);
+    }
+    FAvoidanceNeighbourCache LocalNeighbourCache;
+    const bool bCapNeighbours = Options.MaxNeighbours > 0;
+    if (bCapNeighbours)
+    {
+        NeighbourCache = NeighbourCache ? NeighbourCache : &LocalNeighbourCache;
+        NeighbourCache->Prepare(NumAgents, Options.MaxNeighbours);
+        FAvoidanceNeighbourCacheAccess::UpdateDrifts(*NeighbourCache, Agents, Params, Options);
+    }
+
+    TRACE_CPUPROFILER_EVENT_SCOPE(ComputeForces_Parallel);
+    std::atomic<int64> NumPairTests = 0;
+    std::atomic<int32> NumNeighbourListsBuilt = 0;
+    ParallelFor(NumAgents, [&](const int32 i)
+    {
+        const EAvoidanceSolveMode Mode = SolveModes.IsEmpty() ? EAvoidanceSolveMode::Full : SolveModes[i];
+        if (Mode == EAvoidanceSolveMode::Skip)
+        {
+            return;
+        }
+        if (Mode == EAvoidanceSolveMode::GoalOnly)
+        {
+            OutForces[i] = 2.0f * (GoalVelocities[i] - Agents.GetVelocity(i));
+            return;
+        }
+        const FAvoidanceSolverParams& AgentParams = Mode == EAvoidanceSolveMode::SeparationOnly ? SeparationParams : Params;
+        const float QueryRadius = Mode == EAvoidanceSolveMode::SeparationOnly ? SeparationRadius : SensingRadius;
+
+        // Capped lists make the full solve O(MaxNeighbours) per agent whatever the local density
+        int64 NumListTests = 0;
+        auto GetCappedNeighbours = [&]()
+        {
+            if (FAvoidanceNeighbourCacheAccess::Refresh(*NeighbourCache, Agents, Params, Options, SpatialHash, i, NumListTests))
+            {
+                NumNeighbourListsBuilt.fetch_add(1, std::memory_order_relaxed);
+            }
+            return NeighbourCache->GetNeighbours(i);
+        };
+
+        if (Mode == EAvoidanceSolveMode::Full && Params.Model == EAvoidanceSolverModel::Orca)
+        {
+            TArray<int32, TInlineAllocator<64>> Neighbours;
+            if (bCapNeighbours)
+            {
+                const TConstArrayView<int32> CappedNeighbours = GetCappedNeighbours();
+                Neighbours.Append(CappedNeighbours.GetData(), CappedNeighbours.Num());
+            }
+            else
+            {
+                auto Consider = [&](const int32 k)
+                {
+                    ++NumListTests;
+                    if (k != i && FVector3f::DistSquared(FVector3f(Agents.PosX[i], Agents.PosY[i], Agents.PosZ[i]),
+                        FVector3f(Agents.PosX[k], Agents.PosY[k], Agents.PosZ[k])) <= Params.SensingRadiusSq)
+                    {
+                        Neighbours.Add(k);
+                    }
+                };
+                if (Options.bUseSpatialHash)
+                {
+                    SpatialHash.ForEachCandidate(Agents.PosX[i], Agents.PosY[i], SensingRadius, Consider);
+                    // Same line order as the brute-force loop, so the program settles on the same velocity
+                    Neighbours.Sort();
+                }
+                else
+                {
+                    for (int32 k = 0; k < NumAgents; ++k)
+                    {
+                        Consider(k);
+                    }
+                }
+            }
+            if (Options.bDeterministic)
+            {
+                // Line order decides the program's result when it is infeasible, keep it independent of slot assignment
+                Neighbours.Sort([&Agents](const int32 A, const int32 B) { return IsBefore(Agents, A, B); });
+            }
+
+            // Obstacle lines go first, they are the hard constraints of the program
+            TArray<AvoidanceOrca::FOrcaLine, TInlineAllocator<32>> Lines;
+            if (Obstacles)
+            {
+                const FVector2f Position(Agents.PosX[i], Agents.PosY[i]);
+                TArray<int32, TInlineAllocator<32>> Segments;
+                GatherObstacleCandidates(*Obstacles, Position.X, Position.Y, Agents.PosZ[i], SensingRadius, Params.ObstacleHalfHeight, Options.bDeterministic, Segments);
+                for (const int32 SegmentIndex : Segments)
+                {
+                    const FAvoidanceSegment& Segment = Obstacles->GetSegment(SegmentIndex);
+                    const FVector2f ClosestPoint = AvoidanceObstacles::GetClosestPoint(Segment, Position);
+                    if (FVector2f::DistSquared(Position, ClosestPoint) <= Params.SensingRadiusSq && AvoidanceObstacles::IsAtHeight(Segment, Position, Agents.PosZ[i], Params.ObstacleHalfHeight))
+                    {
+                        AvoidanceOrca::AddObstacleLine(Agents, i, ClosestPoint, 1.0f / Params.OrcaTimeHorizon, 1.0f / Params.TimeStep, Lines);
+                    }
+                }
+            }
+            const int32 NumObstacleLines = Lines.Num();
+            for (const int32 k : Neighbours)
+            {
+                AvoidanceOrca::AddAgentLine(Agents, i, k, 1.0f / Params.OrcaTimeHorizon, 1.0f / Params.TimeStep, Lines);
+            }
+            const FVector& GoalVelocity = GoalVelocities[i];
+            const FVector2f NewVelocity = AvoidanceOrca::SolveVelocity(Lines, NumObstacleLines, Params.MaxSpeed, FVector2f(GoalVelocity.X, GoalVelocity.Y));
+            // Planar model, the vertical component keeps seeking the goal like the power law does
+            OutForces[i] = FVector(
+                (NewVelocity.X - Agents.VelX[i]) / Params.TimeStep,
+                (NewVelocity.Y - Agents.VelY[i]) / Params.TimeStep,
+                2.0f * (GoalVelocity.Z - Agents.VelZ[i]));
+            if (OutStats)
+            {
+                NumPairTests.fetch_add(NumListTests + Neighbours.Num(), std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        if (Options.bDeterministic)
+        {
+            // Integer sums make the result independent of neighbour order, so of slot assignment and broadphase
+            FFixedPointForceSum ForceSum;
+            int32 NumVisited = 0;
+            auto AddNeighbour = [&](const int32 k)
+            {
+                ++NumVisited;
+                if (k != i)
+                {
+                    FVector3f Avoid = FVector3f::ZeroVector;
+                    FVector3f Separation = FVector3f::ZeroVector;
+                    AccumulatePair(Agents, AgentParams, i, k, Avoid, Separation);
+                    ForceSum.Add(Avoid);
+                    ForceSum.Add(Separation);
+                }
+            };
+            if (bCapNeighbours && Mode == EAvoidanceSolveMode::Full)
+            {
+                for (const int32 k : GetCappedNeighbours())
+                {
+                    AddNeighbour(k);
+                }
+            }
+            else if (Options.bUseSpatialHash)
+            {
+                SpatialHash.ForEachCandidate(Agents.PosX[i], Agents.PosY[i], QueryRadius, AddNeighbour);
+            }
+            else
+            {
+                for (int32 k = 0; k < NumAgents; ++k)
+                {
+                    AddNeighbour(k);
+                }
+            }
+            if (Obstacles && Mode == EAvoidanceSolveMode::Full)
+            {
+                FVector3f ObstacleForce = FVector3f::ZeroVector;
+                AccumulateObstacles(Agents, Params, *Obstacles, i, ObstacleForce, true);
+                ForceSum.Add(ObstacleForce);
+            }
+            OutForces[i] = 2.0f * (GoalVelocities[i] - Agents.GetVelocity(i)) + ForceSum.Get();
+            if (OutStats)
+            {
+                NumPairTests.fetch_add(NumListTests + NumVisited, std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        if (bCapNeighbours && Mode == EAvoidanceSolveMode::Full)
+        {
+            const TConstArrayView<int32> Neighbours = GetCappedNeighbours();
+            FVector3f AvoidSum = FVector3f::ZeroVector;
+            FVector3f LocalForce = FVector3f::ZeroVector;
+            for (const int32 k : Neighbours)
+            {
+                AccumulatePair(Agents, Params, i, k, AvoidSum, LocalForce);
+            }
+            if (Obstacles)
+            {
+                AccumulateObstacles(Agents, Params, *Obstacles, i, AvoidSum);
+            }
+            OutForces[i] = 2.0f * (GoalVelocities[i] - Agents.GetVelocity(i)) + FVector(LocalForce + AvoidSum);
+            if (OutStats)
+            {
+                NumPairTests.fetch_add(NumListTests + Neighbours.Num(), std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        FLaneForces LaneForces;
+        FVector3f LocalForce = FVector3f::ZeroVector;
+        int32 NumBatches = 0;
+        // Both kernels see the same batches in the same order whichever broadphase produced them
+        auto ProcessBatch = [&](const int32 j)
+        {
+            ++NumBatches;
+            if (Options.bUseSimdKernel)
+            {
+                AccumulateBatchSimd(Agents, AgentParams, i, j, LaneForces);
+            }
+            else
+            {
+                AccumulateBatchScalar(Agents, AgentParams, i, j, LocalForce);
+            }
+        };
+
+        if (Options.bUseSpatialHash)
+        {
+            // Only visit the batches holding a neighbour candidate, in the same ascending order as the brute-force loop.
+            // Skipped batches have every agent outside SensingRadius and would only have added zeros.
+            TArray<int32, TInlineAllocator<64>> CandidateBatches;
+            SpatialHash.ForEachCandidate(Agents.PosX[i], Agents.PosY[i], QueryRadius, [&](const int32 k)
+            {
+                CandidateBatches.Add(k / AvoidanceBatchSize * AvoidanceBatchSize);
+            });
+            CandidateBatches.Sort();
+            int32 PrevBatch = INDEX_NONE;
+            for (const int32 j : CandidateBatches)
+            {
+                if (j != PrevBatch)
+                {
+                    ProcessBatch(j);
+                    PrevBatch = j;
+                }
+            }
+        }
+        else
+        {
+            for (int32 j = 0; j < NumAgents; j += AvoidanceBatchSize)
+            {
+                ProcessBatch(j);
+            }
+        }
+        if (Options.bUseSimdKernel)
+        {
+            LocalForce = LaneForces.Reduce();
+        }
+        if (Obstacles && Mode == EAvoidanceSolveMode::Full)
+        {
+            AccumulateObstacles(Agents, Params, *Obstacles, i, LocalForce);
+        }
+        // Goal seeking term plus the accumulated avoidance force
+        OutForces[i] = 2.0f * (GoalVelocities[i] - Agents.GetVelocity(i)) + FVector(LocalForce);
+        if (OutStats)
+        {
+            NumPairTests.fetch_add(static_cast<int64>(NumBatches) * AvoidanceBatchSize, std::memory_order_relaxed);
+        }
+    }, Options.bSingleThreaded ? EParallelForFlags::ForceSingleThread : EParallelForFlags::BackgroundPriority);
+
+    if (OutStats)
+    {
+        OutStats->NumPairTests = NumPairTests.load();
+        OutStats->NumNeighbourListsBuilt = NumNeighbourListsBuilt.load();
+    }
+}
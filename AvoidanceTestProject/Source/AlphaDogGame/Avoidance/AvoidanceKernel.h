@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/VectorRegister.h"
+
+/** Width of one kernel batch. Matches VectorRegister4Float, SoA arrays are padded to a multiple of it. */
+static constexpr int32 AvoidanceBatchSize = 4;
+
+/** Structure-of-arrays agent state consumed by the force kernels. Padding lanes are zeroed and masked by index. */
+struct ALPHADOGGAME_API FAvoidanceAgentArrays
+{
+	using FFloatArray = TArray<float, TAlignedHeapAllocator<16>>;
+
+	FFloatArray PosX, PosY, PosZ;
+	FFloatArray VelX, VelY, VelZ;
+	FFloatArray Radii;
+
+	void SetNum(int32 InNumAgents);
+	// Appends a zeroed agent and returns its index
+	int32 Add();
+	// Moves the last agent into slot i and shrinks by one, O(1)
+	void RemoveAtSwap(int32 i);
+	int32 Num() const { return NumAgents; }
+
+	FVector GetPosition(const int32 i) const { return FVector(PosX[i], PosY[i], PosZ[i]); }
+	FVector GetVelocity(const int32 i) const { return FVector(VelX[i], VelY[i], VelZ[i]); }
+	void SetPosition(const int32 i, const FVector& Position) { PosX[i] = Position.X; PosY[i] = Position.Y; PosZ[i] = Position.Z; }
+	void SetVelocity(const int32 i, const FVector& Velocity) { VelX[i] = Velocity.X; VelY[i] = Velocity.Y; VelZ[i] = Velocity.Z; }
+
+private:
+	int32 NumAgents = 0;
+};
+
+/** Avoidance model of fully solved agents. Both gather neighbours the same way and fall back to the same separation for LOD modes. */
+enum class EAvoidanceSolverModel : uint8
+{
+	PowerLaw,	// Anticipatory force falling off with time to collision
+	Orca,		// Optimal reciprocal collision avoidance, velocity picked by a half-plane linear program
+};
+
+/** Tunables of the avoidance models, squared where the kernel compares squared distances. */
+struct FAvoidanceSolverParams
+{
+	EAvoidanceSolverModel Model = EAvoidanceSolverModel::PowerLaw;
+	float SensingRadiusSq = 100.0f * 100.0f;
+	float TimeHorizon = 20.0f;
+	float MaxForce = 20.0f;
+	float SeparationDistanceSq = 50.0f * 50.0f;
+	float SeparationForceMag = 200.0f;
+	// ORCA only: collisions further ahead than this many seconds are ignored, and agents pick velocities up to MaxSpeed
+	float OrcaTimeHorizon = 2.0f;
+	float MaxSpeed = 600.0f;
+	// Obstacle segments further than this above or below an agent's position are ignored, e.g. walls of the floors above and below
+	float ObstacleHalfHeight = 150.0f;
+	// Time the solved forces will be applied over. ORCA turns its new velocity into the force reaching it in one step.
+	float TimeStep = 1.0f / 60.0f;
+};
+
+/**
+ * Broadphase and pair kernel used by AvoidanceKernel::SolveForces. The broadphase never changes the forces. The SIMD and scalar kernels
+ * sum in a different order, fuse multiply-adds and normalise separation differently, so they agree to within 1e-3 of the force, not bit for bit.
+ */
+struct FAvoidanceSolveOptions
+{
+	bool bUseSpatialHash = true;
+	bool bUseSimdKernel = true;
+	// Caps the neighbours of a fully solved agent to the ones closest in time to collision, 0 keeps every neighbour.
+	// Capped forces differ from uncapped ones, the broadphase and kernel choices above still don't change them.
+	int32 MaxNeighbours = 0;
+	// Capped neighbour lists are gathered twice this much beyond SensingRadius and reused until their agent or an agent near it moved further
+	float NeighbourCacheMargin = 25.0f;
+	// Solves a capped neighbour list is reused for at most, so its soonest-collision-first choice follows changes in velocity
+	int32 MaxNeighbourListAge = 8;
+	// Results depend on agent state only, not on slot order, broadphase or threading. Sums are taken in fixed point,
+	// neighbours are ordered by position where order matters, and the SIMD kernel is not used.
+	bool bDeterministic = false;
+	// Solves every agent on the calling thread, so whatever the solve does, allocations included, happens on that thread
+	bool bSingleThreaded = false;
+};
+
+/**
+ * Capped neighbour lists kept across solves, MaxNeighbours slots per agent in one flat index buffer.
+ * Indices are agent slots, so the owner must Remap() the cache whenever slots are reordered.
+ */
+struct ALPHADOGGAME_API FAvoidanceNeighbourCache
+{
+	// Sizes the buffers for NumAgents lists of MaxNeighbours, dropping every list if the capacity changed
+	void Prepare(int32 NumAgents, int32 MaxNeighbours);
+	void Invalidate();
+	// Moves every list to its agent's new slot, Sources[i] being the slot agent i had before or INDEX_NONE for a new agent.
+	// Lists of agents that left or that contain an agent that left are dropped, the rest are rewritten to the new slots.
+	void Remap(TConstArrayView<int32> Sources);
+
+	TConstArrayView<int32> GetNeighbours(const int32 i) const { return TConstArrayView<int32>(Indices).Mid(i * Stride, Counts[i]); }
+
+private:
+	friend struct FAvoidanceNeighbourCacheAccess;
+
+	int32 Stride = 0;
+	TArray<int32> Indices; // Stride entries per agent, the first Counts[i] of them are used
+	TArray<int32> Counts;
+	TArray<float> Drifts; // Bound on how far each agent, or any agent near it, moved since its list was built
+	TArray<int32> Ages; // Solves since the list was built, MAX_int32 for no list
+	TArray<FVector3f> LastPositions; // Where each agent stood at the previous solve
+	TBitArray<> HasLastPositions; // Cleared for agents new to their slot, they have no previous position
+	TArray<float> CellSteps; // Longest step of the agents in each hashed cell, this solve only
+};
+
+/** How much of the solve an agent gets, picked per agent and per solve by the planner's LOD tiers. */
+enum class EAvoidanceSolveMode : uint8
+{
+	Full,			// Goal seeking, anticipatory avoidance and separation
+	SeparationOnly,	// Goal seeking and separation, no time-to-collision prediction
+	GoalOnly,		// Goal seeking only
+	Skip,			// Not solved, the agent's output force is left untouched
+};
+
+/** Work counters filled in by AvoidanceKernel::SolveForces when asked for. */
+struct FAvoidanceSolveStats
+{
+	int64 NumPairTests = 0; // Agent pairs evaluated by the pair kernel, padding lanes included
+	int32 NumNeighbourListsBuilt = 0; // Capped neighbour lists rebuilt rather than reused
+};
+
+struct FAvoidanceSpatialHash;
+struct FAvoidanceObstacleIndex;
+
+namespace AvoidanceKernel
+{
+	/** Time until agents i and j touch, 0 if they already overlap, FLT_MAX if they never will. */
+	ALPHADOGGAME_API float ComputeTimeToCollision(const FAvoidanceAgentArrays& Agents, int32 i, int32 j);
+
+	/** Adds the avoidance force of agent k on agent i to InOutAvoid and its separation force to InOutSeparation. */
+	ALPHADOGGAME_API void AccumulatePair(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, int32 i, int32 k, FVector3f& InOutAvoid, FVector3f& InOutSeparation);
+
+	/** Adds the anticipatory force of every obstacle segment within SensingRadius and ObstacleHalfHeight of agent i, the power-law counterpart of AccumulatePair. */
+	ALPHADOGGAME_API void AccumulateObstacles(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, const FAvoidanceObstacleIndex& Obstacles, int32 i, FVector3f& InOutForce,
+		bool bOrderByPosition = false);
+
+	/** Strict order of agents by position, falling back to slots only for coincident agents. Used where a deterministic solve needs an order. */
+	ALPHADOGGAME_API bool IsBefore(const FAvoidanceAgentArrays& Agents, int32 A, int32 B);
+
+	/** Scalar reference: adds the avoidance and separation forces of agents [j, j + AvoidanceBatchSize) on agent i. */
+	ALPHADOGGAME_API void AccumulateBatchScalar(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, int32 i, int32 j, FVector3f& InOutForce);
+
+	/** Per-lane force sums of the SIMD kernel, reduced once per agent by Reduce(). */
+	struct FLaneForces
+	{
+		VectorRegister4Float X = GlobalVectorConstants::FloatZero;
+		VectorRegister4Float Y = GlobalVectorConstants::FloatZero;
+		VectorRegister4Float Z = GlobalVectorConstants::FloatZero;
+
+		ALPHADOGGAME_API FVector3f Reduce() const;
+	};
+
+	/** SIMD version of AccumulateBatchScalar, one neighbour per lane. j must be a multiple of AvoidanceBatchSize. */
+	ALPHADOGGAME_API void AccumulateBatchSimd(const FAvoidanceAgentArrays& Agents, const FAvoidanceSolverParams& Params, int32 i, int32 j, FLaneForces& InOutForces);
+
+	/**
+	 * Goal seeking plus avoidance force on every agent, parallel over agents. Touches nothing but its arguments,
+	 * so it can run off the game thread as long as the caller owns them for the duration.
+	 * SolveModes holds one mode per agent, empty solves everyone in full.
+	 * With Options.MaxNeighbours set, NeighbourCache carries the capped lists between solves, null rebuilds them every solve.
+	 * Fully solved agents also avoid the static segments of Obstacles when given.
+	 */
+	ALPHADOGGAME_API void SolveForces(const FAvoidanceAgentArrays& Agents, TConstArrayView<FVector> GoalVelocities, const FAvoidanceSolverParams& Params,
+		const FAvoidanceSolveOptions& Options, FAvoidanceSpatialHash& SpatialHash, TArrayView<FVector> OutForces, FAvoidanceSolveStats* OutStats = nullptr,
+		TConstArrayView<EAvoidanceSolveMode> SolveModes = {}, FAvoidanceNeighbourCache* NeighbourCache = nullptr, const FAvoidanceObstacleIndex* Obstacles = nullptr);
+}
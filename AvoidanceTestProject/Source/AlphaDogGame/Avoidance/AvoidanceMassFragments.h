@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "AvoidanceMassFragments.generated.h"
+
+class APawn;
+class UAvoidanceMovementComponent;
+
+/**
+ * Avoidance agents without an actor, simulated by UAvoidanceMassProcessor.
+ * The fragments hold what UAvoidanceComponent and the planner's per-slot arrays hold for actor agents.
+ */
+USTRUCT()
+struct ALPHADOGGAME_API FAvoidanceMassPositionFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector Position = FVector::ZeroVector;
+};
+
+USTRUCT()
+struct ALPHADOGGAME_API FAvoidanceMassVelocityFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector Velocity = FVector::ZeroVector;
+};
+
+USTRUCT()
+struct ALPHADOGGAME_API FAvoidanceMassRadiusFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	float Radius = 30.0f;
+};
+
+USTRUCT()
+struct ALPHADOGGAME_API FAvoidanceMassGoalFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector GoalLocation = FVector::ZeroVector;
+	float StopRadius = 100.0f;
+	float MovementSpeed = 50.0f;
+	bool bHasReachGoal = false;
+};
+
+/** Where the agent steers next. Mass agents share flow fields rather than pathfinding individually. */
+USTRUCT()
+struct ALPHADOGGAME_API FAvoidanceMassPathCursorFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	int32 FlowFieldHandle = INDEX_NONE; // Owned by UAvoidancePlannerSubsystem, INDEX_NONE steers straight at NextLocation
+	FVector NextLocation = FVector::ZeroVector;
+};
+
+/** Actor standing in for the agent near players, null while it is Mass only. */
+USTRUCT()
+struct ALPHADOGGAME_API FAvoidanceMassActorFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	TWeakObjectPtr<APawn> Pawn;
+	TWeakObjectPtr<UAvoidanceMovementComponent> MovementComponent; // Null for pawns moved by another movement component
+};
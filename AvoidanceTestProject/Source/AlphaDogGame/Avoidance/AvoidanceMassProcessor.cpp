@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceMassProcessor.h"
+#include "AvoidanceComponent.h"
+#include "AvoidanceMassFragments.h"
+#include "AvoidanceMovementComponent.h"
+#include "AvoidancePlannerSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "MassExecutionContext.h"
+
+UAvoidanceMassProcessor::UAvoidanceMassProcessor()
+    : EntityQuery(*this)
+{
+    bAutoRegisterWithProcessingPhases = false;
+    // Promotion spawns and destroys actors, but that is left to ApplyStep
+    bRequiresGameThreadExecution = false;
+}
+
+void UAvoidanceMassProcessor::ConfigureQueries()
+{
+    EntityQuery.AddRequirement<FAvoidanceMassPositionFragment>(EMassFragmentAccess::ReadWrite);
+    EntityQuery.AddRequirement<FAvoidanceMassVelocityFragment>(EMassFragmentAccess::ReadWrite);
+    EntityQuery.AddRequirement<FAvoidanceMassRadiusFragment>(EMassFragmentAccess::ReadOnly);
+    EntityQuery.AddRequirement<FAvoidanceMassGoalFragment>(EMassFragmentAccess::ReadWrite);
+    EntityQuery.AddRequirement<FAvoidanceMassPathCursorFragment>(EMassFragmentAccess::ReadOnly);
+}
+
+double UAvoidanceMassProcessor::GetClosestViewpointDistanceSq(const FVector& Position) const
+{
+    double ClosestDistanceSq = UE_DOUBLE_BIG_NUMBER;
+    for (const FVector& Viewpoint : StepParams.Viewpoints)
+    {
+        ClosestDistanceSq = FMath::Min(ClosestDistanceSq, FVector::DistSquared(Position, Viewpoint));
+    }
+    return ClosestDistanceSq;
+}
+
+void UAvoidanceMassProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceMassProcessor_Execute);
+    const UAvoidancePlannerSubsystem* Planner = StepParams.Planner;
+    if (!Planner)
+    {
+        return;
+    }
+    const int32 NumMassAgents = EntityQuery.GetNumMatchingEntities(EntityManager);
+    const int32 NumActorAgents = StepParams.ActorAgents ? StepParams.ActorAgents->Num() : 0;
+    const int32 NumAgents = NumMassAgents + NumActorAgents;
+    // Every lane is overwritten below, shrinking to zero first only keeps the padding lanes zeroed
+    Agents.SetNum(0);
+    Agents.SetNum(NumAgents);
+    GoalVelocities.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    Forces.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    SolveModes.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    ViewpointDistancesSq.SetNumUninitialized(NumMassAgents, EAllowShrinking::No);
+    Entities.SetNumUninitialized(NumMassAgents, EAllowShrinking::No);
+
+    // Same tiers as the planner's actor agents, except that Mass agents never skip a solve since nothing holds their force in between
+    const double MidDistanceSq = FMath::Square(StepParams.LODSettings.MidDistance);
+    const EAvoidanceSolveMode FarMode = StepParams.LODSettings.bFarSeparation ? EAvoidanceSolveMode::SeparationOnly : EAvoidanceSolveMode::GoalOnly;
+    const bool bHasViewpoints = !StepParams.Viewpoints.IsEmpty();
+
+    int32 Slot = 0;
+    EntityQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+    {
+        const TConstArrayView<FAvoidanceMassPositionFragment> Positions = ChunkContext.GetFragmentView<FAvoidanceMassPositionFragment>();
+        const TConstArrayView<FAvoidanceMassVelocityFragment> Velocities = ChunkContext.GetFragmentView<FAvoidanceMassVelocityFragment>();
+        const TConstArrayView<FAvoidanceMassRadiusFragment> Radii = ChunkContext.GetFragmentView<FAvoidanceMassRadiusFragment>();
+        const TArrayView<FAvoidanceMassGoalFragment> Goals = ChunkContext.GetMutableFragmentView<FAvoidanceMassGoalFragment>();
+        const TConstArrayView<FAvoidanceMassPathCursorFragment> Cursors = ChunkContext.GetFragmentView<FAvoidanceMassPathCursorFragment>();
+        for (int32 i = 0; i < ChunkContext.GetNumEntities(); ++i, ++Slot)
+        {
+            Entities[Slot] = ChunkContext.GetEntity(i);
+            const FVector& Position = Positions[i].Position;
+            Agents.SetPosition(Slot, Position);
+            Agents.SetVelocity(Slot, Velocities[i].Velocity);
+            Agents.Radii[Slot] = Radii[i].Radius;
+
+            FAvoidanceMassGoalFragment& Goal = Goals[i];
+            Goal.bHasReachGoal = FVector::DistSquared2D(Position, Goal.GoalLocation) <= FMath::Square(Goal.StopRadius);
+            FVector Direction;
+            if (!Planner->GetFlowFieldDirection(Cursors[i].FlowFieldHandle, Position, Direction))
+            {
+                Direction = (Cursors[i].NextLocation - Position).GetSafeNormal();
+            }
+            GoalVelocities[Slot] = Goal.bHasReachGoal ? FVector::ZeroVector : Direction * Goal.MovementSpeed;
+
+            // Without anyone watching everybody is solved in full, like actor agents, but nobody is promoted
+            const double DistanceSq = GetClosestViewpointDistanceSq(Position);
+            ViewpointDistancesSq[Slot] = DistanceSq;
+            SolveModes[Slot] = !bHasViewpoints || DistanceSq <= MidDistanceSq ? EAvoidanceSolveMode::Full : FarMode;
+        }
+    });
+    check(Slot == NumMassAgents);
+
+    // Actor agents are only there to be avoided, the planner solves and moves them itself
+    for (int32 i = 0; i < NumActorAgents; ++i, ++Slot)
+    {
+        Agents.SetPosition(Slot, StepParams.ActorAgents->GetPosition(i));
+        Agents.SetVelocity(Slot, StepParams.ActorAgents->GetVelocity(i));
+        Agents.Radii[Slot] = StepParams.ActorAgents->Radii[i];
+        GoalVelocities[Slot] = FVector::ZeroVector;
+        SolveModes[Slot] = EAvoidanceSolveMode::Skip;
+    }
+}
+
+void UAvoidanceMassProcessor::Solve()
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceMassProcessor_Solve);
+    // Query order changes whenever an entity is created or destroyed, so neighbour lists are not cached across steps
+    FAvoidanceSolverParams SolverParams = StepParams.SolverParams;
+    SolverParams.TimeStep = FMath::Max(StepParams.DeltaTime, UE_KINDA_SMALL_NUMBER);
+    SolveStats = FAvoidanceSolveStats();
+    AvoidanceKernel::SolveForces(Agents, GoalVelocities, SolverParams, StepParams.SolveOptions, SpatialHash, Forces, &SolveStats, SolveModes, nullptr,
+        StepParams.Obstacles.Get());
+}
+
+void UAvoidanceMassProcessor::ApplyStep(FMassEntityManager& EntityManager, const float DeltaTime)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceMassProcessor_ApplyStep);
+    const FADogAvoidanceMassSettings& MassSettings = StepParams.MassSettings;
+    const double PromotionDistanceSq = FMath::Square(MassSettings.PromotionDistance);
+    const double DemotionDistanceSq = FMath::Square(MassSettings.PromotionDistance + MassSettings.DemotionMargin);
+    const bool bCanPromote = !StepParams.Viewpoints.IsEmpty() && MassSettings.PromotedPawnClass;
+    int32 NumPromotedThisFrame = 0;
+    NumPromoted = 0;
+    for (int32 Slot = 0; Slot < Entities.Num(); ++Slot)
+    {
+        // Destroyed since the gather
+        const FMassEntityHandle Entity = Entities[Slot];
+        if (!EntityManager.IsEntityValid(Entity))
+        {
+            continue;
+        }
+        const FAvoidanceMassGoalFragment& Goal = EntityManager.GetFragmentDataChecked<FAvoidanceMassGoalFragment>(Entity);
+        FVector& Velocity = EntityManager.GetFragmentDataChecked<FAvoidanceMassVelocityFragment>(Entity).Velocity;
+        Velocity = Goal.bHasReachGoal ? FVector::ZeroVector : Velocity + Forces[Slot] * DeltaTime;
+        FVector& Position = EntityManager.GetFragmentDataChecked<FAvoidanceMassPositionFragment>(Entity).Position;
+
+        FAvoidanceMassActorFragment& Actor = EntityManager.GetFragmentDataChecked<FAvoidanceMassActorFragment>(Entity);
+        APawn* Pawn = Actor.Pawn.Get();
+        const double DistanceSq = ViewpointDistancesSq[Slot];
+        if (Pawn && (!bCanPromote || DistanceSq > DemotionDistanceSq))
+        {
+            Pawn->Destroy();
+            Pawn = nullptr;
+            Actor = FAvoidanceMassActorFragment();
+        }
+        else if (!Pawn && bCanPromote && DistanceSq <= PromotionDistanceSq && NumPromotedThisFrame < MassSettings.MaxPromotionsPerFrame)
+        {
+            Pawn = SpawnPromotedPawn(Position, Velocity, Goal, EntityManager.GetFragmentDataChecked<FAvoidanceMassRadiusFragment>(Entity).Radius);
+            Actor.Pawn = Pawn;
+            Actor.MovementComponent = Pawn ? Cast<UAvoidanceMovementComponent>(Pawn->GetMovementComponent()) : nullptr;
+            ++NumPromotedThisFrame;
+        }
+
+        if (!Pawn)
+        {
+            Position += Velocity * DeltaTime;
+            continue;
+        }
+        ++NumPromoted;
+        // The pawn moves itself this frame and its position is read back next step, others are placed like in deterministic mode
+        if (UAvoidanceMovementComponent* MovementComponent = Actor.MovementComponent.Get())
+        {
+            MovementComponent->RequestVelocity(Velocity);
+        }
+        else
+        {
+            Position += Velocity * DeltaTime;
+            Pawn->SetActorLocation(Position);
+        }
+    }
+}
+
+void UAvoidanceMassProcessor::ReadBackPromotedPawns(FMassEntityManager& EntityManager)
+{
+    // Only gathered agents are ever promoted, so the last gather's entities cover every pawn
+    for (const FMassEntityHandle Entity : Entities)
+    {
+        if (!EntityManager.IsEntityValid(Entity))
+        {
+            continue;
+        }
+        if (const APawn* Pawn = EntityManager.GetFragmentDataChecked<FAvoidanceMassActorFragment>(Entity).Pawn.Get())
+        {
+            EntityManager.GetFragmentDataChecked<FAvoidanceMassPositionFragment>(Entity).Position = Pawn->GetActorLocation();
+        }
+    }
+}
+
+APawn* UAvoidanceMassProcessor::SpawnPromotedPawn(const FVector& Location, const FVector& Velocity, const FAvoidanceMassGoalFragment& Goal, const float Radius) const
+{
+    UWorld* World = StepParams.Planner->GetWorld();
+    const FTransform Transform(FRotator(0.0f, Velocity.IsNearlyZero() ? 0.0f : Velocity.Rotation().Yaw, 0.0f), Location);
+    APawn* Pawn = World->SpawnActorDeferred<APawn>(StepParams.MassSettings.PromotedPawnClass, Transform, nullptr, nullptr,
+        ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+    if (!Pawn)
+    {
+        return nullptr;
+    }
+    // Before BeginPlay, so the component stands in for the agent instead of registering as an actor agent of its own
+    if (UAvoidanceComponent* AvoidComp = Pawn->FindComponentByClass<UAvoidanceComponent>())
+    {
+        AvoidComp->bMassAgent = true;
+        AvoidComp->GoalLocation = Goal.GoalLocation;
+        AvoidComp->StopRadius = Goal.StopRadius;
+        AvoidComp->MovementSpeed = Goal.MovementSpeed;
+        AvoidComp->Radious = Radius;
+        AvoidComp->bHasGoal = true;
+        AvoidComp->bHasReachGoal = Goal.bHasReachGoal;
+    }
+    Pawn->FinishSpawning(Transform);
+    return Pawn;
+}
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AvoidanceKernel.h"
+#include "AvoidanceSpatialHash.h"
+#include "GameModes/ADogWorldSettings.h"
+#include "MassEntityQuery.h"
+#include "MassProcessor.h"
+#include "AvoidanceMassProcessor.generated.h"
+
+class UAvoidancePlannerSubsystem;
+struct FAvoidanceMassActorFragment;
+struct FAvoidanceMassGoalFragment;
+struct FAvoidanceObstacleIndex;
+
+/** Everything UAvoidanceMassProcessor needs from the planner for one step. */
+struct FAvoidanceMassStepParams
+{
+	const UAvoidancePlannerSubsystem* Planner = nullptr; // Flow field lookups
+	float DeltaTime = 0.0f;
+	FAvoidanceSolverParams SolverParams;
+	FAvoidanceSolveOptions SolveOptions;
+	FADogAvoidanceLODSettings LODSettings;
+	FADogAvoidanceMassSettings MassSettings;
+	TArray<FVector, TInlineAllocator<4>> Viewpoints;
+	const FAvoidanceAgentArrays* ActorAgents = nullptr; // The planner's actor agents, avoided by Mass agents but solved by the planner. Copied by Execute
+	TSharedPtr<const FAvoidanceObstacleIndex, ESPMode::ThreadSafe> Obstacles; // Held until the solve is done, the planner may swap in a new index meanwhile
+};
+
+/**
+ * Steps the Mass avoidance agents through the same AvoidanceKernel::SolveForces as the planner's actor agents, in three stages:
+ * Execute gathers the fragments into SoA lanes, Solve runs on a task, and ApplyStep writes the result back by entity on the game thread.
+ * Agents within FADogAvoidanceMassSettings::PromotionDistance of a player are promoted to a full pawn, which the solve
+ * then moves through its UAvoidanceMovementComponent so it collides and replicates, and demoted again once out of range.
+ * Only ApplyStep and ReadBackPromotedPawns touch actors, Execute and Solve only touch fragments and the processor's own lanes.
+ * Not registered with the processing phases, UAvoidancePlannerSubsystem runs it at the start of every frame.
+ */
+UCLASS()
+class ALPHADOGGAME_API UAvoidanceMassProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UAvoidanceMassProcessor();
+
+	// Inputs of the next Execute
+	void SetStepParams(FAvoidanceMassStepParams&& InStepParams) { StepParams = MoveTemp(InStepParams); }
+
+	// Solves the lanes gathered by the last Execute. Any thread, as long as nothing else runs a stage meanwhile
+	void Solve();
+	// Game thread: integrates the solved agents, promotes and demotes them, and hands promoted pawns their velocity
+	void ApplyStep(FMassEntityManager& EntityManager, float DeltaTime);
+	// Game thread: moves promoted agents to wherever their pawn got to, collisions included. Before Execute
+	void ReadBackPromotedPawns(FMassEntityManager& EntityManager);
+
+	int32 GetNumPromoted() const { return NumPromoted; }
+	const FAvoidanceSolveStats& GetSolveStats() const { return SolveStats; }
+	// Mass agents as of the last Execute, the first GetNumGatheredAgents() lanes. Read only while no Execute runs
+	const FAvoidanceAgentArrays& GetGatheredAgents() const { return Agents; }
+	int32 GetNumGatheredAgents() const { return Entities.Num(); }
+	TConstArrayView<FMassEntityHandle> GetGatheredEntities() const { return Entities; }
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+	APawn* SpawnPromotedPawn(const FVector& Location, const FVector& Velocity, const FAvoidanceMassGoalFragment& Goal, float Radius) const;
+	double GetClosestViewpointDistanceSq(const FVector& Position) const;
+
+	FMassEntityQuery EntityQuery;
+	FAvoidanceMassStepParams StepParams;
+
+	// Solve scratch, Mass agents in query order followed by the actor agents
+	FAvoidanceAgentArrays Agents;
+	TArray<FVector> GoalVelocities;
+	TArray<FVector> Forces;
+	TArray<EAvoidanceSolveMode> SolveModes;
+	TArray<double> ViewpointDistancesSq; // Per Mass agent, drives promotion
+	TArray<FMassEntityHandle> Entities; // Per Mass agent, entities may be created or destroyed between gather and apply
+	FAvoidanceSpatialHash SpatialHash;
+	FAvoidanceSolveStats SolveStats;
+	int32 NumPromoted = 0;
+};
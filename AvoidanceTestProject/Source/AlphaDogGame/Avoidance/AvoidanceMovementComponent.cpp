@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceMovementComponent.h"
+#include "AvoidanceComponent.h"
+
+void UAvoidanceMovementComponent::BeginPlay()
+{
+    Super::BeginPlay();
+    AvoidanceComponent = GetOwner()->FindComponentByClass<UAvoidanceComponent>();
+}
+
+void UAvoidanceMovementComponent::BindReplicationData_Implementation()
+{
+    Super::BindReplicationData_Implementation();
+
+    // Output of the server's solve. Sent periodically rather than on change, so a crowd costs the same bounded amount per agent
+    // however much it steers, and proxies interpolate linearly between the received states.
+    BI_CombinedVelocity = BindCompressedVector(
+        CombinedVelocity,
+        EGMC_PredictionMode::ServerAuth_Output_ServerValidated,
+        EGMC_CombineMode::CombineIfUnchanged,
+        EGMC_SimulationMode::Periodic_Output,
+        EGMC_InterpolationFunction::Linear
+    );
+}
+
+void UAvoidanceMovementComponent::PreLocalMoveExecution_Implementation(const FGMC_Move& LocalMove)
+{
+    Super::PreLocalMoveExecution_Implementation(LocalMove);
+
+    // The planner may apply after actor ticks (synchronous solve), so a request waits for the next move instead of expiring with its frame
+    const FVector InputVector = ConsumeInputVector();
+    if (bHasRequestedVelocity)
+    {
+        bHasRequestedVelocity = false;
+        MoveVelocity = RequestedVelocity.GetClampedToMaxSize(MaxSpeed);
+    }
+    else
+    {
+        // AddMovementInput callers (BulkApply off, pawns not driven by the planner) steer like they did with floating pawn movement
+        MoveVelocity = InputVector.GetClampedToMaxSize(1.0f) * MaxSpeed;
+    }
+}
+
+void UAvoidanceMovementComponent::GenPredictionTick_Implementation(const float DeltaTime)
+{
+    Super::GenPredictionTick_Implementation(DeltaTime);
+
+    UpdateVelocity(MoveVelocity, DeltaTime);
+    const FVector Delta = Velocity * DeltaTime;
+    if (!Delta.IsNearlyZero())
+    {
+        FHitResult Hit;
+        SafeMoveUpdatedComponent(Delta, UpdatedComponent->GetComponentQuat(), true, Hit);
+        if (Hit.IsValidBlockingHit())
+        {
+            SlideAlongSurface(Delta, 1.0f - Hit.Time, Hit.Normal, Hit, true);
+        }
+    }
+    CombinedVelocity = Velocity;
+}
+
+void UAvoidanceMovementComponent::GenSimulationTick_Implementation(const float DeltaTime)
+{
+    Super::GenSimulationTick_Implementation(DeltaTime);
+
+    // Proxies do not steer, hand the smoothed server velocity to whatever reads the avoidance component (animation, effects)
+    if (AvoidanceComponent)
+    {
+        AvoidanceComponent->CombinedVelocity = CombinedVelocity;
+    }
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GMCMovementUtilityComponent.h"
+#include "AvoidanceMovementComponent.generated.h"
+
+class UAvoidanceComponent;
+
+/**
+ * GMC movement for avoidance agents. Avoidance is solved on the server only: the planner requests a velocity each frame,
+ * the server moves the pawn with it and writes the result into CombinedVelocity, which is bound as a compressed vector.
+ * Simulated proxies receive the actor transform and CombinedVelocity through GMC and interpolate them with its smoothing,
+ * they never run the solve. A request is kept until the next move consumes it, without one the pawn follows the pending input
+ * vector like a floating pawn (AddMovementInput, scaled to MaxSpeed) and stops when there is none.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class ALPHADOGGAME_API UAvoidanceMovementComponent : public UGMC_MovementUtilityCmp
+{
+	GENERATED_BODY()
+
+public:
+	// Velocity for the next move, clamped to MaxSpeed
+	void RequestVelocity(const FVector& InVelocity)
+	{
+		RequestedVelocity = InVelocity;
+		bHasRequestedVelocity = true;
+	}
+
+	virtual float GetMaxSpeed() const override { return MaxSpeed; }
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Avoidance", meta=(ForceUnits="cm/s"))
+	float MaxSpeed = 1200.0f;
+
+	// Final steering velocity, server authoritative and interpolated on simulated proxies. Replicated to 2 decimals.
+	UPROPERTY(BlueprintReadOnly, Category="Avoidance")
+	FVector CombinedVelocity = FVector::ZeroVector;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void BindReplicationData_Implementation() override;
+	virtual void PreLocalMoveExecution_Implementation(const FGMC_Move& LocalMove) override;
+	virtual void GenPredictionTick_Implementation(float DeltaTime) override;
+	virtual void GenSimulationTick_Implementation(float DeltaTime) override;
+
+private:
+	UPROPERTY()
+	TObjectPtr<UAvoidanceComponent> AvoidanceComponent;
+
+	FVector RequestedVelocity = FVector::ZeroVector;
+	bool bHasRequestedVelocity = false;
+	FVector MoveVelocity = FVector::ZeroVector; // Target velocity of the current move, shared by its sub-steps
+	int32 BI_CombinedVelocity = INDEX_NONE;
+};
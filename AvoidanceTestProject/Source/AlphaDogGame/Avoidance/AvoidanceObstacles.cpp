@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceObstacles.h"
+#include "Algo/BinarySearch.h"
+#include "NavMesh/RecastNavMesh.h"
+#if WITH_RECAST
+#include "Detour/DetourNavMesh.h"
+#include "NavMesh/RecastHelpers.h"
+#endif
+
+void FAvoidanceObstacleTile::Build(TArray<FAvoidanceSegment>&& InSegments, const float InCellSize)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceObstacleTile_Build);
+    check(InCellSize > 0.0f);
+    Segments = MoveTemp(InSegments);
+    CellSize = InCellSize;
+    InvCellSize = 1.0f / InCellSize;
+    Bounds = FBox3f(ForceInit);
+    for (const FAvoidanceSegment& Segment : Segments)
+    {
+        Bounds += Segment.Start;
+        Bounds += Segment.End;
+    }
+
+    // Long edges are split into cell-sized pieces, each piece covers at most the 2x2 cells around its bounds.
+    // The union of those covers every cell the segment passes through.
+    TArray<TPair<uint32, int32>> Entries; // Bucket, segment
+    TArray<uint32, TInlineAllocator<64>> SegmentBuckets;
+    const uint32 NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(Segments.Num() * 4, 64));
+    BucketMask = NumBuckets - 1;
+    for (int32 SegmentIndex = 0; SegmentIndex < Segments.Num(); ++SegmentIndex)
+    {
+        const FVector2f Start(Segments[SegmentIndex].Start);
+        const FVector2f End(Segments[SegmentIndex].End);
+        const int32 NumPieces = FMath::Max(1, FMath::CeilToInt32(FVector2f::Distance(Start, End) * InvCellSize));
+        SegmentBuckets.Reset();
+        for (int32 Piece = 0; Piece < NumPieces; ++Piece)
+        {
+            const FVector2f PieceStart = FMath::Lerp(Start, End, static_cast<float>(Piece) / NumPieces);
+            const FVector2f PieceEnd = FMath::Lerp(Start, End, static_cast<float>(Piece + 1) / NumPieces);
+            const FIntPoint MinCell = GetCell(FMath::Min(PieceStart.X, PieceEnd.X), FMath::Min(PieceStart.Y, PieceEnd.Y));
+            const FIntPoint MaxCell = GetCell(FMath::Max(PieceStart.X, PieceEnd.X), FMath::Max(PieceStart.Y, PieceEnd.Y));
+            for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+            {
+                for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+                {
+                    SegmentBuckets.AddUnique(GetBucket(CellX, CellY));
+                }
+            }
+        }
+        for (const uint32 Bucket : SegmentBuckets)
+        {
+            Entries.Emplace(Bucket, SegmentIndex);
+        }
+    }
+
+    // Counting sort, see FAvoidanceSpatialHash::Build
+    BucketStarts.Reset();
+    BucketStarts.SetNumZeroed(NumBuckets + 1);
+    for (const TPair<uint32, int32>& Entry : Entries)
+    {
+        ++BucketStarts[Entry.Key + 1];
+    }
+    for (uint32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+    {
+        BucketStarts[Bucket + 1] += BucketStarts[Bucket];
+    }
+    TArray<int32> BucketCursors(BucketStarts.GetData(), static_cast<int32>(NumBuckets));
+    SortedSegments.SetNumUninitialized(Entries.Num());
+    for (const TPair<uint32, int32>& Entry : Entries)
+    {
+        SortedSegments[BucketCursors[Entry.Key]++] = Entry.Value;
+    }
+}
+
+void FAvoidanceObstacleIndex::Build(TArray<FTileRef>&& InTiles)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceObstacleIndex_Build);
+    Tiles = MoveTemp(InTiles);
+    TileOffsets.Reset(Tiles.Num() + 1);
+    TileOffsets.Add(0);
+    float CellSize = 1.0f;
+    for (const FTileRef& Tile : Tiles)
+    {
+        TileOffsets.Add(TileOffsets.Last() + Tile->Num());
+        CellSize = FMath::Max3(CellSize, Tile->GetBounds().GetSize().X, Tile->GetBounds().GetSize().Y);
+    }
+
+    // Navmesh tiles share one size, so with cells as large as the largest tile each tile overlaps at most 2x2 cells
+    InvCellSize = 1.0f / CellSize;
+    TileCells.Reset();
+    for (int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex)
+    {
+        const FBox3f& TileBounds = Tiles[TileIndex]->GetBounds();
+        const FIntPoint MinCell = GetCell(TileBounds.Min.X, TileBounds.Min.Y);
+        const FIntPoint MaxCell = GetCell(TileBounds.Max.X, TileBounds.Max.Y);
+        for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+        {
+            for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+            {
+                TileCells.FindOrAdd(FIntPoint(CellX, CellY)).Add(TileIndex);
+            }
+        }
+    }
+}
+
+const FAvoidanceSegment& FAvoidanceObstacleIndex::GetSegment(const int32 Index) const
+{
+    const int32 TileIndex = Algo::UpperBound(TileOffsets, Index) - 1;
+    return Tiles[TileIndex]->GetSegment(Index - TileOffsets[TileIndex]);
+}
+
+void AvoidanceObstacles::GatherTileSegments(const ARecastNavMesh& NavMesh, const int32 TileIndex, TArray<FAvoidanceSegment>& OutSegments)
+{
+#if WITH_RECAST
+    const dtNavMesh* DetourNavMesh = NavMesh.GetRecastMesh();
+    const dtMeshTile* Tile = DetourNavMesh && TileIndex >= 0 && TileIndex < DetourNavMesh->getMaxTiles() ? DetourNavMesh->getTile(TileIndex) : nullptr;
+    if (!Tile || !Tile->header)
+    {
+        return;
+    }
+
+    for (int32 PolyIndex = 0; PolyIndex < Tile->header->polyCount; ++PolyIndex)
+    {
+        const dtPoly& Poly = Tile->polys[PolyIndex];
+        if (Poly.getType() != DT_POLYTYPE_GROUND)
+        {
+            continue; // Off-mesh links have no walls
+        }
+        for (int32 Edge = 0; Edge < Poly.vertCount; ++Edge)
+        {
+            if (Poly.neis[Edge] & DT_EXT_LINK)
+            {
+                // Tile border, it is a wall unless a polygon of the next tile links across it
+                bool bLinked = false;
+                for (unsigned int LinkIndex = Poly.firstLink; LinkIndex != DT_NULL_LINK; LinkIndex = DetourNavMesh->getLink(Tile, LinkIndex).next)
+                {
+                    if (DetourNavMesh->getLink(Tile, LinkIndex).edge == Edge)
+                    {
+                        bLinked = true;
+                        break;
+                    }
+                }
+                if (bLinked)
+                {
+                    continue;
+                }
+            }
+            else if (Poly.neis[Edge] != 0)
+            {
+                continue; // Shared with a polygon of the same tile
+            }
+            const FVector Start = Recast2UnrealPoint(&Tile->verts[Poly.verts[Edge] * 3]);
+            const FVector End = Recast2UnrealPoint(&Tile->verts[Poly.verts[(Edge + 1) % Poly.vertCount] * 3]);
+            OutSegments.Add({ FVector3f(Start), FVector3f(End) });
+        }
+    }
+#endif
+}
+
+float AvoidanceObstacles::ComputeTimeToCollision(const FAvoidanceSegment& Segment, const FVector2f& Position, const FVector2f& Velocity, const float Radius)
+{
+    if (FVector2f::DistSquared(Position, GetClosestPoint(Segment, Position)) < FMath::Square(Radius))
+    {
+        return 0.0f;
+    }
+
+    float TimeToCollision = FLT_MAX;
+    const FVector2f Start(Segment.Start);
+    const FVector2f End(Segment.End);
+    // Either endpoint, same quadratic as an agent pair with one radius and a static partner
+    const float A = Velocity.SizeSquared();
+    if (A > 0.0f)
+    {
+        for (const FVector2f& Endpoint : { Start, End })
+        {
+            const FVector2f W = Endpoint - Position;
+            const float B = FVector2f::DotProduct(W, Velocity);
+            const float Discr = B * B - A * (W.SizeSquared() - Radius * Radius);
+            if (Discr > 0.0f)
+            {
+                const float Tau = (B - FMath::Sqrt(Discr)) / A;
+                if (Tau >= 0.0f)
+                {
+                    TimeToCollision = FMath::Min(TimeToCollision, Tau);
+                }
+            }
+        }
+    }
+
+    // The body of the segment, touched once the disc is Radius away from its line with the contact between the endpoints
+    const FVector2f Edge = End - Start;
+    const float EdgeLengthSq = Edge.SizeSquared();
+    if (EdgeLengthSq > 0.0f)
+    {
+        FVector2f Normal = FVector2f(-Edge.Y, Edge.X) * FMath::InvSqrt(EdgeLengthSq);
+        float Distance = FVector2f::DotProduct(Position - Start, Normal);
+        if (Distance < 0.0f)
+        {
+            Normal = -Normal;
+            Distance = -Distance;
+        }
+        const float ApproachSpeed = -FVector2f::DotProduct(Velocity, Normal);
+        if (ApproachSpeed > 0.0f)
+        {
+            const float Tau = (Distance - Radius) / ApproachSpeed;
+            const float Alpha = FVector2f::DotProduct(Position + Velocity * Tau - Start, Edge) / EdgeLengthSq;
+            if (Alpha >= 0.0f && Alpha <= 1.0f)
+            {
+                TimeToCollision = FMath::Min(TimeToCollision, Tau);
+            }
+        }
+    }
+    return TimeToCollision;
+}
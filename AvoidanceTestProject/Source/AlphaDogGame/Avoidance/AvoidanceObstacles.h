@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ARecastNavMesh;
+
+/** Navmesh boundary edge, agents treat it as a wall in the XY plane. */
+struct FAvoidanceSegment
+{
+	FVector3f Start;
+	FVector3f End;
+};
+
+/**
+ * Boundary edges of one navmesh tile hashed into a uniform XY grid, like FAvoidanceSpatialHash but built once per tile build.
+ * Immutable once built and shared by every FAvoidanceObstacleIndex the tile is part of.
+ */
+struct ALPHADOGGAME_API FAvoidanceObstacleTile
+{
+	void Build(TArray<FAvoidanceSegment>&& InSegments, float InCellSize);
+
+	// Calls Func(SegmentIndex) for every segment crossing a cell that overlaps the XY square of half-size Radius around (X, Y).
+	// A segment crossing several of those cells is reported once per cell, and callers must still distance test.
+	template <typename FuncType>
+	void ForEachCandidate(const float X, const float Y, float Radius, FuncType&& Func) const
+	{
+		if (SortedSegments.IsEmpty())
+		{
+			return;
+		}
+		Radius += CellSize * 0.01f;
+		const FIntPoint MinCell = GetCell(X - Radius, Y - Radius);
+		const FIntPoint MaxCell = GetCell(X + Radius, Y + Radius);
+		TArray<uint32, TInlineAllocator<16>> VisitedBuckets;
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+			{
+				const uint32 Bucket = GetBucket(CellX, CellY);
+				if (VisitedBuckets.Contains(Bucket))
+				{
+					continue;
+				}
+				VisitedBuckets.Add(Bucket);
+				for (int32 Entry = BucketStarts[Bucket]; Entry < BucketStarts[Bucket + 1]; ++Entry)
+				{
+					Func(SortedSegments[Entry]);
+				}
+			}
+		}
+	}
+
+	const FAvoidanceSegment& GetSegment(const int32 Index) const { return Segments[Index]; }
+	int32 Num() const { return Segments.Num(); }
+	const FBox3f& GetBounds() const { return Bounds; }
+
+private:
+	FIntPoint GetCell(const float X, const float Y) const
+	{
+		return FIntPoint(FMath::FloorToInt32(X * InvCellSize), FMath::FloorToInt32(Y * InvCellSize));
+	}
+
+	uint32 GetBucket(const int32 CellX, const int32 CellY) const
+	{
+		return ((static_cast<uint32>(CellX) * 73856093u) ^ (static_cast<uint32>(CellY) * 19349663u)) & BucketMask;
+	}
+
+	TArray<FAvoidanceSegment> Segments;
+	FBox3f Bounds = FBox3f(ForceInit); // Of every segment, lets the index skip the tile by position and height
+	float CellSize = 100.0f;
+	float InvCellSize = 0.01f;
+	uint32 BucketMask = 0;
+	TArray<int32> BucketStarts; // Prefix sums, NumBuckets + 1 entries
+	TArray<int32> SortedSegments; // Segment indices grouped by bucket
+};
+
+/**
+ * Static obstacle segments of a navmesh, one FAvoidanceObstacleTile per tile behind a coarse grid of tile bounds.
+ * Immutable once built, so the planner swaps in a new one after tile builds while a solve task keeps reading the old one.
+ * Tiles are shared, a new index only costs the tiles that were rebuilt plus this grid.
+ */
+struct ALPHADOGGAME_API FAvoidanceObstacleIndex
+{
+	using FTileRef = TSharedRef<const FAvoidanceObstacleTile, ESPMode::ThreadSafe>;
+
+	void Build(TArray<FTileRef>&& InTiles);
+
+	// Calls Func(SegmentIndex) for the candidates of every tile whose bounds overlap the XY square of half-size Radius around (X, Y)
+	// and the height range [Z - HalfHeight, Z + HalfHeight]. Same contract as FAvoidanceObstacleTile::ForEachCandidate otherwise.
+	template <typename FuncType>
+	void ForEachCandidate(const float X, const float Y, const float Z, const float Radius, const float HalfHeight, FuncType&& Func) const
+	{
+		if (Tiles.IsEmpty())
+		{
+			return;
+		}
+		const FBox3f QueryBounds(FVector3f(X - Radius, Y - Radius, Z - HalfHeight), FVector3f(X + Radius, Y + Radius, Z + HalfHeight));
+		const FIntPoint MinCell = GetCell(QueryBounds.Min.X, QueryBounds.Min.Y);
+		const FIntPoint MaxCell = GetCell(QueryBounds.Max.X, QueryBounds.Max.Y);
+		TArray<int32, TInlineAllocator<8>> VisitedTiles;
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+			{
+				const TArray<int32>* CellTiles = TileCells.Find(FIntPoint(CellX, CellY));
+				if (!CellTiles)
+				{
+					continue;
+				}
+				for (const int32 TileIndex : *CellTiles)
+				{
+					if (VisitedTiles.Contains(TileIndex) || !Tiles[TileIndex]->GetBounds().Intersect(QueryBounds))
+					{
+						continue;
+					}
+					VisitedTiles.Add(TileIndex);
+					const int32 FirstSegment = TileOffsets[TileIndex];
+					Tiles[TileIndex]->ForEachCandidate(X, Y, Radius, [&Func, FirstSegment](const int32 SegmentIndex)
+					{
+						Func(FirstSegment + SegmentIndex);
+					});
+				}
+			}
+		}
+	}
+
+	const FAvoidanceSegment& GetSegment(int32 Index) const;
+	int32 Num() const { return TileOffsets.IsEmpty() ? 0 : TileOffsets.Last(); }
+
+private:
+	FIntPoint GetCell(const float X, const float Y) const
+	{
+		return FIntPoint(FMath::FloorToInt32(X * InvCellSize), FMath::FloorToInt32(Y * InvCellSize));
+	}
+
+	TArray<FTileRef> Tiles;
+	TArray<int32> TileOffsets; // Index of each tile's first segment, Tiles.Num() + 1 entries
+	TMap<FIntPoint, TArray<int32>> TileCells; // Tiles overlapping each cell, one cell is about one navmesh tile
+	float InvCellSize = 0.001f;
+};
+
+namespace AvoidanceObstacles
+{
+	/** Fraction along Segment of its point closest to Point, in the XY plane. */
+	inline float GetClosestAlpha(const FAvoidanceSegment& Segment, const FVector2f& Point)
+	{
+		const FVector2f Start(Segment.Start);
+		const FVector2f Edge = FVector2f(Segment.End) - Start;
+		const float EdgeLengthSq = Edge.SizeSquared();
+		return EdgeLengthSq > 0.0f ? FMath::Clamp(FVector2f::DotProduct(Point - Start, Edge) / EdgeLengthSq, 0.0f, 1.0f) : 0.0f;
+	}
+
+	/** Point of Segment closest to Point, in the XY plane. */
+	inline FVector2f GetClosestPoint(const FAvoidanceSegment& Segment, const FVector2f& Point)
+	{
+		const FVector2f Start(Segment.Start);
+		return Start + (FVector2f(Segment.End) - Start) * GetClosestAlpha(Segment, Point);
+	}
+
+	/** Whether Segment is within HalfHeight of Z where it comes closest to Point, so walls of the floors above and below are ignored. */
+	inline bool IsAtHeight(const FAvoidanceSegment& Segment, const FVector2f& Point, const float Z, const float HalfHeight)
+	{
+		return FMath::Abs(FMath::Lerp(Segment.Start.Z, Segment.End.Z, GetClosestAlpha(Segment, Point)) - Z) <= HalfHeight;
+	}
+
+	/** Time until a disc moving from Position at Velocity touches Segment, 0 if it already does, FLT_MAX if it never will. */
+	ALPHADOGGAME_API float ComputeTimeToCollision(const FAvoidanceSegment& Segment, const FVector2f& Position, const FVector2f& Velocity, float Radius);
+
+	/** Appends the edges of TileIndex's walkable polygons that no polygon continues across. Empty if the tile holds no navmesh. */
+	ALPHADOGGAME_API void GatherTileSegments(const ARecastNavMesh& NavMesh, int32 TileIndex, TArray<FAvoidanceSegment>& OutSegments);
+}
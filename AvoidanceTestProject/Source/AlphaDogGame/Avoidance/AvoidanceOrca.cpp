@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceOrca.h"
+#include "AvoidanceKernel.h"
+
+namespace AvoidanceOrca
+{
+    static constexpr float ParallelEpsilon = 1.0e-5f;
+
+    // Optimum on line LineIndex, subject to the lines before it and the speed disc. False if they leave no room on it.
+    static bool SolveOnLine(TConstArrayView<FOrcaLine> Lines, const int32 LineIndex, const float MaxSpeed, const FVector2f& OptVelocity,
+        const bool bOptimizeDirection, FVector2f& InOutResult)
+    {
+        const FOrcaLine& Line = Lines[LineIndex];
+        const float DotProduct = FVector2f::DotProduct(Line.Point, Line.Direction);
+        const float Discriminant = FMath::Square(DotProduct) + FMath::Square(MaxSpeed) - Line.Point.SizeSquared();
+        if (Discriminant < 0.0f)
+        {
+            return false; // The speed disc does not reach the line
+        }
+        const float SqrtDiscriminant = FMath::Sqrt(Discriminant);
+        float TLeft = -DotProduct - SqrtDiscriminant;
+        float TRight = -DotProduct + SqrtDiscriminant;
+
+        for (int32 Other = 0; Other < LineIndex; ++Other)
+        {
+            const float Denominator = FVector2f::CrossProduct(Line.Direction, Lines[Other].Direction);
+            const float Numerator = FVector2f::CrossProduct(Lines[Other].Direction, Line.Point - Lines[Other].Point);
+            if (FMath::Abs(Denominator) <= ParallelEpsilon)
+            {
+                // Parallel lines, either the other one covers this one entirely or excludes it entirely
+                if (Numerator < 0.0f)
+                {
+                    return false;
+                }
+                continue;
+            }
+            const float T = Numerator / Denominator;
+            if (Denominator >= 0.0f)
+            {
+                TRight = FMath::Min(TRight, T);
+            }
+            else
+            {
+                TLeft = FMath::Max(TLeft, T);
+            }
+            if (TLeft > TRight)
+            {
+                return false;
+            }
+        }
+
+        if (bOptimizeDirection)
+        {
+            InOutResult = Line.Point + Line.Direction * (FVector2f::DotProduct(OptVelocity, Line.Direction) > 0.0f ? TRight : TLeft);
+        }
+        else
+        {
+            const float T = FVector2f::DotProduct(Line.Direction, OptVelocity - Line.Point);
+            InOutResult = Line.Point + Line.Direction * FMath::Clamp(T, TLeft, TRight);
+        }
+        return true;
+    }
+
+    // Incremental LP over the lines in order, returns the index of the first line that could not be met or Lines.Num()
+    static int32 SolveLines(TConstArrayView<FOrcaLine> Lines, const float MaxSpeed, const FVector2f& OptVelocity, const bool bOptimizeDirection,
+        FVector2f& OutResult)
+    {
+        if (bOptimizeDirection)
+        {
+            OutResult = OptVelocity * MaxSpeed; // OptVelocity is a unit direction here
+        }
+        else if (OptVelocity.SizeSquared() > FMath::Square(MaxSpeed))
+        {
+            OutResult = OptVelocity.GetSafeNormal() * MaxSpeed;
+        }
+        else
+        {
+            OutResult = OptVelocity;
+        }
+
+        for (int32 LineIndex = 0; LineIndex < Lines.Num(); ++LineIndex)
+        {
+            if (FVector2f::CrossProduct(Lines[LineIndex].Direction, Lines[LineIndex].Point - OutResult) > 0.0f)
+            {
+                // The current result is on the wrong side, the new optimum lies on this line
+                const FVector2f PreviousResult = OutResult;
+                if (!SolveOnLine(Lines, LineIndex, MaxSpeed, OptVelocity, bOptimizeDirection, OutResult))
+                {
+                    OutResult = PreviousResult;
+                    return LineIndex;
+                }
+            }
+        }
+        return Lines.Num();
+    }
+
+    // Infeasible program: minimises the largest violation of the soft lines from FirstFailedLine on, in one dimension higher
+    static void SolveLeastPenetration(TConstArrayView<FOrcaLine> Lines, const int32 NumHardLines, const int32 FirstFailedLine, const float MaxSpeed,
+        FVector2f& InOutResult)
+    {
+        float Distance = 0.0f;
+        TArray<FOrcaLine, TInlineAllocator<32>> ProjectedLines;
+        for (int32 LineIndex = FirstFailedLine; LineIndex < Lines.Num(); ++LineIndex)
+        {
+            const FOrcaLine& Line = Lines[LineIndex];
+            if (FVector2f::CrossProduct(Line.Direction, Line.Point - InOutResult) <= Distance)
+            {
+                continue; // Already violated no more than the current worst
+            }
+
+            ProjectedLines.Reset();
+            ProjectedLines.Append(Lines.GetData(), NumHardLines);
+            for (int32 Other = NumHardLines; Other < LineIndex; ++Other)
+            {
+                FOrcaLine Projected;
+                const float Determinant = FVector2f::CrossProduct(Line.Direction, Lines[Other].Direction);
+                if (FMath::Abs(Determinant) <= ParallelEpsilon)
+                {
+                    if (FVector2f::DotProduct(Line.Direction, Lines[Other].Direction) > 0.0f)
+                    {
+                        continue; // Same direction, the other line adds no constraint
+                    }
+                    Projected.Point = (Line.Point + Lines[Other].Point) * 0.5f;
+                }
+                else
+                {
+                    Projected.Point = Line.Point + Line.Direction * (FVector2f::CrossProduct(Lines[Other].Direction, Line.Point - Lines[Other].Point) / Determinant);
+                }
+                Projected.Direction = (Lines[Other].Direction - Line.Direction).GetSafeNormal();
+                ProjectedLines.Add(Projected);
+            }
+
+            const FVector2f PreviousResult = InOutResult;
+            if (SolveLines(ProjectedLines, MaxSpeed, FVector2f(-Line.Direction.Y, Line.Direction.X), true, InOutResult) < ProjectedLines.Num())
+            {
+                // Can only fail by float error, the result is already optimal then
+                InOutResult = PreviousResult;
+            }
+            Distance = FVector2f::CrossProduct(Line.Direction, Line.Point - InOutResult);
+        }
+    }
+}
+
+void AvoidanceOrca::AddAgentLine(const FAvoidanceAgentArrays& Agents, const int32 i, const int32 k, const float InvTimeHorizon, const float InvTimeStep,
+    TArray<FOrcaLine, TInlineAllocator<32>>& InOutLines)
+{
+    const FVector2f Velocity(Agents.VelX[i], Agents.VelY[i]);
+    const FVector2f RelativePosition(Agents.PosX[k] - Agents.PosX[i], Agents.PosY[k] - Agents.PosY[i]);
+    const FVector2f RelativeVelocity = Velocity - FVector2f(Agents.VelX[k], Agents.VelY[k]);
+    const float DistSq = RelativePosition.SizeSquared();
+    const float CombinedRadius = Agents.Radii[i] + Agents.Radii[k];
+    const float CombinedRadiusSq = FMath::Square(CombinedRadius);
+
+    FOrcaLine Line;
+    FVector2f U; // Smallest change of relative velocity that leaves the velocity obstacle
+    if (DistSq > CombinedRadiusSq)
+    {
+        // Vector from the cutoff centre of the truncated cone to the relative velocity
+        const FVector2f W = RelativeVelocity - RelativePosition * InvTimeHorizon;
+        const float WLengthSq = W.SizeSquared();
+        const float DotProduct = FVector2f::DotProduct(W, RelativePosition);
+        if (DotProduct < 0.0f && FMath::Square(DotProduct) > CombinedRadiusSq * WLengthSq)
+        {
+            // Closest to the cutoff circle
+            const float WLength = FMath::Sqrt(WLengthSq);
+            const FVector2f UnitW = W / WLength;
+            Line.Direction = FVector2f(UnitW.Y, -UnitW.X);
+            U = UnitW * (CombinedRadius * InvTimeHorizon - WLength);
+        }
+        else
+        {
+            // Closest to one of the cone legs
+            const float Leg = FMath::Sqrt(DistSq - CombinedRadiusSq);
+            if (FVector2f::CrossProduct(RelativePosition, W) > 0.0f)
+            {
+                Line.Direction = FVector2f(RelativePosition.X * Leg - RelativePosition.Y * CombinedRadius,
+                    RelativePosition.X * CombinedRadius + RelativePosition.Y * Leg) / DistSq;
+            }
+            else
+            {
+                Line.Direction = -FVector2f(RelativePosition.X * Leg + RelativePosition.Y * CombinedRadius,
+                    -RelativePosition.X * CombinedRadius + RelativePosition.Y * Leg) / DistSq;
+            }
+            U = Line.Direction * FVector2f::DotProduct(RelativeVelocity, Line.Direction) - RelativeVelocity;
+        }
+    }
+    else
+    {
+        // Already overlapping, resolve within one time step
+        const FVector2f W = RelativeVelocity - RelativePosition * InvTimeStep;
+        const float WLength = W.Size();
+        const FVector2f UnitW = WLength > 0.0f ? W / WLength : FVector2f(1.0f, 0.0f);
+        Line.Direction = FVector2f(UnitW.Y, -UnitW.X);
+        U = UnitW * (CombinedRadius * InvTimeStep - WLength);
+    }
+    Line.Point = Velocity + U * 0.5f;
+    InOutLines.Add(Line);
+}
+
+void AvoidanceOrca::AddObstacleLine(const FAvoidanceAgentArrays& Agents, const int32 i, const FVector2f& ClosestPoint, const float InvTimeHorizon,
+    const float InvTimeStep, TArray<FOrcaLine, TInlineAllocator<32>>& InOutLines)
+{
+    const FVector2f ToObstacle = ClosestPoint - FVector2f(Agents.PosX[i], Agents.PosY[i]);
+    const float Distance = ToObstacle.Size();
+    if (Distance <= 0.0f)
+    {
+        return; // Centre on the wall, no side to push towards
+    }
+    // Velocities may close at most the gap to the wall within the horizon, overlaps are pushed out within one step.
+    // The agent takes full responsibility, the wall does not move.
+    const FVector2f Normal = ToObstacle / Distance;
+    const float Gap = Distance - Agents.Radii[i];
+    FOrcaLine Line;
+    Line.Direction = FVector2f(-Normal.Y, Normal.X);
+    Line.Point = Normal * (Gap * (Gap > 0.0f ? InvTimeHorizon : InvTimeStep));
+    InOutLines.Add(Line);
+}
+
+FVector2f AvoidanceOrca::SolveVelocity(TConstArrayView<FOrcaLine> Lines, const int32 NumHardLines, const float MaxSpeed, const FVector2f& PreferredVelocity)
+{
+    FVector2f Result;
+    const int32 FailedLine = SolveLines(Lines, MaxSpeed, PreferredVelocity, false, Result);
+    if (FailedLine < Lines.Num())
+    {
+        SolveLeastPenetration(Lines, NumHardLines, FailedLine, MaxSpeed, Result);
+    }
+    return Result;
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FAvoidanceAgentArrays;
+
+/**
+ * Optimal reciprocal collision avoidance (van den Berg et al.) in the XY plane.
+ * Every neighbour contributes a half-plane of permitted velocities, and the new velocity is the one
+ * closest to the preferred velocity inside all of them and the max speed disc, found by an incremental 2D linear program.
+ */
+namespace AvoidanceOrca
+{
+	/** Permitted velocities lie to the left of Direction through Point. */
+	struct FOrcaLine
+	{
+		FVector2f Point;
+		FVector2f Direction;
+	};
+
+	/** Adds the half-plane agent k imposes on agent i, each of them taking half the responsibility for avoiding the other. */
+	ALPHADOGGAME_API void AddAgentLine(const FAvoidanceAgentArrays& Agents, int32 i, int32 k, float InvTimeHorizon, float InvTimeStep, TArray<FOrcaLine, TInlineAllocator<32>>& InOutLines);
+
+	/**
+	 * Adds the half-plane keeping agent i from reaching a static obstacle whose closest point is ClosestPoint within the horizon.
+	 * The obstacle is convex, so its supporting half-plane at ClosestPoint holds all of it.
+	 */
+	ALPHADOGGAME_API void AddObstacleLine(const FAvoidanceAgentArrays& Agents, int32 i, const FVector2f& ClosestPoint, float InvTimeHorizon, float InvTimeStep, TArray<FOrcaLine, TInlineAllocator<32>>& InOutLines);
+
+	/**
+	 * Velocity closest to PreferredVelocity satisfying every line within MaxSpeed.
+	 * The first NumHardLines lines, obstacles, are never relaxed. When the rest cannot all be met,
+	 * the velocity that violates the worst of them the least is returned.
+	 */
+	ALPHADOGGAME_API FVector2f SolveVelocity(TConstArrayView<FOrcaLine> Lines, int32 NumHardLines, float MaxSpeed, const FVector2f& PreferredVelocity);
+}
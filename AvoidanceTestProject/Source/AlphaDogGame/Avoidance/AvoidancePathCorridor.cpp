@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidancePathCorridor.h"
+
+void FAvoidancePathCorridor::Assign(TConstArrayView<FNavPathPoint> NavPoints, const ANavigationData* InNavData)
+{
+    Reset();
+    NavData = InNavData;
+    for (int32 Index = 0; Index < NavPoints.Num(); ++Index)
+    {
+        const FVector& Location = NavPoints[Index].Location;
+        Bounds += Location;
+        // String pull: a corner the path passes straight through adds nothing but an extra waypoint advance
+        if (Points.Num() > 0 && Index + 1 < NavPoints.Num())
+        {
+            const FVector InDirection = (Location - Points.Last()).GetSafeNormal();
+            const FVector OutDirection = (NavPoints[Index + 1].Location - Location).GetSafeNormal();
+            if (FVector::DotProduct(InDirection, OutDirection) > 0.9999f)
+            {
+                continue;
+            }
+        }
+        Points.Add(Location);
+    }
+    // The first point is where the agent stood when the query was dispatched
+    Cursor = FMath::Min(1, Points.Num());
+}
+
+void FAvoidancePathCorridor::Reset()
+{
+    Points.Reset();
+    Cursor = 0;
+    Bounds.Init();
+    NavData.Reset();
+}
+
+void FAvoidancePathCorridor::Shortcut(const FVector& Location, const int32 MaxLookahead)
+{
+    const ANavigationData* PathNavData = NavData.Get();
+    if (!PathNavData)
+    {
+        return;
+    }
+    // The goal end of the path is kept, it is the only waypoint that must be reached exactly
+    const int32 LastShortcut = FMath::Min(Cursor + MaxLookahead, Points.Num() - 1);
+    for (int32 Next = Cursor + 1; Next <= LastShortcut; ++Next)
+    {
+        FVector HitLocation;
+        if (PathNavData->Raycast(Location, Points[Next], HitLocation, nullptr))
+        {
+            break;
+        }
+        Cursor = Next;
+    }
+}
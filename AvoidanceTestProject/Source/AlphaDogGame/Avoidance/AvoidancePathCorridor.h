@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationData.h"
+
+/**
+ * Waypoints of an agent's current path with a cursor on the next one to reach.
+ * Advancing only moves the cursor, and the buffer keeps its storage across repaths,
+ * so neither waypoint advance nor repathing allocates once paths fit the inline capacity.
+ */
+struct ALPHADOGGAME_API FAvoidancePathCorridor
+{
+	static constexpr int32 InlineCapacity = 16;
+
+	// Copies the engine path, dropping collinear corners, and targets the first waypoint after the start
+	void Assign(TConstArrayView<FNavPathPoint> NavPoints, const ANavigationData* InNavData);
+	void Reset();
+
+	// Moves the cursor past every waypoint the agent at Location can already reach in a straight line on the navmesh
+	void Shortcut(const FVector& Location, int32 MaxLookahead);
+	void Advance() { Cursor = FMath::Min(Cursor + 1, Points.Num()); }
+
+	bool HasPath() const { return !Points.IsEmpty(); }
+	bool IsFinished() const { return Cursor >= Points.Num(); }
+	const FVector& GetCurrentPoint() const { return Points[Cursor]; }
+	// Waypoints from the cursor to the end of the path
+	TConstArrayView<FVector> GetRemainingPoints() const { return TConstArrayView<FVector>(Points).RightChop(Cursor); }
+	// Bounds of the whole path, used by the planner to cull navmesh tile rebuilds
+	const FBox& GetBounds() const { return Bounds; }
+
+private:
+	TArray<FVector, TInlineAllocator<InlineCapacity>> Points;
+	int32 Cursor = 0;
+	FBox Bounds = FBox(ForceInit);
+	TWeakObjectPtr<const ANavigationData> NavData; // Navmesh the path was found on, used for shortcut raycasts
+};
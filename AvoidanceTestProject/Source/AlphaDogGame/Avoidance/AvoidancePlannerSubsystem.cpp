@@ -2,239 +2,1350 @@
 
 #include "AvoidancePlannerSubsystem.h"
 #include "AvoidanceComponent.h"
+#include "Debug/ADogLogging.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
 #include "Engine/World.h"
 #include "GameFramework/Actor.h"
-#include "EngineUtils.h"
-#include "DrawDebugHelpers.h"
+#include "GameFramework/PlayerController.h"
+#include "AvoidanceMassFragments.h"
+#include "AvoidanceMassProcessor.h"
+#include "AvoidanceMovementComponent.h"
+#include "Components/LineBatchComponent.h"
+#include "MassEntitySubsystem.h"
+#include "MassExecutor.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#if WITH_RECAST
+#include "Detour/DetourNavMesh.h"
+#endif
 
-void UAvoidancePlannerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+namespace AvoidanceConsoleVariables
 {
-    Super::Initialize(Collection);
+    static bool bUseSpatialHash = true;
+    static FAutoConsoleVariableRef CVarUseSpatialHash(
+        TEXT("AlphaDog.Avoidance.UseSpatialHash"),
+        bUseSpatialHash,
+        TEXT("Use the spatial hash broadphase in the force solve (true) or compare every agent pair (false). Both produce identical forces."),
+        ECVF_Default);
 
-    FTimerHandle Timer;
-    GetWorld()->GetTimerManager().SetTimer(Timer,
-    FTimerDelegate::CreateWeakLambda(this, [this]()
-    {
-        GatherAgents();
-        InitializeAgents();
-    }), 4.f, false);
+    static bool bUseSimdKernel = true;
+    static FAutoConsoleVariableRef CVarUseSimdKernel(
+        TEXT("AlphaDog.Avoidance.UseSimdKernel"),
+        bUseSimdKernel,
+        TEXT("Evaluate neighbour batches with the VectorRegister kernel (true) or the scalar reference kernel (false). Forces agree to within 1e-3, not bit for bit."),
+        ECVF_Default);
+
+    static bool bAsyncSolve = true;
+    static FAutoConsoleVariableRef CVarAsyncSolve(
+        TEXT("AlphaDog.Avoidance.AsyncSolve"),
+        bAsyncSolve,
+        TEXT("Overlap the force solve with the next frame and apply it one frame later (true) or solve and apply within the planner tick (false)."),
+        ECVF_Default);
+
+    static int32 MaxPathQueriesPerFrame = 32;
+    static FAutoConsoleVariableRef CVarMaxPathQueriesPerFrame(
+        TEXT("AlphaDog.Avoidance.MaxPathQueriesPerFrame"),
+        MaxPathQueriesPerFrame,
+        TEXT("Maximum number of async path queries the avoidance planner dispatches per frame."),
+        ECVF_Default);
+
+    static float PathQueryBudgetMs = 0.5f;
+    static FAutoConsoleVariableRef CVarPathQueryBudgetMs(
+        TEXT("AlphaDog.Avoidance.PathQueryBudgetMs"),
+        PathQueryBudgetMs,
+        TEXT("Game thread time in milliseconds the avoidance planner may spend dispatching path queries per frame."),
+        ECVF_Default);
+
+    static float PathShareStartRadius = 300.0f;
+    static FAutoConsoleVariableRef CVarPathShareStartRadius(
+        TEXT("AlphaDog.Avoidance.PathShareStartRadius"),
+        PathShareStartRadius,
+        TEXT("Queued path requests starting within this distance of each other and heading to the same goal share one query. 0 queries every agent on its own."),
+        ECVF_Default);
+
+    static float PathShareGoalTolerance = 50.0f;
+    static FAutoConsoleVariableRef CVarPathShareGoalTolerance(
+        TEXT("AlphaDog.Avoidance.PathShareGoalTolerance"),
+        PathShareGoalTolerance,
+        TEXT("Goals closer than this count as the same goal when sharing path queries, see AlphaDog.Avoidance.PathShareStartRadius."),
+        ECVF_Default);
+
+    static float PathlessRetryInterval = 1.0f;
+    static FAutoConsoleVariableRef CVarPathlessRetryInterval(
+        TEXT("AlphaDog.Avoidance.PathlessRetryInterval"),
+        PathlessRetryInterval,
+        TEXT("Seconds an agent without a path waits before navmesh tile rebuilds may retry its path query again."),
+        ECVF_Default);
+
+    static float FlowFieldCellSize = 100.0f;
+    static FAutoConsoleVariableRef CVarFlowFieldCellSize(
+        TEXT("AlphaDog.Avoidance.FlowFieldCellSize"),
+        FlowFieldCellSize,
+        TEXT("Cell size of flow fields built from now on."),
+        ECVF_Default);
+
+    static float FlowFieldMaxHalfExtent = 10000.0f;
+    static FAutoConsoleVariableRef CVarFlowFieldMaxHalfExtent(
+        TEXT("AlphaDog.Avoidance.FlowFieldMaxHalfExtent"),
+        FlowFieldMaxHalfExtent,
+        TEXT("Flow fields cover at most this distance around their goal, agents outside it steer straight at the goal until they enter it."),
+        ECVF_Default);
+
+    static float ObstacleBuildBudgetMs = 0.5f;
+    static FAutoConsoleVariableRef CVarObstacleBuildBudgetMs(
+        TEXT("AlphaDog.Avoidance.ObstacleBuildBudgetMs"),
+        ObstacleBuildBudgetMs,
+        TEXT("Game thread time in milliseconds the avoidance planner may spend extracting navmesh tile walls per frame. At least one tile is extracted per frame."),
+        ECVF_Default);
+
+    static float FlowFieldBuildBudgetMs = 1.0f;
+    static FAutoConsoleVariableRef CVarFlowFieldBuildBudgetMs(
+        TEXT("AlphaDog.Avoidance.FlowFieldBuildBudgetMs"),
+        FlowFieldBuildBudgetMs,
+        TEXT("Game thread time in milliseconds the avoidance planner may spend sampling the navmesh for flow fields per frame. Each building field samples at least one row per frame."),
+        ECVF_Default);
+
+    static int32 MaxNeighbours = 0;
+    static FAutoConsoleVariableRef CVarMaxNeighbours(
+        TEXT("AlphaDog.Avoidance.MaxNeighbours"),
+        MaxNeighbours,
+        TEXT("Avoid at most this many neighbours per agent, soonest time to collision first, with the lists cached across frames. 0 avoids every neighbour in range."),
+        ECVF_Default);
+
+    static float NeighbourCacheMargin = 25.0f;
+    static FAutoConsoleVariableRef CVarNeighbourCacheMargin(
+        TEXT("AlphaDog.Avoidance.NeighbourCacheMargin"),
+        NeighbourCacheMargin,
+        TEXT("Distance an agent, or an agent near it, may move before its cached neighbour list is rebuilt, see AlphaDog.Avoidance.MaxNeighbours."),
+        ECVF_Default);
+
+    static int32 MaxNeighbourListAge = 8;
+    static FAutoConsoleVariableRef CVarMaxNeighbourListAge(
+        TEXT("AlphaDog.Avoidance.MaxNeighbourListAge"),
+        MaxNeighbourListAge,
+        TEXT("Solves a cached neighbour list is reused for at most, however little its agent moved."),
+        ECVF_Default);
+
+    static bool bBulkApply = true;
+    static FAutoConsoleVariableRef CVarBulkApply(
+        TEXT("AlphaDog.Avoidance.BulkApply"),
+        bBulkApply,
+        TEXT("Write solved velocities straight into pawns' UAvoidanceMovementComponent (true) or feed them through AddMovementInput (false). Pawns with other movement components always use AddMovementInput."),
+        ECVF_Default);
+
+    static bool bCapture = false;
+    static FAutoConsoleVariableRef CVarCapture(
+        TEXT("AlphaDog.Avoidance.Capture"),
+        bCapture,
+        TEXT("Record every solve's agent state and the spawns and despawns between them to Saved/AvoidanceCaptures, for replay by the AlphaDog.Avoidance.Benchmark.CaptureReplay test."),
+        ECVF_Default);
 }
 
-void UAvoidancePlannerSubsystem::Deinitialize()
+DECLARE_CYCLE_STAT(TEXT("Snapshot"), STAT_AvoidanceSnapshot, STATGROUP_AvoidancePlanner);
+DECLARE_CYCLE_STAT(TEXT("Solve (task)"), STAT_AvoidanceSolve, STATGROUP_AvoidancePlanner);
+DECLARE_CYCLE_STAT(TEXT("Wait For Solve"), STAT_AvoidanceWaitForSolve, STATGROUP_AvoidancePlanner);
+DECLARE_CYCLE_STAT(TEXT("Apply Forces"), STAT_AvoidanceApplyForces, STATGROUP_AvoidancePlanner);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Solve Time Hidden (ms)"), STAT_AvoidanceSolveHiddenMs, STATGROUP_AvoidancePlanner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Agents Solved"), STAT_AvoidanceAgentsSolved, STATGROUP_AvoidancePlanner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Neighbour Lists Built"), STAT_AvoidanceNeighbourListsBuilt, STATGROUP_AvoidancePlanner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Agents Near"), STAT_AvoidanceAgentsNear, STATGROUP_AvoidancePlanner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Agents Mid"), STAT_AvoidanceAgentsMid, STATGROUP_AvoidancePlanner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Agents Far"), STAT_AvoidanceAgentsFar, STATGROUP_AvoidancePlanner);
+DECLARE_CYCLE_STAT(TEXT("Mass Step"), STAT_AvoidanceMassStep, STATGROUP_AvoidancePlanner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mass Agents"), STAT_AvoidanceMassAgents, STATGROUP_AvoidancePlanner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mass Agents Promoted"), STAT_AvoidanceMassAgentsPromoted, STATGROUP_AvoidancePlanner);
+#if ENABLE_DRAW_DEBUG
+namespace AvoidanceDebugDraw
 {
-    Super::Deinitialize();
-    //CleanUps
+    constexpr int32 NumCircleSegments = 12;
+
+    // Radius circle and velocity line of an agent, gathered so the whole crowd goes to the line batcher at once
+    static void AddAgent(TArray<FBatchedLine>& Lines, const FVector& Position, const float Radius, const FVector& Velocity)
+    {
+        FVector Previous = Position + FVector(Radius, 0.0f, 0.0f);
+        for (int32 Segment = 1; Segment <= NumCircleSegments; ++Segment)
+        {
+            const float Angle = UE_TWO_PI * Segment / NumCircleSegments;
+            const FVector Next = Position + FVector(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), 0.0f);
+            Lines.Emplace(Previous, Next, FLinearColor::Red, 0.0f, 0.1f, SDPG_World);
+            Previous = Next;
+        }
+        Lines.Emplace(Position, Position + Velocity, FLinearColor::Green, 0.0f, 1.0f, SDPG_World);
+    }
+
+    static void Submit(const UWorld* World, TArray<FBatchedLine>& Lines)
+    {
+        if (World->LineBatcher && !Lines.IsEmpty())
+        {
+            World->LineBatcher->DrawLines(Lines);
+        }
+    }
 }
+#endif
 
-void UAvoidancePlannerSubsystem::Tick(float DeltaTime)
+DECLARE_CYCLE_STAT(TEXT("Capture"), STAT_AvoidanceCapture, STATGROUP_AvoidancePlanner);
+DECLARE_MEMORY_STAT(TEXT("Capture Bytes Written"), STAT_AvoidanceCaptureBytes, STATGROUP_AvoidancePlanner);
+
+void UAvoidancePlannerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
-    ComputeForces(DeltaTime);
+    Super::Initialize(Collection);
+    Collection.InitializeDependency<UMassEntitySubsystem>();
+    PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UAvoidancePlannerSubsystem::OnWorldPreActorTick);
 }
 
-void UAvoidancePlannerSubsystem::GatherAgents()
+void UAvoidancePlannerSubsystem::Deinitialize()
 {
+    Super::Deinitialize();
+
+    FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+    SolveTask.Wait();
+    SolveTask = UE::Tasks::FTask();
+    MassSolveTask.Wait();
+    MassSolveTask = UE::Tasks::FTask();
+    bHasMassSolve = false;
+    Capture.Close();
+    SolveAgents.Empty();
+    PendingAgents.Empty();
+    bHasPendingForces = false;
+
+    for (UAvoidanceComponent* AvoidComp : AvoidanceComponents)
+    {
+        AvoidComp->AvoidanceSlot = INDEX_NONE;
+        AvoidComp->FlowFieldHandle = INDEX_NONE;
+    }
     Agents.Empty();
     AvoidanceComponents.Empty();
-
-    // Iterate over all actors and cache those with an AvoidanceComponent.
-    for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+    AgentData.SetNum(0);
+    GoalVelocities.Empty();
+    AgentLODs.Empty();
+    TargetForces.Empty();
+    AppliedForces.Empty();
+    FixedPositions.Empty();
+    MovementComponents.Empty();
+    SpatialHash.Reset();
+    NeighbourCache.Invalidate();
+    NumNeighbourSlots = 0;
+    NeighbourSlotSources.Empty();
+    bNeighbourSlotsChanged = false;
+    PathRequestQueue.Empty();
+    PathRequestHead = 0;
+    for (const TWeakObjectPtr<ARecastNavMesh>& WeakNavMesh : ObservedNavMeshes)
     {
-        APawn* Actor = *It;
-        if (UAvoidanceComponent* AvoidComp = Actor->FindComponentByClass<UAvoidanceComponent>())
+        if (ARecastNavMesh* NavMesh = WeakNavMesh.Get())
         {
-            Agents.Add(Actor);
-            AvoidanceComponents.Add(AvoidComp);
+            NavMesh->OnNavMeshTilesUpdated.RemoveAll(this);
         }
     }
-    const uint32 NumAgents = Agents.Num();
-    Positions.SetNum(NumAgents);
-    Radii.SetNum(NumAgents);
-    Velocities.SetNum(NumAgents);
-    GoalVelocities.SetNum(NumAgents);
+    ObservedNavMeshes.Empty();
+    FlowFields.Empty();
+    ObstacleNavMesh.Reset();
+    ObstacleTiles.Empty();
+    PendingObstacleTiles.Empty();
+    Obstacles.Reset();
+    // Mass entities go with the entity subsystem, promoted pawns with the world
+    MassProcessor = nullptr;
+    MassArchetype = FMassArchetypeHandle();
+    NumMassAgents = 0;
+}
+
+void UAvoidancePlannerSubsystem::Tick(float DeltaTime)
+{
+    DispatchPathRequests();
+    BuildPendingObstacleTiles();
+    ContinueFlowFieldBuilds();
+    UpdateCapture();
+    const FADogAvoidanceSolverSettings SolverSettings = GetSolverSettings();
+    if (SolverSettings.bDeterministic)
+    {
+        TickDeterministic(DeltaTime, SolverSettings);
+        return;
+    }
+    if (bDeterministicRunning || bBulkApplyActive != AvoidanceConsoleVariables::bBulkApply)
+    {
+        bDeterministicRunning = false;
+        bBulkApplyActive = AvoidanceConsoleVariables::bBulkApply;
+        UpdateDrivenByPlanner();
+    }
+    // The solve launched last tick had the whole frame to run, its forces are applied at the next frame start
+    CollectSolve();
+    LaunchSolve(DeltaTime);
+    if (!AvoidanceConsoleVariables::bAsyncSolve)
+    {
+        CollectSolve();
+        ApplyForces(DeltaTime);
+    }
 }
 
-void UAvoidancePlannerSubsystem::InitializeAgents()
+void UAvoidancePlannerSubsystem::OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
 {
-    const uint32 NumAgents = Agents.Num();
-    for (uint32 i = 0; i <  NumAgents; ++i)
+    if (World != GetWorld())
     {
-        const AActor* Agent = Agents[i];
-        Positions[i] = Agent->GetActorLocation();
-        Radii[i] = AvoidanceComponents[i]->Radious;
-        Velocities[i] = Agent->GetVelocity();
-        GoalVelocities[i] = AvoidanceComponents[i]->AvoidanceVelocity;
+        return;
+    }
+    if (bHasPendingForces)
+    {
+        ApplyForces(DeltaSeconds);
+    }
+    if (NumMassAgents > 0 || bHasMassSolve)
+    {
+        StepMassAgents(DeltaSeconds);
     }
 }
 
-void UAvoidancePlannerSubsystem::ComputeForces(float DeltaTime)
+void UAvoidancePlannerSubsystem::RequestPath(UAvoidanceComponent* AvoidComp)
 {
-    const uint32 NumAgents = Agents.Num();
-    TArray<FVector> Forces;
-    Forces.SetNum(NumAgents);
-    // Refresh positions and initialize forces based on goal velocities.
-    for (uint32 i = 0; i < NumAgents; ++i)
+    if (AvoidComp->PathQueryId != INVALID_NAVQUERYID)
     {
-        Positions[i] = Agents[i]->GetActorLocation();
-        Forces[i] = 2.0f * (GoalVelocities[i] - Velocities[i]);
+        // Fold into the query in flight, it is re-issued from the agent's new location once delivered
+        AvoidComp->bRepathWhenDelivered = true;
     }
-    
-#pragma region Multi-Threaded version
+    else if (!AvoidComp->bPathRequestQueued)
     {
-        TRACE_CPUPROFILER_EVENT_SCOPE(ComputeForces_Parallel);
-        ParallelFor(NumAgents, [&](const uint32 i)
+        // Start and goal are read at dispatch time, so one queued entry covers every request until then
+        AvoidComp->bPathRequestQueued = true;
+        PathRequestQueue.Add(AvoidComp);
+    }
+}
+
+void UAvoidancePlannerSubsystem::DispatchPathRequests()
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidancePlanner_DispatchPathRequests);
+    UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+    if (!NavSystem || PathRequestHead == PathRequestQueue.Num())
+    {
+        return;
+    }
+
+    // Requests further back in the queue that this one may answer, bounded so a long queue stays cheap to scan
+    constexpr int32 PathShareScanWindow = 64;
+    const double StartRadiusSq = FMath::Square(AvoidanceConsoleVariables::PathShareStartRadius);
+    const double GoalToleranceSq = FMath::Square(AvoidanceConsoleVariables::PathShareGoalTolerance);
+    const double StartTime = FPlatformTime::Seconds();
+    const double BudgetSeconds = AvoidanceConsoleVariables::PathQueryBudgetMs * 0.001;
+    int32 NumDispatched = 0;
+    while (PathRequestHead < PathRequestQueue.Num() && NumDispatched < AvoidanceConsoleVariables::MaxPathQueriesPerFrame)
+    {
+        UAvoidanceComponent* AvoidComp = PathRequestQueue[PathRequestHead++].Get();
+        if (!AvoidComp || !AvoidComp->ActorIns)
+        {
+            continue;
+        }
+        AvoidComp->bPathRequestQueued = false;
+
+        const APawn* Pawn = AvoidComp->ActorIns;
+        const FNavAgentProperties& AgentProperties = Pawn->GetNavAgentPropertiesRef();
+        const FVector Start = Pawn->GetActorLocation();
+        const ANavigationData* NavData = NavSystem->GetNavDataForProps(AgentProperties, Start);
+        if (!NavData)
         {
-            const FVector Pos_I = Positions[i];
-            const FVector Vel_I = Velocities[i];
-            FVector LocalForce = FVector::ZeroVector;
-                constexpr uint32 BatchSize = 4; //Process agents in batches.  Adjust based on SIMD width (4 for SSE, 8 for AVX)
-            for (uint32 j = 0; j < NumAgents; j += BatchSize)
+            AvoidComp->OnPathFound(nullptr);
+            continue;
+        }
+        ObserveNavMeshTiles(NavData);
+
+        // Agents of a squad usually repath together, one query from here serves the others and each shortcuts from where it stands
+        TArray<TWeakObjectPtr<UAvoidanceComponent>, TInlineAllocator<8>> Group;
+        Group.Add(AvoidComp);
+        if (StartRadiusSq > 0.0)
+        {
+            const int32 ScanEnd = FMath::Min(PathRequestHead + PathShareScanWindow, PathRequestQueue.Num());
+            for (int32 Index = PathRequestHead; Index < ScanEnd; ++Index)
             {
-                const uint32 BatchEnd = FMath::Min(j + BatchSize, NumAgents);
-                float DistSqBatch[BatchSize]; // SIMD-like arrays for batch processing
-                FVector PosBatch[BatchSize];
-                FVector VelBatch[BatchSize];
-                FVector FAvoidBatch[BatchSize];
-                float MagBatch[BatchSize];
-                for (uint32 k = j; k < BatchEnd; ++k) // Load batch data
-                {
-                    const uint32 Idx = k - j;
-                    if (k == i) { // Skip self-interaction
-                        DistSqBatch[Idx] = FLT_MAX; // Invalid distance
-                        continue;
-                    }
-                    PosBatch[Idx] = Positions[k];
-                    VelBatch[Idx] = Velocities[k];
-                    DistSqBatch[Idx] = FVector::DistSquared(Pos_I, PosBatch[Idx]);
-                }
-                for (uint32 k = j; k < BatchEnd; ++k)// Process collision avoidance in batch
+                UAvoidanceComponent* Other = PathRequestQueue[Index].Get();
+                if (Other && Other->ActorIns
+                    && FVector::DistSquared(Other->GoalLocation, AvoidComp->GoalLocation) <= GoalToleranceSq
+                    && FVector::DistSquared(Other->ActorIns->GetActorLocation(), Start) <= StartRadiusSq
+                    && Other->ActorIns->GetNavAgentPropertiesRef().IsEquivalent(AgentProperties))
                 {
-                    const uint32 Idx = k - j;
-                    if (DistSqBatch[Idx] <= SensingRadiusSq)
-                    {
-                        const float t = ComputeTimeToCollision(i, k); // Scalar for now
-                        FVector PredictedPos_I = Pos_I + Vel_I * t;
-                        FVector PredictedPos_J = PosBatch[Idx] + VelBatch[Idx] * t;
-                        FAvoidBatch[Idx] = PredictedPos_I - PredictedPos_J;
-                        const float SizeSq = FAvoidBatch[Idx].SizeSquared();
-                        if (SizeSq > 0.0f) {
-                            FAvoidBatch[Idx] /= FMath::Sqrt(SizeSq); // Normalize
-                            MagBatch[Idx] = (t >= 0.0f && t <= TimeHorizon) ? (TimeHorizon - t) / (t + 0.001f) : 0.0f;
-                            MagBatch[Idx] = FMath::Min(MagBatch[Idx], MaxForce);
-                            FAvoidBatch[Idx] *= MagBatch[Idx];
-                        }
-                        else {
-                            FAvoidBatch[Idx] = FVector::ZeroVector;
-                        }
-                    }
-                    else {
-                        FAvoidBatch[Idx] = FVector::ZeroVector;
-                    }
-                    if (DistSqBatch[Idx] < SeparationDistanceSq) { // Separation force
-                        FVector SeparationDirection = Pos_I - PosBatch[Idx];
-                        SeparationDirection.Normalize();
-                        LocalForce += SeparationDirection * SeparationForceMag;
-                    }
+                    Other->bPathRequestQueued = false;
+                    PathRequestQueue[Index].Reset(); // Skipped once the head gets there
+                    Group.Add(Other);
                 }
-                for (uint32 k = j; k < BatchEnd; ++k) {  // Accumulate avoidance forces from batch
-                    LocalForce += FAvoidBatch[k - j];
-                }
-            }Forces[i] += LocalForce;// Accumulate the computed force
-        }, EParallelForFlags::BackgroundPriority);
+            }
+        }
+
+        const FPathFindingQuery Query(Pawn, *NavData, Start, AvoidComp->GoalLocation);
+        const uint32 QueryId = NavSystem->FindPathAsync(AgentProperties, Query,
+            FNavPathQueryDelegate::CreateUObject(this, &UAvoidancePlannerSubsystem::OnPathQueryFinished, TArray<TWeakObjectPtr<UAvoidanceComponent>>(Group)));
+        for (const TWeakObjectPtr<UAvoidanceComponent>& Member : Group)
+        {
+            Member->PathQueryId = QueryId;
+        }
+        ++NumDispatched;
+
+        if (FPlatformTime::Seconds() - StartTime > BudgetSeconds)
+        {
+            break;
+        }
     }
-#pragma endregion
 
-#pragma region Single-thread version:
-/*{ 
-    TRACE_CPUPROFILER_EVENT_SCOPE(ComputeForces_SingleThread);
-        for (uint32 i = 0; i < NumAgents; ++i)
+    // Consumed entries are dropped in bulk once they make up half the queue, so each costs O(1) amortized
+    if (PathRequestHead == PathRequestQueue.Num())
+    {
+        PathRequestQueue.Reset();
+        PathRequestHead = 0;
+    }
+    else if (PathRequestHead * 2 >= PathRequestQueue.Num())
+    {
+        PathRequestQueue.RemoveAt(0, PathRequestHead, EAllowShrinking::No);
+        PathRequestHead = 0;
+    }
+}
+
+void UAvoidancePlannerSubsystem::OnPathQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr NavPath, TArray<TWeakObjectPtr<UAvoidanceComponent>> Group)
+{
+    for (const TWeakObjectPtr<UAvoidanceComponent>& WeakAvoidComp : Group)
+    {
+        UAvoidanceComponent* AvoidComp = WeakAvoidComp.Get();
+        if (!AvoidComp || AvoidComp->PathQueryId != QueryId)
         {
-            const FVector Pos_I = Positions[i];
-            const FVector Vel_I = Velocities[i];
-            FVector LocalForce = FVector::ZeroVector;
+            continue;
+        }
+        AvoidComp->PathQueryId = INVALID_NAVQUERYID;
+        AvoidComp->OnPathFound(Result == ENavigationQueryResult::Success ? NavPath : nullptr);
 
-            for (uint32 j = 0; j < NumAgents; ++j)
+        if (AvoidComp->bRepathWhenDelivered)
+        {
+            AvoidComp->bRepathWhenDelivered = false;
+            RequestPath(AvoidComp);
+        }
+    }
+}
+
+void UAvoidancePlannerSubsystem::ObserveNavMeshTiles(const ANavigationData* NavData)
+{
+    ARecastNavMesh* NavMesh = const_cast<ARecastNavMesh*>(Cast<const ARecastNavMesh>(NavData));
+    if (!NavMesh || ObservedNavMeshes.Contains(NavMesh))
+    {
+        return;
+    }
+    ObservedNavMeshes.Add(NavMesh);
+    NavMesh->OnNavMeshTilesUpdated.AddUObject(this, &UAvoidancePlannerSubsystem::OnNavMeshTilesUpdated, TWeakObjectPtr<ARecastNavMesh>(NavMesh));
+
+#if WITH_RECAST
+    const dtNavMesh* DetourNavMesh = NavMesh->GetRecastMesh();
+    if (!ObstacleNavMesh.IsValid() && DetourNavMesh)
+    {
+        // Tile indices are slots of the Detour mesh, used ones need not be contiguous. Empty slots are skipped when built
+        ObstacleNavMesh = NavMesh;
+        for (int32 TileIndex = 0; TileIndex < DetourNavMesh->getMaxTiles(); ++TileIndex)
+        {
+            const dtMeshTile* Tile = DetourNavMesh->getTile(TileIndex);
+            if (Tile && Tile->header)
             {
-                if (i == j)
-                    continue;
+                PendingObstacleTiles.Add(TileIndex);
+            }
+        }
+    }
+#endif
+}
 
-                const FVector Pos_J = Positions[j];
-                const FVector Vel_J = Velocities[j];
-                const float DistSq = FVector::DistSquared(Pos_I, Pos_J);
+void UAvoidancePlannerSubsystem::BuildPendingObstacleTiles()
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidancePlanner_BuildPendingObstacleTiles);
+    const ARecastNavMesh* NavMesh = ObstacleNavMesh.Get();
+    if (!NavMesh)
+    {
+        PendingObstacleTiles.Reset();
+        return;
+    }
+    if (PendingObstacleTiles.IsEmpty())
+    {
+        return;
+    }
 
-                // Collision avoidance if within sensing radius.
-                if (DistSq <= SensingRadiusSq)
-                {
-                    const float t = ComputeTimeToCollision(i, j);
-                    FVector PredictedPos_I = Pos_I + Vel_I * t;
-                    FVector PredictedPos_J = Pos_J + Vel_J * t;
-                    FVector FAvoid = PredictedPos_I - PredictedPos_J;
-                    if (FAvoid.SizeSquared() > 0.0f)
-                    {
-                        FAvoid.Normalize();
-                        float Mag = (t >= 0.0f && t <= TimeHorizon) ? (TimeHorizon - t) / (t + 0.001f) : 0.0f;
-                        Mag = FMath::Min(Mag, MaxForce);
-                        FAvoid *= Mag;
-                        LocalForce += FAvoid;
-                    }
-                }
-                // Separation force when agents are very close.
-                if (DistSq < SeparationDistanceSq)
+    // Time sliced like DispatchPathRequests, a large navmesh fills in over a few frames instead of stalling its first dispatch
+    const double StartTime = FPlatformTime::Seconds();
+    const double BudgetSeconds = AvoidanceConsoleVariables::ObstacleBuildBudgetMs * 0.001;
+    for (TSet<uint32>::TIterator It = PendingObstacleTiles.CreateIterator(); It; ++It)
+    {
+        const uint32 TileIndex = *It;
+        It.RemoveCurrent();
+        TArray<FAvoidanceSegment> Segments;
+        AvoidanceObstacles::GatherTileSegments(*NavMesh, TileIndex, Segments);
+        if (Segments.IsEmpty())
+        {
+            ObstacleTiles.Remove(TileIndex); // Removed or emptied tile
+        }
+        else
+        {
+            const TSharedRef<FAvoidanceObstacleTile, ESPMode::ThreadSafe> Tile = MakeShared<FAvoidanceObstacleTile, ESPMode::ThreadSafe>();
+            Tile->Build(MoveTemp(Segments), SensingRadius);
+            ObstacleTiles.Add(TileIndex, Tile);
+        }
+
+        if (FPlatformTime::Seconds() - StartTime > BudgetSeconds)
+        {
+            break;
+        }
+    }
+
+    // Unchanged tiles are shared with the previous index, only the coarse tile grid is rebuilt
+    ObstacleTiles.KeySort(TLess<uint32>());
+    TArray<FAvoidanceObstacleIndex::FTileRef> Tiles;
+    ObstacleTiles.GenerateValueArray(Tiles);
+    const TSharedRef<FAvoidanceObstacleIndex, ESPMode::ThreadSafe> Index = MakeShared<FAvoidanceObstacleIndex, ESPMode::ThreadSafe>();
+    Index->Build(MoveTemp(Tiles));
+    Obstacles = Index;
+}
+
+void UAvoidancePlannerSubsystem::OnNavMeshTilesUpdated(const TArray<uint32>& ChangedTiles, TWeakObjectPtr<ARecastNavMesh> WeakNavMesh)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidancePlanner_OnNavMeshTilesUpdated);
+    const ARecastNavMesh* NavMesh = WeakNavMesh.Get();
+    if (!NavMesh || ChangedTiles.IsEmpty())
+    {
+        return;
+    }
+    if (NavMesh == ObstacleNavMesh)
+    {
+        // Rebuilt at the next tick, removed tiles included: they have no bounds below but their walls must go
+        PendingObstacleTiles.Append(ChangedTiles);
+    }
+
+    TArray<FBox, TInlineAllocator<16>> TileBounds;
+    FBox DirtyBounds(ForceInit);
+    for (const uint32 TileIndex : ChangedTiles)
+    {
+        FBox Bounds;
+        if (NavMesh->GetNavMeshTileBounds(TileIndex, Bounds))
+        {
+            TileBounds.Add(Bounds);
+            DirtyBounds += Bounds;
+        }
+    }
+    if (TileBounds.IsEmpty())
+    {
+        return;
+    }
+
+    for (FAvoidanceFlowField& FlowField : FlowFields)
+    {
+        if (FlowField.GetNavData() == NavMesh)
+        {
+            FlowField.RebuildArea(*NavMesh, TileBounds);
+        }
+    }
+
+    const double Now = GetWorld()->GetTimeSeconds();
+    for (UAvoidanceComponent* AvoidComp : AvoidanceComponents)
+    {
+        // Flow field agents pick up the rebuilt tiles through their field
+        if (!AvoidComp->bHasGoal || AvoidComp->bHasReachGoal || AvoidComp->FlowFieldHandle != INDEX_NONE)
+        {
+            continue;
+        }
+        if (!AvoidComp->PathCorridor.HasPath())
+        {
+            // No path to the goal yet, tiles rebuilt between the agent and its goal may have opened one. The box is padded by half the
+            // distance so a path bending around the blockage still counts. Retries are spaced out, dynamic obstacles rebuild tiles every frame
+            if (Now - AvoidComp->LastPathlessRetryTime < AvoidanceConsoleVariables::PathlessRetryInterval)
+            {
+                continue;
+            }
+            const FVector Position = AgentData.GetPosition(AvoidComp->AvoidanceSlot);
+            FBox GoalBox(ForceInit);
+            GoalBox += Position;
+            GoalBox += AvoidComp->GoalLocation;
+            GoalBox = GoalBox.ExpandBy(0.5 * FVector::Dist(Position, AvoidComp->GoalLocation));
+            if (GoalBox.Intersect(DirtyBounds) && TileBounds.ContainsByPredicate([&GoalBox](const FBox& Bounds) { return GoalBox.Intersect(Bounds); }))
+            {
+                AvoidComp->LastPathlessRetryTime = Now;
+                RequestPath(AvoidComp);
+            }
+            continue;
+        }
+        if (!AvoidComp->PathCorridor.GetBounds().Intersect(DirtyBounds))
+        {
+            continue;
+        }
+
+        // Only the corridor still ahead of the agent matters, segments already walked are ignored
+        const TConstArrayView<FVector> PathPoints = AvoidComp->PathCorridor.GetRemainingPoints();
+        bool bCorridorDirty = false;
+        for (int32 Point = 0; Point < PathPoints.Num() && !bCorridorDirty; ++Point)
+        {
+            const FVector SegmentStart = Point > 0 ? PathPoints[Point - 1] : AgentData.GetPosition(AvoidComp->AvoidanceSlot);
+            const FVector& SegmentEnd = PathPoints[Point];
+            for (const FBox& Bounds : TileBounds)
+            {
+                if (FMath::LineBoxIntersection(Bounds, SegmentStart, SegmentEnd, SegmentEnd - SegmentStart))
                 {
-                    FVector SeparationDirection = Pos_I - Pos_J;
-                    SeparationDirection.Normalize();
-                    LocalForce += SeparationDirection * SeparationForceMag;
+                    bCorridorDirty = true;
+                    break;
                 }
             }
-            // Accumulate the computed force.
-            Forces[i] += LocalForce;
         }
-}*/
-#pragma endregion
+        if (bCorridorDirty)
+        {
+            RequestPath(AvoidComp);
+        }
+    }
+}
+
+int32 UAvoidancePlannerSubsystem::AcquireFlowField(UAvoidanceComponent* AvoidComp)
+{
+    ReleaseFlowField(AvoidComp);
+    UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+    const APawn* Pawn = AvoidComp->ActorIns;
+    if (!NavSystem || !Pawn)
+    {
+        return INDEX_NONE;
+    }
+    const ANavigationData* NavData = NavSystem->GetNavDataForProps(Pawn->GetNavAgentPropertiesRef(), Pawn->GetActorLocation());
+    const int32 Handle = NavData ? FindOrBuildFlowField(*NavData, AvoidComp->GoalLocation) : INDEX_NONE;
+    if (Handle != INDEX_NONE)
+    {
+        ++FlowFields[Handle].NumUsers;
+        AvoidComp->FlowFieldHandle = Handle;
+    }
+    return Handle;
+}
 
-    // Update simulation state on the game thread.
-    for (uint32 i = 0; i < NumAgents; ++i)
+int32 UAvoidancePlannerSubsystem::FindOrBuildFlowField(const ANavigationData& NavData, const FVector& Goal)
+{
+    // Goals closer than a cell apart would produce the same field
+    for (auto It = FlowFields.CreateConstIterator(); It; ++It)
     {
-        if (!AvoidanceComponents[i]->bHasReachGoal)
+        if (It->GetNavData() == &NavData && FVector::DistSquared(It->GetGoalLocation(), Goal) < FMath::Square(It->GetCellSize()))
         {
-            Velocities[i] += Forces[i] * DeltaTime;
-            AvoidanceComponents[i]->AvoidanceVelocity = Forces[i];
-            Positions[i] += Velocities[i] * DeltaTime;
+            return It.GetIndex();
+        }
+    }
+    FAvoidanceFlowField FlowField;
+    if (!FlowField.Build(NavData, Goal, AvoidanceConsoleVariables::FlowFieldCellSize, AvoidanceConsoleVariables::FlowFieldMaxHalfExtent))
+    {
+        return INDEX_NONE;
+    }
+    const int32 Handle = FlowFields.Add(MoveTemp(FlowField));
+    ObserveNavMeshTiles(&NavData);
+    return Handle;
+}
 
-            Agents[i]->AddMovementInput(Velocities[i].GetSafeNormal(), Velocities[i].Size());
-            // Re-sync the position in case the actor’s location was modified.
-            Positions[i] = Agents[i]->GetActorLocation();
+void UAvoidancePlannerSubsystem::ContinueFlowFieldBuilds()
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidancePlanner_ContinueFlowFieldBuilds);
+    const double EndTime = FPlatformTime::Seconds() + AvoidanceConsoleVariables::FlowFieldBuildBudgetMs * 0.001;
+    for (FAvoidanceFlowField& FlowField : FlowFields)
+    {
+        if (FlowField.IsBuilding())
+        {
+            FlowField.ContinueBuild(EndTime);
+        }
+    }
+}
 
-            if (AvoidanceComponents[i]->bDebug)
+void UAvoidancePlannerSubsystem::ReleaseFlowField(UAvoidanceComponent* AvoidComp)
+{
+    ReleaseFlowField(AvoidComp->FlowFieldHandle);
+    AvoidComp->FlowFieldHandle = INDEX_NONE;
+}
+
+void UAvoidancePlannerSubsystem::ReleaseFlowField(const int32 Handle)
+{
+    if (FlowFields.IsValidIndex(Handle) && --FlowFields[Handle].NumUsers <= 0)
+    {
+        FlowFields.RemoveAt(Handle);
+    }
+}
+
+bool UAvoidancePlannerSubsystem::GetFlowFieldDirection(const UAvoidanceComponent* AvoidComp, const FVector& Location, FVector& OutDirection) const
+{
+    return GetFlowFieldDirection(AvoidComp->FlowFieldHandle, Location, OutDirection);
+}
+
+bool UAvoidancePlannerSubsystem::GetFlowFieldDirection(const int32 FlowFieldHandle, const FVector& Location, FVector& OutDirection) const
+{
+    return FlowFields.IsValidIndex(FlowFieldHandle) && FlowFields[FlowFieldHandle].GetDirection(Location, OutDirection);
+}
+
+void UAvoidancePlannerSubsystem::SpawnMassAgents(TConstArrayView<FVector> Locations, const FVector& GoalLocation, const float Radius, const float MovementSpeed,
+    TArray<FMassEntityHandle>* OutEntities)
+{
+    UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+    if (!EntitySubsystem || Locations.IsEmpty())
+    {
+        return;
+    }
+    FMassEntityManager& EntityManager = EntitySubsystem->GetMutableEntityManager();
+    if (!MassProcessor)
+    {
+        MassArchetype = EntityManager.CreateArchetype({
+            FAvoidanceMassPositionFragment::StaticStruct(),
+            FAvoidanceMassVelocityFragment::StaticStruct(),
+            FAvoidanceMassRadiusFragment::StaticStruct(),
+            FAvoidanceMassGoalFragment::StaticStruct(),
+            FAvoidanceMassPathCursorFragment::StaticStruct(),
+            FAvoidanceMassActorFragment::StaticStruct(),
+        });
+        MassProcessor = NewObject<UAvoidanceMassProcessor>(this);
+        MassProcessor->Initialize(*this);
+    }
+
+    // One flow field for the whole batch, taken from where the first agent stands
+    int32 FlowFieldHandle = INDEX_NONE;
+    UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+    if (const ANavigationData* NavData = NavSystem ? NavSystem->GetNavDataForProps(FNavAgentProperties::DefaultProperties, Locations[0]) : nullptr)
+    {
+        FlowFieldHandle = FindOrBuildFlowField(*NavData, GoalLocation);
+    }
+    if (FlowFieldHandle != INDEX_NONE)
+    {
+        FlowFields[FlowFieldHandle].NumUsers += Locations.Num();
+    }
+
+    TArray<FMassEntityHandle> Entities;
+    {
+        // Observers run once the creation context goes out of scope, with every fragment filled in
+        const TSharedRef<FMassEntityManager::FEntityCreationContext> CreationContext = EntityManager.BatchCreateEntities(MassArchetype, Locations.Num(), Entities);
+        for (int32 i = 0; i < Entities.Num(); ++i)
+        {
+            const FMassEntityHandle Entity = Entities[i];
+            EntityManager.GetFragmentDataChecked<FAvoidanceMassPositionFragment>(Entity).Position = Locations[i];
+            EntityManager.GetFragmentDataChecked<FAvoidanceMassRadiusFragment>(Entity).Radius = Radius;
+            FAvoidanceMassGoalFragment& Goal = EntityManager.GetFragmentDataChecked<FAvoidanceMassGoalFragment>(Entity);
+            Goal.GoalLocation = GoalLocation;
+            Goal.MovementSpeed = MovementSpeed;
+            FAvoidanceMassPathCursorFragment& Cursor = EntityManager.GetFragmentDataChecked<FAvoidanceMassPathCursorFragment>(Entity);
+            Cursor.FlowFieldHandle = FlowFieldHandle;
+            Cursor.NextLocation = GoalLocation;
+        }
+    }
+    NumMassAgents += Entities.Num();
+    bMassSlotsChanged = true;
+    if (OutEntities)
+    {
+        OutEntities->Append(Entities);
+    }
+}
+
+void UAvoidancePlannerSubsystem::DestroyMassAgent(const FMassEntityHandle Entity)
+{
+    UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+    if (!EntitySubsystem || !EntitySubsystem->GetEntityManager().IsEntityValid(Entity))
+    {
+        return;
+    }
+    FMassEntityManager& EntityManager = EntitySubsystem->GetMutableEntityManager();
+    if (APawn* Pawn = EntityManager.GetFragmentDataChecked<FAvoidanceMassActorFragment>(Entity).Pawn.Get())
+    {
+        Pawn->Destroy();
+    }
+    ReleaseFlowField(EntityManager.GetFragmentDataChecked<FAvoidanceMassPathCursorFragment>(Entity).FlowFieldHandle);
+    EntityManager.DestroyEntity(Entity);
+    --NumMassAgents;
+    bMassSlotsChanged = true;
+}
+
+FADogAvoidanceMassSettings UAvoidancePlannerSubsystem::GetMassSettings() const
+{
+    const AADogWorldSettings* WorldSettings = Cast<AADogWorldSettings>(GetWorld()->GetWorldSettings());
+    return WorldSettings ? WorldSettings->AvoidanceMass : FADogAvoidanceMassSettings();
+}
+
+void UAvoidancePlannerSubsystem::StepMassAgents(const float DeltaTime)
+{
+    SCOPE_CYCLE_COUNTER(STAT_AvoidanceMassStep);
+    UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+    if (!EntitySubsystem || !MassProcessor)
+    {
+        return;
+    }
+    FMassEntityManager& EntityManager = EntitySubsystem->GetMutableEntityManager();
+
+    // Same pipeline as the actor solve: the step gathered last frame was solved meanwhile, only applying it needs the game thread
+    if (bHasMassSolve)
+    {
+        MassSolveTask.Wait();
+        MassSolveTask = UE::Tasks::FTask();
+        bHasMassSolve = false;
+        MassProcessor->ApplyStep(EntityManager, DeltaTime);
+    }
+    MassProcessor->ReadBackPromotedPawns(EntityManager);
+
+    FAvoidanceMassStepParams StepParams;
+    StepParams.Planner = this;
+    StepParams.DeltaTime = DeltaTime;
+    StepParams.SolverParams = GetSolverParams();
+    StepParams.SolveOptions.bUseSpatialHash = AvoidanceConsoleVariables::bUseSpatialHash;
+    StepParams.SolveOptions.bUseSimdKernel = AvoidanceConsoleVariables::bUseSimdKernel;
+    StepParams.SolveOptions.MaxNeighbours = FMath::Max(AvoidanceConsoleVariables::MaxNeighbours, 0);
+    StepParams.LODSettings = GetLODSettings();
+    StepParams.MassSettings = GetMassSettings();
+    GetPlayerViewpoints(StepParams.Viewpoints);
+    // As of the last snapshot, or the last deterministic step
+    StepParams.ActorAgents = &AgentData;
+    StepParams.Obstacles = Obstacles;
+    MassProcessor->SetStepParams(MoveTemp(StepParams));
+
+    TArray<FMassEntityHandle> OldLanes;
+    if (bMassSlotsChanged)
+    {
+        OldLanes.Append(MassProcessor->GetGatheredEntities());
+    }
+    FMassProcessingContext ProcessingContext(EntityManager, DeltaTime);
+    UE::Mass::Executor::Run(*MassProcessor, ProcessingContext);
+    // The actor solve appends the gathered Mass agents after its own, in query order
+    if (bMassSlotsChanged)
+    {
+        RemapNeighbourMassLanes(OldLanes);
+        bMassSlotsChanged = false;
+    }
+
+    if (MassProcessor->GetNumGatheredAgents() > 0)
+    {
+        if (AvoidanceConsoleVariables::bAsyncSolve)
+        {
+            MassSolveTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Processor = MassProcessor.Get()]()
             {
-                DrawDebugSphere(GetWorld(), Positions[i], Radii[i], 12, FColor::Red, false, -1.0f, 0, 0.1f);
-                DrawDebugLine(GetWorld(), Positions[i], Positions[i] + Velocities[i], FColor::Green, false, -1.0f, 0, 1.0f);
+                Processor->Solve();
+            });
+            bHasMassSolve = true;
+        }
+        else
+        {
+            MassProcessor->Solve();
+            MassProcessor->ApplyStep(EntityManager, DeltaTime);
+        }
+    }
+    SET_DWORD_STAT(STAT_AvoidanceMassAgents, NumMassAgents);
+    SET_DWORD_STAT(STAT_AvoidanceMassAgentsPromoted, MassProcessor->GetNumPromoted());
+}
+
+void UAvoidancePlannerSubsystem::RegisterAgent(UAvoidanceComponent* AvoidComp)
+{
+    APawn* Pawn = AvoidComp ? AvoidComp->GetOwner<APawn>() : nullptr;
+    if (!Pawn || AvoidComp->AvoidanceSlot != INDEX_NONE)
+    {
+        return;
+    }
+
+    // Every per-agent array shares the same slot index
+    const int32 Slot = AgentData.Add();
+    Agents.Add(Pawn);
+    AvoidanceComponents.Add(AvoidComp);
+    GoalVelocities.Add(AvoidComp->AvoidanceVelocity);
+    AgentLODs.Add(EAvoidanceLOD::Near);
+    TargetForces.Add(FVector::ZeroVector);
+    AppliedForces.Add(FVector::ZeroVector);
+    FixedPositions.Add(ToFixedPoint(Pawn->GetActorLocation()));
+    MovementComponents.Add(Cast<UAvoidanceMovementComponent>(Pawn->GetMovementComponent()));
+    check(Agents.Num() == AgentData.Num());
+
+    AgentData.SetPosition(Slot, Pawn->GetActorLocation());
+    AgentData.SetVelocity(Slot, Pawn->GetVelocity());
+    AgentData.Radii[Slot] = AvoidComp->Radious;
+    AvoidComp->AvoidanceSlot = Slot;
+    // Shifts the Mass lanes the last solve appended after the actor agents, without them the new slot is past the cached ones
+    if (Slot < GetNumNeighbourSlots())
+    {
+        ChangeNeighbourSlots().Insert(INDEX_NONE, Slot);
+    }
+    // In a deterministic world the planner steps the agent from its first frame on, even before its own first tick
+    AvoidComp->bSteppedByPlanner = bDeterministicRunning || GetSolverSettings().bDeterministic;
+    AvoidComp->bDrivenByPlanner = AvoidComp->bSteppedByPlanner || ShouldDriveAgent(Slot);
+    if (Capture.IsOpen())
+    {
+        Capture.WriteSpawn(Pawn->GetUniqueID());
+    }
+}
+
+void UAvoidancePlannerSubsystem::UnregisterAgent(UAvoidanceComponent* AvoidComp)
+{
+    const int32 Slot = AvoidComp ? AvoidComp->AvoidanceSlot : INDEX_NONE;
+    if (!AvoidanceComponents.IsValidIndex(Slot) || AvoidanceComponents[Slot] != AvoidComp)
+    {
+        return;
+    }
+
+    // Swap the last agent into the freed slot so removal stays O(1)
+    Agents.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    AvoidanceComponents.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    GoalVelocities.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    AgentLODs.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    TargetForces.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    AppliedForces.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    FixedPositions.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    MovementComponents.RemoveAtSwap(Slot, 1, EAllowShrinking::No);
+    AgentData.RemoveAtSwap(Slot);
+    // Same swap for the cached lists, the Mass lanes after the actor agents move down by one.
+    // Agents registered since the last solve are past its slots and have nothing cached
+    const int32 LastSlot = Agents.Num();
+    if (LastSlot < GetNumNeighbourSlots())
+    {
+        TArray<int32>& Sources = ChangeNeighbourSlots();
+        Sources[Slot] = Sources[LastSlot];
+        Sources.RemoveAt(LastSlot, 1, EAllowShrinking::No);
+    }
+    else if (Slot < GetNumNeighbourSlots())
+    {
+        ChangeNeighbourSlots()[Slot] = INDEX_NONE;
+    }
+    if (Capture.IsOpen())
+    {
+        Capture.WriteDespawn(Slot);
+    }
+    if (AvoidanceComponents.IsValidIndex(Slot))
+    {
+        AvoidanceComponents[Slot]->AvoidanceSlot = Slot;
+    }
+    AvoidComp->AvoidanceSlot = INDEX_NONE;
+    AvoidComp->bDrivenByPlanner = false;
+    AvoidComp->bSteppedByPlanner = false;
+}
+
+TArray<int32>& UAvoidancePlannerSubsystem::ChangeNeighbourSlots()
+{
+    if (!bNeighbourSlotsChanged)
+    {
+        NeighbourSlotSources.SetNumUninitialized(NumNeighbourSlots, EAllowShrinking::No);
+        for (int32 i = 0; i < NumNeighbourSlots; ++i)
+        {
+            NeighbourSlotSources[i] = i;
+        }
+        bNeighbourSlotsChanged = true;
+    }
+    return NeighbourSlotSources;
+}
+
+void UAvoidancePlannerSubsystem::RemapNeighbourCache(const int32 NumSlots)
+{
+    if (bNeighbourSlotsChanged)
+    {
+        NeighbourCache.Remap(NeighbourSlotSources);
+        bNeighbourSlotsChanged = false;
+    }
+    NumNeighbourSlots = NumSlots;
+}
+
+void UAvoidancePlannerSubsystem::RemapNeighbourMassLanes(const TConstArrayView<FMassEntityHandle> OldLanes)
+{
+    // Only a solve that appended the previous gather has its lanes cached, the deterministic solve leaves them out
+    const int32 FirstLane = Agents.Num();
+    const int32 NumSlots = GetNumNeighbourSlots();
+    if (OldLanes.IsEmpty() || NumSlots != FirstLane + OldLanes.Num())
+    {
+        return;
+    }
+    TArray<int32>& Sources = ChangeNeighbourSlots();
+    TMap<FMassEntityHandle, int32> LaneSources;
+    LaneSources.Reserve(OldLanes.Num());
+    for (int32 i = 0; i < OldLanes.Num(); ++i)
+    {
+        LaneSources.Add(OldLanes[i], Sources[FirstLane + i]);
+    }
+    // Lanes are matched by entity, created ones start without a list and lists holding destroyed ones are dropped
+    const TConstArrayView<FMassEntityHandle> NewLanes = MassProcessor->GetGatheredEntities();
+    Sources.SetNumUninitialized(FirstLane + NewLanes.Num(), EAllowShrinking::No);
+    for (int32 i = 0; i < NewLanes.Num(); ++i)
+    {
+        const int32* Source = LaneSources.Find(NewLanes[i]);
+        Sources[FirstLane + i] = Source ? *Source : INDEX_NONE;
+    }
+}
+
+FAvoidanceSolverParams UAvoidancePlannerSubsystem::GetSolverParams() const
+{
+    FAvoidanceSolverParams Params;
+    Params.SensingRadiusSq = SensingRadiusSq;
+    Params.TimeHorizon = TimeHorizon;
+    Params.MaxForce = MaxForce;
+    Params.SeparationDistanceSq = SeparationDistanceSq;
+    Params.SeparationForceMag = SeparationForceMag;
+    const FADogAvoidanceSolverSettings SolverSettings = GetSolverSettings();
+    Params.Model = SolverSettings.Solver == EADogAvoidanceSolver::ORCA ? EAvoidanceSolverModel::Orca : EAvoidanceSolverModel::PowerLaw;
+    Params.OrcaTimeHorizon = SolverSettings.OrcaTimeHorizon;
+    Params.MaxSpeed = SolverSettings.MaxSpeed;
+    Params.ObstacleHalfHeight = SolverSettings.ObstacleHalfHeight;
+    return Params;
+}
+
+FADogAvoidanceSolverSettings UAvoidancePlannerSubsystem::GetSolverSettings() const
+{
+    const AADogWorldSettings* WorldSettings = Cast<AADogWorldSettings>(GetWorld()->GetWorldSettings());
+    return WorldSettings ? WorldSettings->AvoidanceSolver : FADogAvoidanceSolverSettings();
+}
+
+bool UAvoidancePlannerSubsystem::ShouldDriveAgent(const int32 Slot) const
+{
+    return bDeterministicRunning || (bBulkApplyActive && MovementComponents[Slot]);
+}
+
+void UAvoidancePlannerSubsystem::UpdateDrivenByPlanner()
+{
+    for (int32 i = 0; i < AvoidanceComponents.Num(); ++i)
+    {
+        AvoidanceComponents[i]->bDrivenByPlanner = ShouldDriveAgent(i);
+        AvoidanceComponents[i]->bSteppedByPlanner = bDeterministicRunning;
+    }
+}
+
+FVector UAvoidancePlannerSubsystem::GetGoalVelocity(const UAvoidanceComponent* AvoidComp)
+{
+    return AvoidComp->bHasGoal && !AvoidComp->bHasReachGoal ? AvoidComp->DesiredVelocity : FVector::ZeroVector;
+}
+
+void UAvoidancePlannerSubsystem::TickDeterministic(const float DeltaTime, const FADogAvoidanceSolverSettings& Settings)
+{
+    const int32 NumAgents = Agents.Num();
+    if (!bDeterministicRunning)
+    {
+        // Drain the pipeline, its forces came from frame rate dependent state, and start from where the pawns are
+        CollectSolve();
+        bHasPendingForces = false;
+        for (int32 i = 0; i < NumAgents; ++i)
+        {
+            const FVector Location = Agents[i]->GetActorLocation();
+            AgentData.SetPosition(i, Location);
+            FixedPositions[i] = ToFixedPoint(Location);
+        }
+        FixedStepAccumulator = 0.0f;
+        bDeterministicRunning = true;
+        UpdateDrivenByPlanner();
+    }
+
+    const float StepTime = 1.0f / FMath::Max(Settings.FixedStepRate, 1.0f);
+    FixedStepAccumulator += DeltaTime;
+    int32 NumSteps = 0;
+    while (FixedStepAccumulator >= StepTime && NumSteps < Settings.MaxStepsPerFrame)
+    {
+        StepDeterministic(StepTime, Settings.bFixedPointPositions);
+        FixedStepAccumulator -= StepTime;
+        ++NumSteps;
+    }
+    FixedStepAccumulator = FMath::Min(FixedStepAccumulator, StepTime);
+
+    // Pawns follow the simulation, nothing is read back from them
+#if ENABLE_DRAW_DEBUG
+    TArray<FBatchedLine> DebugLines;
+#endif
+    for (int32 i = 0; i < NumAgents; ++i)
+    {
+        UAvoidanceComponent* AvoidComp = AvoidanceComponents[i];
+        const FVector Position = AgentData.GetPosition(i);
+        Agents[i]->SetActorLocation(Position);
+        AvoidComp->CombinedVelocity = AgentData.GetVelocity(i);
+#if ENABLE_DRAW_DEBUG
+        if (AvoidComp->bDebug)
+        {
+            AvoidanceDebugDraw::AddAgent(DebugLines, Position, AgentData.Radii[i], AgentData.GetVelocity(i));
+        }
+#endif
+    }
+#if ENABLE_DRAW_DEBUG
+    AvoidanceDebugDraw::Submit(GetWorld(), DebugLines);
+#endif
+}
+
+void UAvoidancePlannerSubsystem::StepDeterministic(const float StepTime, const bool bFixedPointPositions)
+{
+    SCOPE_CYCLE_COUNTER(STAT_AvoidanceSolve);
+    const int32 NumAgents = Agents.Num();
+    SET_DWORD_STAT(STAT_AvoidanceAgentsSolved, NumAgents);
+
+    // Goals are followed from the simulated positions every step, so the frame rate never changes what a step sees
+    for (int32 i = 0; i < NumAgents; ++i)
+    {
+        GoalVelocities[i] = AvoidanceComponents[i]->StepGoal(AgentData.GetPosition(i));
+    }
+
+    FAvoidanceSolverParams Params = GetSolverParams();
+    Params.TimeStep = StepTime;
+    FAvoidanceSolveOptions Options;
+    Options.bUseSpatialHash = AvoidanceConsoleVariables::bUseSpatialHash;
+    Options.MaxNeighbours = FMath::Max(AvoidanceConsoleVariables::MaxNeighbours, 0);
+    Options.NeighbourCacheMargin = AvoidanceConsoleVariables::NeighbourCacheMargin;
+    Options.MaxNeighbourListAge = AvoidanceConsoleVariables::MaxNeighbourListAge;
+    Options.bDeterministic = true;
+    RemapNeighbourCache(NumAgents);
+    // No task runs in this mode, the solve buffers are free to use on the game thread
+    SolveForces.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    AvoidanceKernel::SolveForces(AgentData, GoalVelocities, Params, Options, SpatialHash, SolveForces, nullptr, {}, &NeighbourCache, Obstacles.Get());
+    if (Capture.IsOpen())
+    {
+        SCOPE_CYCLE_COUNTER(STAT_AvoidanceCapture);
+        Capture.WriteFrame(StepTime, AgentData, GoalVelocities, {});
+    }
+
+    // Semi-implicit Euler, every agent on its own so the order of slots does not matter
+    for (int32 i = 0; i < NumAgents; ++i)
+    {
+        if (AvoidanceComponents[i]->bHasReachGoal)
+        {
+            AgentData.SetVelocity(i, FVector::ZeroVector);
+            continue;
+        }
+        const FVector Velocity = AgentData.GetVelocity(i) + SolveForces[i] * StepTime;
+        AgentData.SetVelocity(i, Velocity);
+        if (bFixedPointPositions)
+        {
+            FInt64Vector& Fixed = FixedPositions[i];
+            Fixed += ToFixedPoint(Velocity * StepTime);
+            AgentData.SetPosition(i, FVector(Fixed.X / FixedPointScale, Fixed.Y / FixedPointScale, Fixed.Z / FixedPointScale));
+        }
+        else
+        {
+            AgentData.SetPosition(i, AgentData.GetPosition(i) + Velocity * StepTime);
+        }
+    }
+}
+
+void UAvoidancePlannerSubsystem::LaunchSolve(const float DeltaTime)
+{
+    const int32 NumAgents = Agents.Num();
+    SET_DWORD_STAT(STAT_AvoidanceAgentsSolved, NumAgents);
+    {
+        SCOPE_CYCLE_COUNTER(STAT_AvoidanceSnapshot);
+        // Refresh positions, then hand the task its own copy of the agent state
+        for (int32 i = 0; i < NumAgents; ++i)
+        {
+            AgentData.SetPosition(i, Agents[i]->GetActorLocation());
+            // Driven agents steer through the solve alone, their component no longer adds its own input
+            if (AvoidanceComponents[i]->bDrivenByPlanner)
+            {
+                GoalVelocities[i] = GetGoalVelocity(AvoidanceComponents[i]);
             }
         }
+        UpdateAgentLODs();
+        SolveAgentData = AgentData;
+        SolveGoalVelocities = GoalVelocities;
+        SolveForces.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+        SolveAgents.Reset(NumAgents);
+        for (UAvoidanceComponent* AvoidComp : AvoidanceComponents)
+        {
+            SolveAgents.Add(AvoidComp);
+        }
     }
+    if (Capture.IsOpen())
+    {
+        SCOPE_CYCLE_COUNTER(STAT_AvoidanceCapture);
+        Capture.WriteFrame(DeltaTime, SolveAgentData, SolveGoalVelocities, SolveModes);
+    }
+    {
+        SCOPE_CYCLE_COUNTER(STAT_AvoidanceSnapshot);
+        // Mass agents and their promoted pawns are avoided like the actor agents are by them, but solved by the Mass step.
+        // As of this frame's gather, the Mass solve task only reads them meanwhile
+        const int32 NumMassLanes = MassProcessor ? MassProcessor->GetNumGatheredAgents() : 0;
+        if (NumMassLanes > 0)
+        {
+            const FAvoidanceAgentArrays& MassAgents = MassProcessor->GetGatheredAgents();
+            SolveAgentData.SetNum(NumAgents + NumMassLanes);
+            SolveGoalVelocities.SetNumZeroed(NumAgents + NumMassLanes, EAllowShrinking::No);
+            SolveModes.SetNumUninitialized(NumAgents + NumMassLanes, EAllowShrinking::No);
+            for (int32 i = 0; i < NumMassLanes; ++i)
+            {
+                SolveAgentData.SetPosition(NumAgents + i, MassAgents.GetPosition(i));
+                SolveAgentData.SetVelocity(NumAgents + i, MassAgents.GetVelocity(i));
+                SolveAgentData.Radii[NumAgents + i] = MassAgents.Radii[i];
+                SolveModes[NumAgents + i] = EAvoidanceSolveMode::Skip;
+            }
+            SolveForces.SetNumUninitialized(NumAgents + NumMassLanes, EAllowShrinking::No);
+        }
+    }
+
+    FAvoidanceSolverParams Params = GetSolverParams();
+    // Applied one frame later when async, the frames on either side are close enough in length
+    Params.TimeStep = FMath::Max(DeltaTime, UE_KINDA_SMALL_NUMBER);
+    FAvoidanceSolveOptions Options;
+    Options.bUseSpatialHash = AvoidanceConsoleVariables::bUseSpatialHash;
+    Options.bUseSimdKernel = AvoidanceConsoleVariables::bUseSimdKernel;
+    Options.MaxNeighbours = FMath::Max(AvoidanceConsoleVariables::MaxNeighbours, 0);
+    Options.NeighbourCacheMargin = AvoidanceConsoleVariables::NeighbourCacheMargin;
+    Options.MaxNeighbourListAge = AvoidanceConsoleVariables::MaxNeighbourListAge;
+    // No solve is running here, CollectSolve waited for it
+    RemapNeighbourCache(SolveAgentData.Num());
+    SolveTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Params, Options, SolveObstacles = Obstacles]()
+    {
+        SCOPE_CYCLE_COUNTER(STAT_AvoidanceSolve);
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        AvoidanceKernel::SolveForces(SolveAgentData, SolveGoalVelocities, Params, Options, SpatialHash, SolveForces, &SolveStats, SolveModes, &NeighbourCache,
+            SolveObstacles.Get());
+        SolveCycles = FPlatformTime::Cycles64() - StartCycles;
+    });
 }
-    
 
-float UAvoidancePlannerSubsystem::ComputeTimeToCollision(const int i, const int j)
+void UAvoidancePlannerSubsystem::UpdateCapture()
 {
-    const float r = Radii[i] + Radii[j];
-    const FVector w = Positions[j] - Positions[i];
-    const float c = FVector::DotProduct(w, w) - r * r;
-    if (c < 0.0f) // Agents are colliding
+    if (AvoidanceConsoleVariables::bCapture == Capture.IsOpen())
     {
-        return 0.0f;
+        if (Capture.IsOpen())
+        {
+            SET_MEMORY_STAT(STAT_AvoidanceCaptureBytes, Capture.GetBytesWritten());
+        }
+        return;
     }
-    const FVector v = Velocities[i] - Velocities[j];
-    const float a = FVector::DotProduct(v, v);
-    const float b = FVector::DotProduct(w, v);
-    const float Discr = b * b - a * c;
+    if (Capture.IsOpen())
+    {
+        Capture.Close();
+        return;
+    }
+
+    const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("AvoidanceCaptures"),
+        FString::Printf(TEXT("%s_%s.adcap"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString()));
+    if (!Capture.Open(Filename))
+    {
+        UE_LOG(LogADog, Warning, TEXT("Avoidance capture could not open %s"), *Filename);
+        AvoidanceConsoleVariables::bCapture = false;
+        return;
+    }
+    // The capture starts with the crowd as it is, in slot order
+    for (const APawn* Pawn : Agents)
+    {
+        Capture.WriteSpawn(Pawn->GetUniqueID());
+    }
+    UE_LOG(LogADog, Log, TEXT("Avoidance capture recording to %s"), *Filename);
+}
 
-    if (Discr <= 0.0f) { return FLT_MAX; }
+FADogAvoidanceLODSettings UAvoidancePlannerSubsystem::GetLODSettings() const
+{
+    const AADogWorldSettings* WorldSettings = Cast<AADogWorldSettings>(GetWorld()->GetWorldSettings());
+    return WorldSettings ? WorldSettings->AvoidanceLOD : FADogAvoidanceLODSettings();
+}
+
+void UAvoidancePlannerSubsystem::GetPlayerViewpoints(TArray<FVector, TInlineAllocator<4>>& OutViewpoints) const
+{
+    for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+    {
+        if (const APlayerController* PlayerController = It->Get())
+        {
+            FVector Location;
+            FRotator Rotation;
+            PlayerController->GetPlayerViewPoint(Location, Rotation);
+            OutViewpoints.Add(Location);
+        }
+    }
+}
+
+void UAvoidancePlannerSubsystem::UpdateAgentLODs()
+{
+    const FADogAvoidanceLODSettings Settings = GetLODSettings();
+    const double NearDistanceSq = FMath::Square(Settings.NearDistance);
+    const double MidDistanceSq = FMath::Square(Settings.MidDistance);
+    const uint32 MidSolveInterval = FMath::Max(Settings.MidSolveInterval, 1);
+    MidForceBlend = 1.0f / MidSolveInterval;
+    ++SolveFrame;
+
+    TArray<FVector, TInlineAllocator<4>> Viewpoints;
+    GetPlayerViewpoints(Viewpoints);
+
+    const int32 NumAgents = Agents.Num();
+    SolveModes.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    int32 NumPerTier[3] = {};
+    for (int32 i = 0; i < NumAgents; ++i)
+    {
+        // Without anyone watching, e.g. on a server with no players yet, everybody stays near
+        double ClosestDistanceSq = 0.0;
+        if (!Viewpoints.IsEmpty())
+        {
+            ClosestDistanceSq = UE_DOUBLE_BIG_NUMBER;
+            const FVector Position = AgentData.GetPosition(i);
+            for (const FVector& Viewpoint : Viewpoints)
+            {
+                ClosestDistanceSq = FMath::Min(ClosestDistanceSq, FVector::DistSquared(Position, Viewpoint));
+            }
+        }
+        const EAvoidanceLOD LOD = ClosestDistanceSq <= NearDistanceSq ? EAvoidanceLOD::Near
+            : ClosestDistanceSq <= MidDistanceSq ? EAvoidanceLOD::Mid
+            : EAvoidanceLOD::Far;
+        if (LOD != AgentLODs[i])
+        {
+            AvoidanceComponents[i]->SetComponentTickInterval(LOD == EAvoidanceLOD::Far ? Settings.FarComponentTickInterval : 0.0f);
+            AgentLODs[i] = LOD;
+        }
+        ++NumPerTier[static_cast<int32>(LOD)];
 
-    const float Tau = (b - FMath::Sqrt(Discr)) / a;
-    return (Tau < 0.0f) ? FLT_MAX : Tau;
+        switch (LOD)
+        {
+        case EAvoidanceLOD::Near:
+            SolveModes[i] = EAvoidanceSolveMode::Full;
+            break;
+        case EAvoidanceLOD::Mid:
+            SolveModes[i] = (SolveFrame + i) % MidSolveInterval == 0 ? EAvoidanceSolveMode::Full : EAvoidanceSolveMode::Skip;
+            break;
+        case EAvoidanceLOD::Far:
+            SolveModes[i] = Settings.bFarSeparation ? EAvoidanceSolveMode::SeparationOnly : EAvoidanceSolveMode::GoalOnly;
+            break;
+        }
+    }
+    SET_DWORD_STAT(STAT_AvoidanceAgentsNear, NumPerTier[static_cast<int32>(EAvoidanceLOD::Near)]);
+    SET_DWORD_STAT(STAT_AvoidanceAgentsMid, NumPerTier[static_cast<int32>(EAvoidanceLOD::Mid)]);
+    SET_DWORD_STAT(STAT_AvoidanceAgentsFar, NumPerTier[static_cast<int32>(EAvoidanceLOD::Far)]);
 }
 
+void UAvoidancePlannerSubsystem::CollectSolve()
+{
+    if (!SolveTask.IsValid())
+    {
+        return;
+    }
+    uint64 WaitCycles;
+    {
+        SCOPE_CYCLE_COUNTER(STAT_AvoidanceWaitForSolve);
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        SolveTask.Wait();
+        WaitCycles = FPlatformTime::Cycles64() - StartCycles;
+    }
+    SolveTask = UE::Tasks::FTask();
+    // Whatever part of the solve did not show up as waiting ran in parallel with the rest of the frame
+    SET_FLOAT_STAT(STAT_AvoidanceSolveHiddenMs, FPlatformTime::ToMilliseconds64(SolveCycles > WaitCycles ? SolveCycles - WaitCycles : 0));
+    SET_DWORD_STAT(STAT_AvoidanceNeighbourListsBuilt, SolveStats.NumNeighbourListsBuilt);
 
+    Swap(PendingForces, SolveForces);
+    Swap(PendingModes, SolveModes);
+    Swap(PendingAgents, SolveAgents);
+    bHasPendingForces = true;
+}
 
+void UAvoidancePlannerSubsystem::ApplyForces(float DeltaTime)
+{
+    SCOPE_CYCLE_COUNTER(STAT_AvoidanceApplyForces);
+    bHasPendingForces = false;
+#if ENABLE_DRAW_DEBUG
+    TArray<FBatchedLine> DebugLines;
+#endif
+    // Update simulation state on the game thread. Agents may have moved slot or left since the snapshot.
+    for (int32 SolveIndex = 0; SolveIndex < PendingAgents.Num(); ++SolveIndex)
+    {
+        UAvoidanceComponent* AvoidComp = PendingAgents[SolveIndex].Get();
+        const int32 i = AvoidComp ? AvoidComp->AvoidanceSlot : INDEX_NONE;
+        if (i == INDEX_NONE || AvoidComp->bHasReachGoal)
+        {
+            continue;
+        }
+        if (PendingModes[SolveIndex] != EAvoidanceSolveMode::Skip)
+        {
+            TargetForces[i] = PendingForces[SolveIndex];
+        }
+        // Mid range agents are solved every few ticks, ease towards each new solve instead of stepping
+        const FVector Force = AgentLODs[i] == EAvoidanceLOD::Mid
+            ? AppliedForces[i] + (TargetForces[i] - AppliedForces[i]) * MidForceBlend
+            : TargetForces[i];
+        AppliedForces[i] = Force;
+        const FVector Velocity = AgentData.GetVelocity(i) + Force * DeltaTime;
+        AgentData.SetVelocity(i, Velocity);
+        AvoidComp->AvoidanceVelocity = Force;
 
+        // Positions are re-read at the next snapshot, nothing here needs the actor's
+        if (AvoidComp->bDrivenByPlanner)
+        {
+            // ApplySteering leaves it to the planner, the line of sight trace looks along it
+            AvoidComp->CombinedVelocity = Velocity;
+            MovementComponents[i]->RequestVelocity(Velocity);
+        }
+        else
+        {
+            Agents[i]->AddMovementInput(Velocity.GetSafeNormal(), Velocity.Size());
+        }
 
+#if ENABLE_DRAW_DEBUG
+        if (AvoidComp->bDebug && AgentLODs[i] == EAvoidanceLOD::Near)
+        {
+            AvoidanceDebugDraw::AddAgent(DebugLines, AgentData.GetPosition(i), AgentData.Radii[i], Velocity);
+        }
+#endif
+    }
+#if ENABLE_DRAW_DEBUG
+    AvoidanceDebugDraw::Submit(GetWorld(), DebugLines);
+#endif
+}
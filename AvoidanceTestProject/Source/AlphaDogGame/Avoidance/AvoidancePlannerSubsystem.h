@@ -3,10 +3,34 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "AvoidanceCapture.h"
+#include "AvoidanceFlowField.h"
+#include "AvoidanceObstacles.h"
+#include "AvoidanceKernel.h"
+#include "AvoidanceSpatialHash.h"
+#include "GameModes/ADogWorldSettings.h"
+#include "MassArchetypeTypes.h"
+#include "MassEntityTypes.h"
+#include "NavigationData.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
 #include "AvoidancePlannerSubsystem.generated.h"
 
+DECLARE_STATS_GROUP(TEXT("AvoidancePlanner"), STATGROUP_AvoidancePlanner, STATCAT_Advanced);
+
 class UAvoidanceComponent;
+class UAvoidanceMassProcessor;
+class UAvoidanceMovementComponent;
+class ARecastNavMesh;
+
+/** Significance tier of an agent, by distance to the closest player viewpoint. See FADogAvoidanceLODSettings. */
+enum class EAvoidanceLOD : uint8
+{
+	Near,
+	Mid,
+	Far,
+};
+
 /**
  * 
  */
@@ -14,6 +38,30 @@ UCLASS()
 class ALPHADOGGAME_API UAvoidancePlannerSubsystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
+
+public:
+	// Called by UAvoidanceComponent from BeginPlay/EndPlay, both O(1)
+	void RegisterAgent(UAvoidanceComponent* AvoidComp);
+	void UnregisterAgent(UAvoidanceComponent* AvoidComp);
+
+	// Queues an async repath, collapsing repeated requests from the same agent and sharing one query between agents starting close together
+	// for the same goal. The result is delivered through UAvoidanceComponent::OnPathFound
+	void RequestPath(UAvoidanceComponent* AvoidComp);
+
+	// Shares one flow field between every agent heading to the same goal, built in the background from first use. Returns INDEX_NONE if the goal is off the navmesh
+	int32 AcquireFlowField(UAvoidanceComponent* AvoidComp);
+	void ReleaseFlowField(UAvoidanceComponent* AvoidComp);
+	// O(1) lookup of the agent's steering direction, false where it should steer straight at its goal, e.g. while its field is building
+	bool GetFlowFieldDirection(const UAvoidanceComponent* AvoidComp, const FVector& Location, FVector& OutDirection) const;
+	bool GetFlowFieldDirection(int32 FlowFieldHandle, const FVector& Location, FVector& OutDirection) const;
+
+	// Mass agents: no actor until a player comes close, see UAvoidanceMassProcessor. They share flow fields to GoalLocation. Server only
+	void SpawnMassAgents(TConstArrayView<FVector> Locations, const FVector& GoalLocation, float Radius, float MovementSpeed, TArray<FMassEntityHandle>* OutEntities = nullptr);
+	void DestroyMassAgent(FMassEntityHandle Entity);
+	int32 GetNumMassAgents() const { return NumMassAgents; }
+
+	// Tuning of this world's force solve, also used by the crowd benchmark to drive AvoidanceKernel::SolveForces directly
+	FAvoidanceSolverParams GetSolverParams() const;
 	
 protected:
 	
@@ -24,26 +72,116 @@ protected:
 	virtual bool ShouldCreateSubsystem(UObject* Outer) const override { return true; }
 	virtual TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT(UAvoidancePlannerSubsystem, STATGROUP_Tickables); }
 
-	// Methods for handling agents and forces
-	void GatherAgents();
-	void InitializeAgents();
-	void ComputeForces(float DeltaTime);
+	// Force solve pipeline: snapshot at the end of frame N, solve on a task during frame N+1, apply at the start of frame N+2
+	void LaunchSolve(float DeltaTime);
+	void CollectSolve();
+	void ApplyForces(float DeltaTime);
+	void OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	// Picks each agent's tier and this solve's mode from its distance to the players
+	void UpdateAgentLODs();
+	FADogAvoidanceLODSettings GetLODSettings() const;
+	void GetPlayerViewpoints(TArray<FVector, TInlineAllocator<4>>& OutViewpoints) const;
+	// Applies last frame's Mass solve and gathers the next one, at the start of the frame so promoted pawns move on this frame's request
+	void StepMassAgents(float DeltaTime);
+	FADogAvoidanceMassSettings GetMassSettings() const;
+	// Finds or starts building the field to Goal without taking a user, INDEX_NONE if the goal is off the navmesh
+	int32 FindOrBuildFlowField(const ANavigationData& NavData, const FVector& Goal);
+	// Samples building flow fields within the frame's budget and collects their finished integrations
+	void ContinueFlowFieldBuilds();
+	void ReleaseFlowField(int32 Handle);
+	void DispatchPathRequests();
+	// Delivers one query to every agent of the group that dispatched it
+	void OnPathQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr NavPath, TArray<TWeakObjectPtr<UAvoidanceComponent>> Group);
+	void ObserveNavMeshTiles(const ANavigationData* NavData);
+	void OnNavMeshTilesUpdated(const TArray<uint32>& ChangedTiles, TWeakObjectPtr<ARecastNavMesh> WeakNavMesh);
+	// Deterministic mode: fixed steps of the planner's own agent state, see FADogAvoidanceSolverSettings::bDeterministic
+	void TickDeterministic(float DeltaTime, const FADogAvoidanceSolverSettings& Settings);
+	void StepDeterministic(float StepTime, bool bFixedPointPositions);
+	// Driven agents are moved by the planner alone, see UAvoidanceComponent::bDrivenByPlanner
+	bool ShouldDriveAgent(int32 Slot) const;
+	void UpdateDrivenByPlanner();
+	// Where each slot of the last solve went since, started on the first change. The cache is remapped with it before the next solve
+	TArray<int32>& ChangeNeighbourSlots();
+	int32 GetNumNeighbourSlots() const { return bNeighbourSlotsChanged ? NeighbourSlotSources.Num() : NumNeighbourSlots; }
+	void RemapNeighbourCache(int32 NumSlots);
+	// The gather reordered the Mass lanes following the actor agents, OldLanes being the entities of the previous gather
+	void RemapNeighbourMassLanes(TConstArrayView<FMassEntityHandle> OldLanes);
+	static FVector GetGoalVelocity(const UAvoidanceComponent* AvoidComp);
+	FADogAvoidanceSolverSettings GetSolverSettings() const;
+	// Opens or closes the capture to follow AlphaDog.Avoidance.Capture
+	void UpdateCapture();
+	// Extracts the boundary edges of pending tiles within the frame's budget and swaps in a new obstacle index
+	void BuildPendingObstacleTiles();
 	
 private:
 	UPROPERTY()
 	TArray<TObjectPtr<APawn>> Agents;
-	TArray<UAvoidanceComponent*> AvoidanceComponents;
-	TArray<float> Radii;
-	TArray<FVector> Positions;
-	TArray<FVector> Velocities;
+	UPROPERTY()
+	TArray<TObjectPtr<UAvoidanceComponent>> AvoidanceComponents;
+	FAvoidanceAgentArrays AgentData; // Positions, velocities and radii as SoA float lanes
 	TArray<FVector> GoalVelocities;
+	TArray<EAvoidanceLOD> AgentLODs;
+	TArray<FVector> TargetForces; // Latest solved force, held for the ticks a mid range agent is not solved
+	TArray<FVector> AppliedForces; // Force applied last tick, mid range agents interpolate it towards TargetForces
+	uint32 SolveFrame = 0; // Staggers mid range solves across ticks
+	UPROPERTY()
+	TArray<TObjectPtr<UAvoidanceMovementComponent>> MovementComponents; // Null for pawns moved by another movement component
+	bool bBulkApplyActive = false; // AlphaDog.Avoidance.BulkApply as of the last UpdateDrivenByPlanner
+	TArray<FInt64Vector> FixedPositions; // Deterministic mode with fixed-point positions, in 1/FixedPointScale cm
+	static constexpr double FixedPointScale = 1024.0;
+	static FInt64Vector ToFixedPoint(const FVector& V)
+	{
+		return FInt64Vector(FMath::RoundToInt64(V.X * FixedPointScale), FMath::RoundToInt64(V.Y * FixedPointScale), FMath::RoundToInt64(V.Z * FixedPointScale));
+	}
+	float FixedStepAccumulator = 0.0f;
+	FAvoidanceCaptureWriter Capture; // Open while AlphaDog.Avoidance.Capture is set
+	bool bDeterministicRunning = false;
+	float MidForceBlend = 1.0f;
+
+	// Solve stage, owned by SolveTask while it runs. Agents may register or unregister meanwhile, so it works on a copy
+	UE::Tasks::FTask SolveTask;
+	FAvoidanceAgentArrays SolveAgentData;
+	TArray<FVector> SolveGoalVelocities;
+	TArray<FVector> SolveForces;
+	TArray<EAvoidanceSolveMode> SolveModes;
+	TArray<TWeakObjectPtr<UAvoidanceComponent>> SolveAgents; // Agent of each snapshot index
+	FAvoidanceSpatialHash SpatialHash; // Rebuilt every solve from SolveAgentData positions
+	FAvoidanceNeighbourCache NeighbourCache; // Capped neighbour lists by snapshot index, reused across solves
+	int32 NumNeighbourSlots = 0; // Solved slots of the last snapshot, Mass lanes included
+	TArray<int32> NeighbourSlotSources; // Last snapshot slot of each slot, INDEX_NONE for new agents. Only kept while bNeighbourSlotsChanged
+	bool bNeighbourSlotsChanged = false; // Slots were added, removed or reordered since the last snapshot, a running solve still reads the cache
+	FAvoidanceSolveStats SolveStats; // Written by SolveTask
+	uint64 SolveCycles = 0; // Written by SolveTask
+
+	// Apply stage, forces of the last collected solve waiting for the next frame start
+	TArray<FVector> PendingForces;
+	TArray<EAvoidanceSolveMode> PendingModes;
+	TArray<TWeakObjectPtr<UAvoidanceComponent>> PendingAgents;
+	bool bHasPendingForces = false;
+	FDelegateHandle PreActorTickHandle;
+
+	TArray<TWeakObjectPtr<UAvoidanceComponent>> PathRequestQueue; // FIFO from PathRequestHead, drained within the per-frame query budget. Null entries were served by a shared query
+	int32 PathRequestHead = 0;
+	TArray<TWeakObjectPtr<ARecastNavMesh>> ObservedNavMeshes; // Navmeshes whose tile rebuilds invalidate agent paths
+	TSparseArray<FAvoidanceFlowField> FlowFields; // Indexed by UAvoidanceComponent::FlowFieldHandle
+	TWeakObjectPtr<const ARecastNavMesh> ObstacleNavMesh; // First observed navmesh, its boundary edges are the walls agents avoid
+	TMap<uint32, FAvoidanceObstacleIndex::FTileRef> ObstacleTiles; // Boundary edges of ObstacleNavMesh by tile, empty tiles left out
+	TSet<uint32> PendingObstacleTiles; // Tiles of ObstacleNavMesh built or rebuilt since they were last extracted
+	TSharedPtr<const FAvoidanceObstacleIndex, ESPMode::ThreadSafe> Obstacles; // Replaced on tile builds, a running solve keeps the one it launched with
+
+	// Mass agents, created with the first spawn
+	UPROPERTY()
+	TObjectPtr<UAvoidanceMassProcessor> MassProcessor;
+	FMassArchetypeHandle MassArchetype;
+	int32 NumMassAgents = 0;
+	UE::Tasks::FTask MassSolveTask; // Runs UAvoidanceMassProcessor::Solve between two frame starts
+	bool bHasMassSolve = false; // MassSolveTask was launched and not applied yet
+	bool bMassSlotsChanged = false; // Mass agents were created or destroyed since the last gather
 	//Simulation Parameters
 	float SensingRadius = 100.0f;
 	float TimeHorizon = 20.0f;
 	float MaxForce = 20.0f;
 
-	float ComputeTimeToCollision(const int32 i, const int32 j);
-
 	// Precompute squared thresholds.
 	const float SensingRadiusSq = SensingRadius * SensingRadius;
 	const float SeparationDistance = 50.0f;
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AvoidanceSpatialHash.h"
+
+void FAvoidanceSpatialHash::Build(TConstArrayView<float> PositionsX, TConstArrayView<float> PositionsY, const int32 NumAgents, const float InCellSize)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AvoidanceSpatialHash_Build);
+    check(InCellSize > 0.0f);
+    check(PositionsX.Num() >= NumAgents && PositionsY.Num() >= NumAgents);
+    CellSize = InCellSize;
+    InvCellSize = 1.0f / InCellSize;
+
+    // Keep the load factor around 0.5 so most buckets hold a single cell
+    const uint32 NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(NumAgents * 2, 64));
+    BucketMask = NumBuckets - 1;
+
+    BucketStarts.Reset();
+    BucketStarts.SetNumZeroed(NumBuckets + 1);
+    AgentBuckets.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+    SortedIndices.SetNumUninitialized(NumAgents, EAllowShrinking::No);
+
+    // Counting sort: histogram, exclusive prefix sum, scatter
+    for (int32 i = 0; i < NumAgents; ++i)
+    {
+        const FIntPoint Cell = GetCell(PositionsX[i], PositionsY[i]);
+        const uint32 Bucket = GetBucket(Cell.X, Cell.Y);
+        AgentBuckets[i] = Bucket;
+        ++BucketStarts[Bucket + 1];
+    }
+    for (uint32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+    {
+        BucketStarts[Bucket + 1] += BucketStarts[Bucket];
+    }
+    BucketCursors.Reset();
+    BucketCursors.Append(BucketStarts.GetData(), NumBuckets);
+    for (int32 i = 0; i < NumAgents; ++i)
+    {
+        SortedIndices[BucketCursors[AgentBuckets[i]]++] = i;
+    }
+}
+
+void FAvoidanceSpatialHash::Reset()
+{
+    BucketStarts.Reset();
+    SortedIndices.Reset();
+    AgentBuckets.Reset();
+    BucketCursors.Reset();
+    BucketMask = 0;
+}
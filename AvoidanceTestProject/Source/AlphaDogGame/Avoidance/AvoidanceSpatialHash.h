@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform XY grid hashed into a power-of-two bucket table, rebuilt from scratch once per planner tick.
+ * Agents are counting-sorted by bucket, so a query only walks the buckets of the cells it overlaps.
+ * Several cells can share a bucket, so queries return a superset and callers must still distance test.
+ */
+struct ALPHADOGGAME_API FAvoidanceSpatialHash
+{
+	void Build(TConstArrayView<float> PositionsX, TConstArrayView<float> PositionsY, int32 NumAgents, float InCellSize);
+	void Reset();
+
+	// Calls Func(AgentIndex) for every agent whose cell overlaps the XY square of half-size Radius around (X, Y).
+	template <typename FuncType>
+	void ForEachCandidate(const float X, const float Y, float Radius, FuncType&& Func) const
+	{
+		if (SortedIndices.IsEmpty())
+		{
+			return;
+		}
+		// Pad by a cell fraction so float rounding at a cell border can never drop an agent that is exactly in range
+		Radius += CellSize * 0.01f;
+		const FIntPoint MinCell = GetCell(X - Radius, Y - Radius);
+		const FIntPoint MaxCell = GetCell(X + Radius, Y + Radius);
+
+		// Neighbouring cells can alias to the same bucket, don't visit a bucket twice
+		TArray<uint32, TInlineAllocator<16>> VisitedBuckets;
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+			{
+				const uint32 Bucket = GetBucket(CellX, CellY);
+				if (VisitedBuckets.Contains(Bucket))
+				{
+					continue;
+				}
+				VisitedBuckets.Add(Bucket);
+				for (int32 Entry = BucketStarts[Bucket]; Entry < BucketStarts[Bucket + 1]; ++Entry)
+				{
+					Func(SortedIndices[Entry]);
+				}
+			}
+		}
+	}
+
+	float GetCellSize() const { return CellSize; }
+
+private:
+	FIntPoint GetCell(const float X, const float Y) const
+	{
+		return FIntPoint(FMath::FloorToInt32(X * InvCellSize), FMath::FloorToInt32(Y * InvCellSize));
+	}
+
+	uint32 GetBucket(const int32 CellX, const int32 CellY) const
+	{
+		// Teschner et al. spatial hash primes
+		return ((static_cast<uint32>(CellX) * 73856093u) ^ (static_cast<uint32>(CellY) * 19349663u)) & BucketMask;
+	}
+
+	float CellSize = 100.0f;
+	float InvCellSize = 0.01f;
+	uint32 BucketMask = 0;
+	TArray<int32> BucketStarts; // Prefix sums, NumBuckets + 1 entries
+	TArray<int32> SortedIndices; // Agent indices grouped by bucket, ascending within a bucket
+	TArray<uint32> AgentBuckets;
+	TArray<int32> BucketCursors;
+};
@@ -4,9 +4,9 @@
 #include "MyGMC_Pawn.h"
 
 #include "AvoidanceComponent.h"
+#include "AvoidanceMovementComponent.h"
 #include "GMCFlatCapsuleComponent.h"
 #include "GMCOrganicMovementComponent.h"
-#include "GameFramework/FloatingPawnMovement.h"
 
 static FName NAME_ADogCharacterCollisionProfile_Capsule(TEXT("ADogPawnCapsule"));
 static FName NAME_ADogCharacterCollisionProfile_Mesh(TEXT("ADogPawnMesh"));
@@ -33,7 +33,7 @@ AMyGMC_Pawn::AMyGMC_Pawn()
 	MeshComponent->SetRelativeRotation(FRotator(0.f, -90.f, 0.f));
 	MeshComponent->SetCollisionProfileName(NAME_ADogCharacterCollisionProfile_Mesh);
 	
-	MovementComponent = CreateDefaultSubobject<UFloatingPawnMovement>(TEXT("Movement Component"));
+	MovementComponent = CreateDefaultSubobject<UAvoidanceMovementComponent>(TEXT("Movement Component"));
 	
 	/*MovementComponent->MaxStepUpHeight = 1;
 	MovementComponent->MaxStepUpHeight = 1;*/
@@ -6,7 +6,7 @@
 #include "Actors/GMCPawn.h"
 #include "MyGMC_Pawn.generated.h"
 
-class UFloatingPawnMovement;
+class UAvoidanceMovementComponent;
 class UAvoidanceComponent;
 class UGMC_OrganicMovementCmp;
 /**
@@ -27,7 +27,7 @@ public:
 	TObjectPtr<USkeletalMeshComponent> MeshComponent;
 	
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Components")
-	TObjectPtr<UFloatingPawnMovement> MovementComponent;
+	TObjectPtr<UAvoidanceMovementComponent> MovementComponent;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Components")
 	TObjectPtr<UAvoidanceComponent> AvoidanceComponent;
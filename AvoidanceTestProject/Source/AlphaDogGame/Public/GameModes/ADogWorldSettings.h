@@ -5,8 +5,117 @@
 #include "GameFramework/WorldSettings.h"
 #include "ADogWorldSettings.generated.h"
 
+class APawn;
 class UADogExperienceDefinition;
 
+/**
+ * Avoidance model used by the avoidance planner for fully solved agents
+ */
+UENUM(BlueprintType)
+enum class EADogAvoidanceSolver : uint8
+{
+	// Anticipatory force falling off with time to collision
+	PowerLaw,
+	// Optimal reciprocal collision avoidance, smoother in very dense crowds
+	ORCA UMETA(DisplayName="ORCA"),
+};
+
+/**
+ * Avoidance model of the avoidance planner and its tuning
+ */
+USTRUCT(BlueprintType)
+struct FADogAvoidanceSolverSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance)
+	EADogAvoidanceSolver Solver = EADogAvoidanceSolver::PowerLaw;
+
+	// ORCA ignores collisions further ahead than this
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=s, ClampMin=0.01, EditCondition="Solver == EADogAvoidanceSolver::ORCA"))
+	float OrcaTimeHorizon = 2.0f;
+
+	// Fastest velocity ORCA may pick to get out of the way
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits="cm/s", ClampMin=0, EditCondition="Solver == EADogAvoidanceSolver::ORCA"))
+	float MaxSpeed = 600.0f;
+
+	// Agents only avoid navmesh walls within this height of their position, covering the capsule half height and a step.
+	// Walls of the floors above and below are ignored.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=cm, ClampMin=0))
+	float ObstacleHalfHeight = 150.0f;
+
+	// Step the crowd at a fixed rate from the planner's own agent state, so the same inputs always play out the same way.
+	// Pawns are placed at their simulated positions instead of being moved by their movement components, and LOD tiers are off.
+	// Goal arrival and path following run every step from the simulated positions. Path results and flow fields arrive between frames, like any other input.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance)
+	bool bDeterministic = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=Hz, ClampMin=1, EditCondition="bDeterministic"))
+	float FixedStepRate = 30.0f;
+
+	// Steps taken at most per frame, time beyond that is dropped so a slow frame cannot snowball
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ClampMin=1, EditCondition="bDeterministic"))
+	int32 MaxStepsPerFrame = 4;
+
+	// Integrate positions in 64-bit fixed point, which stays exact far from the origin and across platforms
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(EditCondition="bDeterministic"))
+	bool bFixedPointPositions = false;
+};
+
+/**
+ * Distance tiers of the avoidance planner, measured from the closest player viewpoint
+ */
+USTRUCT(BlueprintType)
+struct FADogAvoidanceLODSettings
+{
+	GENERATED_BODY()
+
+	// Agents closer than this get the full anticipatory solve every tick
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=cm, ClampMin=0))
+	float NearDistance = 3000.0f;
+
+	// Agents closer than this are solved every MidSolveInterval ticks, further ones are far
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=cm, ClampMin=0))
+	float MidDistance = 8000.0f;
+
+	// Ticks between two solves of a mid range agent, its force is interpolated towards the latest solve in between
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ClampMin=1))
+	int32 MidSolveInterval = 4;
+
+	// Far agents keep separating from each other, otherwise they only seek their goal
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance)
+	bool bFarSeparation = true;
+
+	// Tick interval of UAvoidanceComponent on far agents
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=s, ClampMin=0))
+	float FarComponentTickInterval = 0.25f;
+};
+
+/**
+ * Mass agents of the avoidance planner, and when they are represented by full actors
+ */
+USTRUCT(BlueprintType)
+struct FADogAvoidanceMassSettings
+{
+	GENERATED_BODY()
+
+	// Spawned for a Mass agent that comes within PromotionDistance of a player, and moved by its solve from then on.
+	// Its UAvoidanceComponent, if any, neither paths nor registers with the planner while it stands in for the agent.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance)
+	TSubclassOf<APawn> PromotedPawnClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=cm, ClampMin=0))
+	float PromotionDistance = 3000.0f;
+
+	// Promoted agents go back to Mass only this much further out, so agents on the edge do not flicker between both
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ForceUnits=cm, ClampMin=0))
+	float DemotionMargin = 500.0f;
+
+	// Actors spawned at most per frame, agents over budget are promoted on the following frames
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Avoidance, meta=(ClampMin=0))
+	int32 MaxPromotionsPerFrame = 8;
+};
+
 /**
  * The default world settings object, used primarily to set the default gameplay experience to use when playing on this map
  */
@@ -27,6 +136,18 @@ public:
 	// Returns the default experience to use when a server opens this map if it is not overridden by the user-facing experience
 	FPrimaryAssetId GetDefaultGameplayExperience() const;
 
+	// Avoidance LOD tiers used by UAvoidancePlannerSubsystem on this map
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category=Avoidance)
+	FADogAvoidanceLODSettings AvoidanceLOD;
+
+	// Avoidance model used by UAvoidancePlannerSubsystem on this map
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category=Avoidance)
+	FADogAvoidanceSolverSettings AvoidanceSolver;
+
+	// Mass agents of UAvoidancePlannerSubsystem on this map
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category=Avoidance)
+	FADogAvoidanceMassSettings AvoidanceMass;
+
 protected:
 	// The default experience to use when a server opens this map if it is not overridden by the user-facing experience
 	UPROPERTY(EditDefaultsOnly, Category=GameMode)